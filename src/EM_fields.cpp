@@ -1,5 +1,7 @@
 // Copyright 2016 Chun Shen
 #include <stdlib.h>
+#include <sys/stat.h>
+#include <unistd.h>
 #include <omp.h>
 
 #include <iostream>
@@ -8,16 +10,24 @@
 #include <cmath>
 #include <iomanip>
 #include <string>
+#include <map>
+#include <utility>
+#include <algorithm>
 
 #include "./parameter.h"
 #include "./EM_fields.h"
 #include "./gauss_quadrature.h"
+#include "./fft_convolution.h"
+#include "./density_reader.h"
+#include "./text_reader.h"
 
 using namespace std;
 
-EM_fields::EM_fields(ParameterReader* paraRdr_in) {
+EM_fields::EM_fields(ParameterReader* paraRdr_in, string event_path,
+                     Phase_timer *timer_in) {
     initialization_status = 0;
     paraRdr = paraRdr_in;
+    timer = timer_in;
 
     debug_flag = paraRdr->getVal("debug_flag");
     mode = paraRdr->getVal("mode");
@@ -36,6 +46,13 @@ EM_fields::EM_fields(ParameterReader* paraRdr_in) {
     double beam_rapidity = atanh(beta);
     spectator_rap = beam_rapidity;
     // cout << "spectator rapidity = " << spectator_rap << endl;
+    sigma = paraRdr->getVal("electric_conductivity");     // [fm^-1]
+    if (sigma < 0.0) {
+        cout << "EM_fields:: Error: electric_conductivity = " << sigma
+             << " < 0!" << endl;
+        exit(1);
+    }
+    participant_coeff_a = 0.5;
 
     nucleon_density_grid_size = paraRdr->getVal("nucleon_density_grid_size");
     nucleon_density_grid_dx = paraRdr->getVal("nucleon_density_grid_dx");
@@ -45,6 +62,184 @@ EM_fields::EM_fields(ParameterReader* paraRdr_in) {
         cout << "Current grid_size = " << nucleon_density_grid_size << endl;
         exit(1);
     }
+    parameter_grid_size = nucleon_density_grid_size;
+    parameter_grid_dx = nucleon_density_grid_dx;
+    allocate_density_grid();
+
+    n_eta = paraRdr->getVal("n_eta");
+    eta_grid = new double[n_eta];
+    sinh_eta_array = new double[n_eta];
+    cosh_eta_array = new double[n_eta];
+    double deta = 1.0;
+    if (n_eta > 1) {
+        deta = 2.*beam_rapidity*0.99/(n_eta - 1.);
+        for (int i = 0; i < n_eta; i++) {
+            eta_grid[i] = - beam_rapidity*0.99 + i*deta;
+            sinh_eta_array[i] = sinh(eta_grid[i]);
+            cosh_eta_array[i] = cosh(eta_grid[i]);
+        }
+    } else {
+        eta_grid[0] = 0.0;
+        sinh_eta_array[0] = sinh(eta_grid[0]);
+        cosh_eta_array[0] = cosh(eta_grid[0]);
+    }
+
+    field_kernel_method = paraRdr->getVal("field_kernel_method");
+    if (field_kernel_method == 1 && mode != 0) {
+        cout << "EM_fields:: Error: FFT convolution (field_kernel_method = 1)"
+             << " requires the regular transverse grid of mode 0!" << endl;
+        exit(1);
+    }
+    if ((field_kernel_method == 1 || field_kernel_method == 3)
+        && sigma == 0.0) {
+        cout << "EM_fields:: Error: field_kernel_method = "
+             << field_kernel_method << " tabulates the conductive kernel "
+             << "and needs electric_conductivity > 0!" << endl;
+        exit(1);
+    }
+
+    // the buffers of the sources, the quadtree interaction lists and the
+    // cells are kept from one event to the next by load_event()
+    spectator_sources = source_list();
+    participant_sources = source_list();
+    spectator_sources_float = source_list_float();
+    mirror_symmetry = paraRdr->getVal("mirror_symmetry");
+    mirror_symmetric = false;
+    if (include_participant_contributions == 1) {
+        set_up_participant_quadrature();
+    }
+    radial_symmetry = paraRdr->getVal("radial_symmetry", -1);
+    radial_profile = NULL;
+    spectator_tree = NULL;
+    if (field_kernel_method == 2) {
+        tree_opening_angle = paraRdr->getVal("tree_opening_angle");
+        tree_interactions.resize(omp_get_max_threads(), source_list());
+    }
+
+    spectator_kernel_table = NULL;
+    if (field_kernel_method == 3) {
+        // the table only depends on the collision energy and conductivity,
+        // it is kept in ./tables for later runs
+        mkdir("./tables", 0755);
+        ostringstream table_filename;
+        table_filename << "./tables/spectator_kernel_table_ecm_" << ecm
+                       << "_sigma_" << sigma << ".dat";
+        spectator_kernel_table = new Kernel_table(
+                    sigma/2.*sinh(spectator_rap), table_filename.str());
+        kernel_table_slices.resize(omp_get_max_threads());
+        for (unsigned int i = 0; i < kernel_table_slices.size(); i++) {
+            kernel_table_slices[i] = (
+                new double[2*spectator_kernel_table->get_slice_length()]);
+        }
+    }
+
+    kernel_isa = KERNEL_ISA_SCALAR;
+    if (paraRdr->getVal("simd_kernel") == 1) {
+        kernel_isa = detect_kernel_isa();
+    }
+    if (verbose_level > 1) {
+        cout << "using the " << kernel_isa_name(kernel_isa)
+             << " spectator kernel" << endl;
+    }
+
+    kernel_precision = paraRdr->getVal("kernel_precision");
+    if (kernel_precision != 32 && kernel_precision != 64) {
+        cout << "EM_fields:: Error: kernel_precision = " << kernel_precision
+             << " is not 32 or 64!" << endl;
+        exit(1);
+    }
+
+    omp_schedule_policy = paraRdr->getVal("omp_schedule");
+    if (omp_schedule_policy < 0 || omp_schedule_policy > 3) {
+        cout << "EM_fields:: Error: omp_schedule = " << omp_schedule_policy
+             << " is not 0, 1, 2 or 3!" << endl;
+        exit(1);
+    }
+    omp_chunk_size = paraRdr->getVal("omp_chunk_size");
+
+    cell_block_size = paraRdr->getVal("cell_block_size");
+    source_tile_size = paraRdr->getVal("source_tile_size");
+    if (source_tile_size <= 0) {
+        // a tile of all four source arrays fills half of the L2 cache
+        long l2_cache_size = sysconf(_SC_LEVEL2_CACHE_SIZE);
+        if (l2_cache_size <= 0) {
+            l2_cache_size = 256*1024;
+        }
+        int bytes_per_source = ((kernel_precision == 32)
+                                ? 4*sizeof(float) : 4*sizeof(double));
+        source_tile_size = static_cast<int>(
+                                l2_cache_size/2/bytes_per_source);
+    }
+    // tiles have to be a multiple of the widest SIMD width of the kernels
+    source_tile_size = max(kernel_simd_width_float,
+                           source_tile_size/kernel_simd_width_float
+                           *kernel_simd_width_float);
+
+    field_cache_mode = paraRdr->getVal("field_cache");
+    field_lattice_mode = paraRdr->getVal("field_lattice");
+    if (field_lattice_mode != 0) {
+        field_lattice_spacing[0] = paraRdr->getVal("field_lattice_dlntau");
+        field_lattice_spacing[1] = paraRdr->getVal("field_lattice_dx");
+        field_lattice_spacing[2] = paraRdr->getVal("field_lattice_dx");
+        field_lattice_spacing[3] = paraRdr->getVal("field_lattice_deta");
+        field_lattice_order = paraRdr->getVal("field_lattice_order");
+        field_lattice_check_points = paraRdr->getVal(
+                                            "field_lattice_check_points");
+    }
+
+    load_event(event_path);
+    initialization_status = 1;
+}
+
+EM_fields::~EM_fields() {
+    if (initialization_status == 1) {
+        free_density_grid();
+        free_source_list(&spectator_sources);
+        if (include_participant_contributions == 1) {
+            free_source_list(&participant_sources);
+            delete[] participant_rap_array;
+            delete[] participant_sinh_rap_array;
+            delete[] participant_c_array;
+            delete[] participant_weight_E_array;
+            delete[] participant_weight_B_array;
+            for (unsigned int i = 0; i < participant_node_buffers.size();
+                 i++) {
+                delete[] participant_node_buffers[i];
+            }
+            for (unsigned int i = 0; i < participant_tables.size(); i++) {
+                free_participant_kernel_table(&participant_tables[i]);
+            }
+        }
+        if (spectator_tree != NULL) {
+            delete spectator_tree;
+            for (unsigned int i = 0; i < tree_interactions.size(); i++) {
+                free_source_list(&tree_interactions[i]);
+            }
+        }
+        if (kernel_precision == 32) {
+            free_source_list_float(&spectator_sources_float);
+        }
+        if (radial_profile != NULL) {
+            delete radial_profile;
+        }
+        if (spectator_kernel_table != NULL) {
+            delete spectator_kernel_table;
+            for (unsigned int i = 0; i < kernel_table_slices.size(); i++) {
+                delete[] kernel_table_slices[i];
+            }
+        }
+
+        delete[] eta_grid;
+        delete[] sinh_eta_array;
+        delete[] cosh_eta_array;
+
+        cell_list.clear();
+    }
+    return;
+}
+
+void EM_fields::allocate_density_grid() {
+    // the transverse grid of the densities, centered at the origin
     nucleon_density_grid_x_array = new double[nucleon_density_grid_size];
     nucleon_density_grid_y_array = new double[nucleon_density_grid_size];
     spectator_density_1 = new double* [nucleon_density_grid_size];
@@ -67,165 +262,393 @@ EM_fields::EM_fields(ParameterReader* paraRdr_in) {
             participant_density_2[i][j] = 0.0;
         }
     }
+}
 
-    n_eta = paraRdr->getVal("n_eta");
-    eta_grid = new double[n_eta];
-    sinh_eta_array = new double[n_eta];
-    cosh_eta_array = new double[n_eta];
-    double deta = 1.0;
-    if (n_eta > 1) {
-        deta = 2.*beam_rapidity*0.99/(n_eta - 1.);
-        for (int i = 0; i < n_eta; i++) {
-            eta_grid[i] = - beam_rapidity*0.99 + i*deta;
-            sinh_eta_array[i] = sinh(eta_grid[i]);
-            cosh_eta_array[i] = cosh(eta_grid[i]);
+void EM_fields::free_density_grid() {
+    for (int i = 0; i < nucleon_density_grid_size; i++) {
+        delete[] spectator_density_1[i];
+        delete[] spectator_density_2[i];
+        delete[] participant_density_1[i];
+        delete[] participant_density_2[i];
+    }
+    delete[] spectator_density_1;
+    delete[] spectator_density_2;
+    delete[] participant_density_1;
+    delete[] participant_density_2;
+    delete[] nucleon_density_grid_x_array;
+    delete[] nucleon_density_grid_y_array;
+}
+
+void EM_fields::set_density_grid(int grid_size, double grid_dx) {
+    if (grid_size == nucleon_density_grid_size
+        && grid_dx == nucleon_density_grid_dx) {
+        return;
+    }
+    free_density_grid();
+    nucleon_density_grid_size = grid_size;
+    nucleon_density_grid_dx = grid_dx;
+    allocate_density_grid();
+}
+
+void EM_fields::load_event(string event_path) {
+    // reads the densities and the cells of the event in event_path and
+    // rebuilds everything depending on them. The grids, the quadratures and
+    // the kernel tables only depend on the parameters and are kept.
+    timer->start("density read");
+    read_in_densities(event_path);
+    timer->stop();
+
+    timer->start("source setup");
+    mirror_symmetric = false;
+    if (mirror_symmetry == 1) {
+        mirror_symmetric = true;
+        if (!detect_mirror_symmetry()) {
+            cout << "EM_fields:: Warning: the densities are not point "
+                 << "reflections of each other, mirror symmetry is forced "
+                 << "by mirror_symmetry = 1!" << endl;
+        }
+    } else if (mirror_symmetry == -1) {
+        mirror_symmetric = detect_mirror_symmetry();
+    }
+    if (verbose_level > 1 && mirror_symmetric) {
+        cout << "using the mirror symmetry (x, y, eta) -> (-x, -y, -eta) "
+             << "of the two nuclei" << endl;
+    }
+    build_source_lists();
+
+    if (radial_profile != NULL) {
+        delete radial_profile;
+        radial_profile = NULL;
+    }
+    bool radially_symmetric = (radial_symmetry == 1);
+    if (radial_symmetry == -1) {
+        const double radial_tolerance = 1e-8;
+        radially_symmetric = (
+            Radial_profile::ring_asymmetry(nucleon_density_grid_size,
+                                           spectator_density_1)
+                < radial_tolerance
+            && Radial_profile::ring_asymmetry(nucleon_density_grid_size,
+                                              spectator_density_2)
+                < radial_tolerance);
+    }
+    if (radially_symmetric) {
+        int n_radial_nodes = paraRdr->getVal("radial_quadrature_points");
+        radial_profile = new Radial_profile(
+                nucleon_density_grid_size, nucleon_density_grid_dx,
+                spectator_density_1, spectator_density_2, n_radial_nodes,
+                n_radial_nodes);
+        if (verbose_level > 1) {
+            cout << "radially symmetric spectators: "
+                 << radial_profile->get_number_of_nodes()
+                 << " quadrature nodes up to r = "
+                 << radial_profile->get_r_max() << " fm, used for |z| > "
+                 << radial_profile->get_z_min() << " fm" << endl;
+        }
+    }
+
+    if (field_kernel_method == 2) {
+        if (spectator_tree != NULL) {
+            delete spectator_tree;
+        }
+        spectator_tree = new Source_quadtree(spectator_sources, 16);
+        for (unsigned int i = 0; i < tree_interactions.size(); i++) {
+            resize_source_list(&tree_interactions[i],
+                               spectator_tree->get_interaction_capacity());
+        }
+        if (verbose_level > 1) {
+            cout << "built spectator quadtree with "
+                 << spectator_tree->get_number_of_nodes() << " nodes, "
+                 << "opening angle = " << tree_opening_angle << endl;
         }
-    } else {
-        eta_grid[0] = 0.0;
-        sinh_eta_array[0] = sinh(eta_grid[0]);
-        cosh_eta_array[0] = cosh(eta_grid[0]);
     }
 
-    read_in_densities("./results");
+    timer->stop();
 
+    timer->start("surface read");
+    cell_list.clear();
+    string surface_filename = event_path + "/surface.dat";
     if (mode == 0) {
         set_4d_grid_points();
     } else if (mode == 1) {
-        read_in_freezeout_surface_points_VISH2p1("./results/surface.dat",
-                                                 "./results/decdat2.dat");
+        read_in_freezeout_surface_points_VISH2p1(
+                            surface_filename, event_path + "/decdat2.dat");
     } else if (mode == 2) {
         set_tau_grid_points(0.0, 0.0, 0.0);
     } else if (mode == 3) {
         read_in_freezeout_surface_points_VISH2p1_boost_invariant(
-                                                    "./results/surface.dat");
+                                                        surface_filename);
     } else if (mode == 4) {
-        read_in_freezeout_surface_points_MUSIC("./results/surface.dat");
+        read_in_freezeout_surface_points_MUSIC(surface_filename);
     } else if (mode == -1) {
-        read_in_freezeout_surface_points_Gubser("./results/surface.dat");
+        read_in_freezeout_surface_points_Gubser(surface_filename);
     } else {
         cout << "EM_fields:: Error: unrecognize mode! "
              << "mode = " << mode << endl;
         exit(1);
     }
+    timer->stop(EM_fields_array_length);
 
-    initialization_status = 1;
+    if (kernel_precision == 32) {
+        timer->start("float32 check");
+        convert_source_list_to_float(spectator_sources,
+                                     &spectator_sources_float);
+        check_single_precision_kernel();
+        timer->stop();
+    }
 }
 
-EM_fields::~EM_fields() {
-    if (initialization_status == 1) {
-        for (int i = 0; i < nucleon_density_grid_size; i++) {
-            delete[] spectator_density_1[i];
-            delete[] spectator_density_2[i];
-            delete[] participant_density_1[i];
-            delete[] participant_density_2[i];
-        }
-        delete[] spectator_density_1;
-        delete[] spectator_density_2;
-        delete[] participant_density_1;
-        delete[] participant_density_2;
-        delete[] nucleon_density_grid_x_array;
-        delete[] nucleon_density_grid_y_array;
-
-        delete[] eta_grid;
-        delete[] sinh_eta_array;
-        delete[] cosh_eta_array;
+int EM_fields::get_number_of_sources() {
+    int n_sources = spectator_sources.length;
+    if (include_participant_contributions == 1) {
+        n_sources += participant_sources.length;
+    }
+    return(n_sources);
+}
 
-        cell_list.clear();
+void EM_fields::select_cells(const vector<int> &indices) {
+    vector<fluidCell> selected_cells(indices.size());
+    for (unsigned int i = 0; i < indices.size(); i++) {
+        selected_cells[i] = cell_list[indices[i]];
     }
-    return;
+    cell_list.swap(selected_cells);
+    EM_fields_array_length = cell_list.size();
 }
 
 void EM_fields::read_in_densities(string path) {
-    // spectators
-    ostringstream spectator_1_filename;
-    ostringstream spectator_2_filename;
-    if (mode == -1) {
-        spectator_1_filename << path
-                             << "/spectator_density_A_disk.dat";
-        spectator_2_filename << path
-                             << "/spectator_density_B_disk.dat";
-    } else {
-        spectator_1_filename << path
-                             << "/spectator_density_A_fromSd_order_2.dat";
-        spectator_2_filename << path
-                             << "/spectator_density_B_fromSd_order_2.dat";
-    }
-    read_in_spectators_density(spectator_1_filename.str(),
-                               spectator_2_filename.str());
-    // participants
-    if (include_participant_contributions == 1) {
-        ostringstream participant_1_filename;
-        participant_1_filename << path 
-                               << "/nuclear_thickness_TA_fromSd_order_2.dat";
-        ostringstream participant_2_filename;
-        participant_2_filename << path 
-                               << "/nuclear_thickness_TB_fromSd_order_2.dat";
-        read_in_participant_density(participant_1_filename.str(), 
-                                    participant_2_filename.str());
+    // a binary density container in the event directory is read instead of
+    // the text files, its grid replaces the one of parameters.dat for this
+    // event. The text files are read on the grid of parameters.dat, also
+    // after an event with a container on another grid.
+    string container_filename = path + ((mode == -1) ? "/densities_disk.bin"
+                                                     : "/densities.bin");
+    density_container_header header;
+    bool container_found = read_density_container_header(container_filename,
+                                                         &header);
+    if (container_found) {
+        read_in_density_container(container_filename, header);
+        if (include_participant_contributions != 1 || header.n_maps == 4) {
+            return;
+        }
     }
-}
 
-void EM_fields::read_in_spectators_density(string filename_1,
-                                           string filename_2) {
-    if (verbose_level > 3) {
-        cout << "read in spectator density ...";
+    // the spectator and participant files are parsed concurrently, only the
+    // participants are missing from a container of the spectators
+    vector<string> filenames;
+    vector<double**> densities;
+    if (!container_found) {
+        set_density_grid(parameter_grid_size, parameter_grid_dx);
+        string suffix = ((mode == -1) ? "_disk.dat" : "_fromSd_order_2.dat");
+        filenames.push_back(path + "/spectator_density_A" + suffix);
+        filenames.push_back(path + "/spectator_density_B" + suffix);
+        densities.push_back(spectator_density_1);
+        densities.push_back(spectator_density_2);
     }
-    ifstream spec1(filename_1.c_str());
-    ifstream spec2(filename_2.c_str());
-    if (!spec1.good()) {
-        cout << "Error:EM_fields::read_in_spectators_density: "
-             << "can not open file " << filename_1 << endl;
-        exit(1);
+    if (include_participant_contributions == 1) {
+        filenames.push_back(path + "/nuclear_thickness_TA_fromSd_order_2.dat");
+        filenames.push_back(path + "/nuclear_thickness_TB_fromSd_order_2.dat");
+        densities.push_back(participant_density_1);
+        densities.push_back(participant_density_2);
     }
-    if (!spec2.good()) {
-        cout << "Error:EM_fields::read_in_spectators_density: "
-             << "can not open file " << filename_2 << endl;
-        exit(1);
+    if (verbose_level > 3) {
+        cout << "read in spectator and participant densities ...";
     }
+    read_density_files(filenames, nucleon_density_grid_size, densities);
+    if (verbose_level > 3) {
+        cout << " done!" << endl;
+    }
+}
 
-    for (int i = 0; i < nucleon_density_grid_size; i++) {
-        for (int j = 0; j < nucleon_density_grid_size; j++) {
-            spec1 >> spectator_density_1[i][j];
-            spec2 >> spectator_density_2[i][j];
+bool EM_fields::detect_mirror_symmetry() {
+    // this function checks whether the densities of nucleus 2 are the point
+    // reflections (x, y) -> (-x, -y) of the ones of nucleus 1. The density
+    // grid is symmetric about the origin by construction.
+    const double mirror_tolerance = 1e-8;
+    int n = nucleon_density_grid_size;
+    double **density_1[2] = {spectator_density_1, participant_density_1};
+    double **density_2[2] = {spectator_density_2, participant_density_2};
+    int n_types = (include_participant_contributions == 1) ? 2 : 1;
+    for (int type = 0; type < n_types; type++) {
+        double max_density = 0.0;
+        double max_difference = 0.0;
+        for (int i = 0; i < n; i++) {
+            for (int j = 0; j < n; j++) {
+                max_density = max(max_density, fabs(density_1[type][i][j]));
+                max_difference = max(max_difference, fabs(
+                    density_1[type][i][j]
+                    - density_2[type][n - 1 - i][n - 1 - j]));
+            }
+        }
+        if (max_difference > mirror_tolerance*max_density) {
+            return(false);
         }
     }
+    return(true);
+}
 
-    spec1.close();
-    spec2.close();
-    if (verbose_level > 3) {
-        cout << " done!" << endl;
+void EM_fields::read_in_density_container(
+                            string filename,
+                            const density_container_header &header) {
+    // the densities of the container, on the grid of the container
+    double origin = -(header.grid_size - 1)/2.*header.grid_dx;
+    if (fabs(header.origin_x - origin) > 1e-6*header.grid_dx
+        || fabs(header.origin_y - origin) > 1e-6*header.grid_dx) {
+        cout << "EM_fields:: Error: the density grid of " << filename
+             << " is not centered at the origin!" << endl;
+        exit(1);
     }
+    if ((header.grid_size != parameter_grid_size
+         || header.grid_dx != parameter_grid_dx) && verbose_level > 1) {
+        cout << "density grid of " << filename << ": "
+             << header.grid_size << " x " << header.grid_size
+             << " points, dx = " << header.grid_dx << " fm" << endl;
+    }
+    set_density_grid(header.grid_size, header.grid_dx);
+    vector<double**> densities;
+    densities.push_back(spectator_density_1);
+    densities.push_back(spectator_density_2);
+    if (include_participant_contributions == 1 && header.n_maps == 4) {
+        densities.push_back(participant_density_1);
+        densities.push_back(participant_density_2);
+    }
+    read_density_container(filename, densities);
 }
 
-void EM_fields::read_in_participant_density(string filename_1,
-                                            string filename_2) {
-    if (verbose_level > 3) {
-        cout << "read in participant density ...";
+void EM_fields::build_source_lists() {
+    // compact the spectator densities into contiguous aligned arrays
+    // only grid points with a non-zero density in either nucleus are kept,
+    // spectators occupy only the two edges of the transverse grid
+    int n_sources = 0;
+    for (int i = 0; i < nucleon_density_grid_size; i++) {
+        for (int j = 0; j < nucleon_density_grid_size; j++) {
+            if (spectator_density_1[i][j] != 0.0
+                || spectator_density_2[i][j] != 0.0) {
+                n_sources++;
+            }
+        }
     }
-    ifstream part1(filename_1.c_str());
-    ifstream part2(filename_2.c_str());
-    if (!part1.good()) {
-        cout << "Error:EM_fields::read_in_participant_density: "
-             << "can not open file " << filename_1 << endl;
-        exit(1);
+    resize_source_list(&spectator_sources, n_sources);
+    spectator_source_radius = 0.0;
+    int idx = 0;
+    for (int i = 0; i < nucleon_density_grid_size; i++) {
+        for (int j = 0; j < nucleon_density_grid_size; j++) {
+            if (spectator_density_1[i][j] == 0.0
+                && spectator_density_2[i][j] == 0.0) {
+                continue;
+            }
+            spectator_sources.x[idx] = nucleon_density_grid_x_array[i];
+            spectator_sources.y[idx] = nucleon_density_grid_y_array[j];
+            spectator_sources.rho_1[idx] = spectator_density_1[i][j];
+            spectator_sources.rho_2[idx] = spectator_density_2[i][j];
+            spectator_source_radius = max(spectator_source_radius,
+                sqrt(spectator_sources.x[idx]*spectator_sources.x[idx]
+                     + spectator_sources.y[idx]*spectator_sources.y[idx]));
+            idx++;
+        }
     }
-    if (!part2.good()) {
-        cout << "Error:EM_fields::read_in_participant_density: "
-             << "can not open file " << filename_2 << endl;
-        exit(1);
+    if (verbose_level > 1) {
+        cout << "number of spectator source points: " << n_sources
+             << " out of "
+             << nucleon_density_grid_size*nucleon_density_grid_size
+             << " grid points" << endl;
     }
 
+    if (include_participant_contributions != 1) {
+        return;
+    }
+    n_sources = 0;
+    for (int i = 0; i < nucleon_density_grid_size; i++) {
+        for (int j = 0; j < nucleon_density_grid_size; j++) {
+            if (participant_density_1[i][j] != 0.0
+                || participant_density_2[i][j] != 0.0) {
+                n_sources++;
+            }
+        }
+    }
+    resize_source_list(&participant_sources, n_sources);
+    participant_source_radius = 0.0;
+    idx = 0;
     for (int i = 0; i < nucleon_density_grid_size; i++) {
         for (int j = 0; j < nucleon_density_grid_size; j++) {
-            part1 >> participant_density_1[i][j];
-            part2 >> participant_density_2[i][j];
+            if (participant_density_1[i][j] == 0.0
+                && participant_density_2[i][j] == 0.0) {
+                continue;
+            }
+            participant_sources.x[idx] = nucleon_density_grid_x_array[i];
+            participant_sources.y[idx] = nucleon_density_grid_y_array[j];
+            participant_sources.rho_1[idx] = participant_density_1[i][j];
+            participant_sources.rho_2[idx] = participant_density_2[i][j];
+            participant_source_radius = max(participant_source_radius,
+                sqrt(participant_sources.x[idx]*participant_sources.x[idx]
+                     + participant_sources.y[idx]*participant_sources.y[idx]));
+            idx++;
         }
     }
+    if (verbose_level > 1) {
+        cout << "number of participant source points: " << n_sources
+             << endl;
+    }
+}
 
-    part1.close();
-    part2.close();
-    if (verbose_level > 3) {
-        cout << " done!" << endl;
+void EM_fields::set_up_participant_quadrature() {
+    // the rapidity nodes and all node constants are computed once per run
+    participant_rapidity_integral_ny = 50;
+    participant_n_nodes = (
+        (participant_rapidity_integral_ny + kernel_simd_width - 1)
+        /kernel_simd_width*kernel_simd_width);
+    double *participant_rap_inte_weight_array =
+                            new double[participant_rapidity_integral_ny];
+    participant_rap_array = new double[participant_n_nodes];
+    participant_sinh_rap_array = new double[participant_n_nodes];
+    participant_c_array = new double[participant_n_nodes];
+    participant_weight_E_array = new double[participant_n_nodes];
+    participant_weight_B_array = new double[participant_n_nodes];
+    gauss_quadrature(participant_rapidity_integral_ny, 1, 0.0, 0.0,
+                     -spectator_rap, spectator_rap,
+                     participant_rap_array,
+                     participant_rap_inte_weight_array);
+    for (int k = 0; k < participant_n_nodes; k++) {
+        if (k >= participant_rapidity_integral_ny) {
+            // padded nodes do not contribute
+            participant_rap_array[k] = 0.0;
+            participant_sinh_rap_array[k] = 0.0;
+            participant_c_array[k] = 0.0;
+            participant_weight_E_array[k] = 0.0;
+            participant_weight_B_array[k] = 0.0;
+            continue;
+        }
+        double rap_local = participant_rap_array[k];
+        double sinh_participant_rap = sinh(rap_local);
+        double cosh_participant_rap = cosh(rap_local);
+        double exp_participant_rap = exp(participant_coeff_a*rap_local);
+        participant_sinh_rap_array[k] = sinh_participant_rap;
+        participant_c_array[k] = sigma/2.*fabs(sinh_participant_rap);
+        participant_weight_E_array[k] = (
+            participant_rap_inte_weight_array[k]*cosh_participant_rap
+            *exp_participant_rap);
+        participant_weight_B_array[k] = (
+            participant_rap_inte_weight_array[k]*sinh_participant_rap
+            *exp_participant_rap);
+    }
+    delete[] participant_rap_inte_weight_array;
+
+    participant_node_buffers.resize(omp_get_max_threads());
+    for (unsigned int i = 0; i < participant_node_buffers.size(); i++) {
+        participant_node_buffers[i] = new double[4*participant_n_nodes];
+    }
+
+    participant_kernel_method = paraRdr->getVal("participant_kernel_method");
+    if (participant_kernel_method == 1) {
+        int segment_bits = paraRdr->getVal("participant_table_bits");
+        if (segment_bits < 0 || segment_bits > 8) {
+            cout << "EM_fields:: Error: participant_table_bits = "
+                 << segment_bits << " is out of range [0, 8]!" << endl;
+            exit(1);
+        }
+        participant_tables.resize(omp_get_max_threads());
+        for (unsigned int i = 0; i < participant_tables.size(); i++) {
+            allocate_participant_kernel_table(&participant_tables[i],
+                                              segment_bits);
+        }
     }
 }
 
@@ -296,32 +719,42 @@ void EM_fields::set_4d_grid_points() {
 void EM_fields::read_in_freezeout_surface_points_VISH2p1(string filename1,
                                                          string filename2) {
     // this function reads in the freeze out surface points from a text file
-    ifstream FOsurf(filename1.c_str());
-    ifstream decdat(filename2.c_str());
     if (verbose_level > 1) {
         cout << "read in freeze-out surface points from VISH2+1 outputs ...";
     }
-    // read in freeze-out surface positions
-    double dummy;
-    string input;
-    double tau_local, x_local, y_local;
-    double vx_local, vy_local;
-    double T_local;
-    FOsurf >> dummy;
-    while (!FOsurf.eof()) {
-        FOsurf >> tau_local >> x_local >> y_local >> dummy >> dummy >> dummy;
-        getline(decdat, input, '\n');
-        stringstream ss(input);
-        ss >> dummy >> dummy >> dummy >> dummy;     // skip tau and da_i
-        ss >> vx_local >> vy_local;                 // read in vx and vy
-        ss >> dummy >> dummy >> T_local;            // read in temperature
-        // the rest is discharded
+    // tau, x and y from the surface file, v^x, v^y and T from decdat2.dat,
+    // the rest is discarded
+    const int surface_columns[] = {1, 2, 3};
+    const int decdat_columns[] = {4, 5, 8};
+    vector<int> columns(surface_columns, surface_columns + 3);
+    vector<double> surface_values;
+    long n_points = read_text_columns(filename1, columns, &surface_values);
+    columns.assign(decdat_columns, decdat_columns + 3);
+    vector<double> decdat_values;
+    long n_decdat_points = read_text_columns(filename2, columns,
+                                             &decdat_values);
+    if (n_decdat_points < n_points) {
+        cout << "Error:EM_fields::read_in_freezeout_surface_points_VISH2p1: "
+             << filename2 << " has " << n_decdat_points << " lines, "
+             << filename1 << " has " << n_points << "!" << endl;
+        exit(1);
+    }
+
+    cell_list.resize(n_points*n_eta);
+    #pragma omp parallel for
+    for (long k = 0; k < n_points; k++) {
+        double tau_local = surface_values[3*k];
+        double x_local = surface_values[3*k + 1];
+        double y_local = surface_values[3*k + 2];
+        double vx_local = decdat_values[3*k];
+        double vy_local = decdat_values[3*k + 1];
+        double T_local = decdat_values[3*k + 2];
         double u_tau_local = 1./sqrt(1. - vx_local*vx_local
                                      - vy_local*vy_local);
         double u_x_local = u_tau_local*vx_local;
         double u_y_local = u_tau_local*vy_local;
         for (int i = 0; i < n_eta; i++) {
-            fluidCell cell_local;
+            fluidCell &cell_local = cell_list[k*n_eta + i];
             cell_local.mu_m = M_PI/2.*sqrt(6*M_PI)*T_local*T_local;  // GeV^2
             cell_local.eta = eta_grid[i];
             cell_local.tau = tau_local;
@@ -334,14 +767,8 @@ void EM_fields::read_in_freezeout_surface_points_VISH2p1(string filename1,
             cell_local.beta.x = u_x_local/u_t_local;
             cell_local.beta.y = u_y_local/u_t_local;
             cell_local.beta.z = u_z_local/u_t_local;
-
-            // push back the fluid cell into the cell list
-            cell_list.push_back(cell_local);
         }
-        FOsurf >> dummy;
     }
-    FOsurf.close();
-    decdat.close();
     if (verbose_level > 1) {
         cout << " done!" << endl;
     }
@@ -414,41 +841,38 @@ void EM_fields::read_in_freezeout_surface_points_Gubser(string filename) {
 void EM_fields::read_in_freezeout_surface_points_VISH2p1_boost_invariant(
                                                             string filename) {
     // this function reads in the freeze out surface points from a text file
-    ifstream FOsurf(filename.c_str());
     if (verbose_level > 1) {
         cout << "read in freeze-out surface points from VISH2+1 "
              << "boost invariant outputs ...";
     }
-    if (!FOsurf.good()) {
-        cout << "Error:EM_fields::"
-             << "read_in_freezeout_surface_points_VISH2p1_boost_invariant:"
-             << "can not open file: " << filename << endl;
-        exit(1);
-    }
-
-    // read in freeze-out surface positions
-    double dummy;
-    string input;
-    double tau_local, x_local, y_local;
-    double u_tau_local, u_x_local, u_y_local;
-    double T_local;
-    getline(FOsurf, input, '\n');
-    while (!FOsurf.eof()) {
-        stringstream ss(input);
-        ss >> tau_local >> x_local >> y_local >> dummy;  // eta_s = 0.0
-        ss >> dummy >> dummy >> dummy >> dummy;   // skip surface vector da_mu
-        // read in flow velocity
-        ss >> dummy >> u_x_local >> u_y_local >> dummy;  // u_eta = 0.0
-        u_tau_local = sqrt(1. + u_x_local*u_x_local + u_y_local*u_y_local);
-        ss >> dummy >> dummy >> T_local;
-        // the rest information is discarded
+    // tau, x, y, u^x, u^y and T, eta_s = u^eta = 0 and the surface vector
+    // da_mu is skipped
+    const int surface_columns[] = {0, 1, 2, 9, 10, 14};
+    vector<int> columns(surface_columns, surface_columns + 6);
+    vector<double> values;
+    long n_points = read_text_columns(filename, columns, &values);
+
+    // the first point with a too small mu_m is reported after the loop
+    long first_cold_point = n_points;
+    cell_list.resize(n_points*n_eta);
+    #pragma omp parallel for reduction(min: first_cold_point)
+    for (long k = 0; k < n_points; k++) {
+        const double *row = &values[6*k];
+        double tau_local = row[0];
+        double x_local = row[1];
+        double y_local = row[2];
+        double u_x_local = row[3];
+        double u_y_local = row[4];
+        double T_local = row[5];
+        double u_tau_local = sqrt(1. + u_x_local*u_x_local
+                                  + u_y_local*u_y_local);
+        double mu_m = M_PI/2.*sqrt(6*M_PI)*T_local*T_local;  // GeV^2
+        if (mu_m < 1e-5) {     // mu_m is too small
+            first_cold_point = min(first_cold_point, k);
+        }
         for (int i = 0; i < n_eta; i++) {
-            fluidCell cell_local;
-            cell_local.mu_m = M_PI/2.*sqrt(6*M_PI)*T_local*T_local;  // GeV^2
-            if (cell_local.mu_m < 1e-5) {     // mu_m is too small
-                cout << cell_local.mu_m << "  " << T_local << endl;
-                exit(1);
-            }
+            fluidCell &cell_local = cell_list[k*n_eta + i];
+            cell_local.mu_m = mu_m;
             cell_local.eta = eta_grid[i];
             cell_local.tau = tau_local;
             cell_local.x = x_local;
@@ -460,13 +884,17 @@ void EM_fields::read_in_freezeout_surface_points_VISH2p1_boost_invariant(
             cell_local.beta.x = u_x_local/u_t_local;
             cell_local.beta.y = u_y_local/u_t_local;
             cell_local.beta.z = u_z_local/u_t_local;
-
-            // push back the fluid cell into the cell list
-            cell_list.push_back(cell_local);
         }
-        getline(FOsurf, input, '\n');
     }
-    FOsurf.close();
+    if (first_cold_point < n_points) {
+        double T_local = values[6*first_cold_point + 5];
+        cout << "Error:EM_fields::"
+             << "read_in_freezeout_surface_points_VISH2p1_boost_invariant: "
+             << "mu_m = " << M_PI/2.*sqrt(6*M_PI)*T_local*T_local
+             << " GeV^2 at T = " << T_local << " GeV of surface point "
+             << first_cold_point + 1 << " is too small!" << endl;
+        exit(1);
+    }
     if (verbose_level > 1) {
         cout << " done!" << endl;
     }
@@ -479,41 +907,38 @@ void EM_fields::read_in_freezeout_surface_points_VISH2p1_boost_invariant(
 
 void EM_fields::read_in_freezeout_surface_points_MUSIC(string filename) {
     // this function reads in the freeze out surface points from a text file
-    ifstream FOsurf(filename.c_str());
     if (verbose_level > 1) {
         cout << "read in freeze-out surface points from MUSIC "
              << "(3+1)-d outputs ...";
     }
-    if (!FOsurf.good()) {
-        cout << "Error:EM_fields::"
-             << "read_in_freezeout_surface_points_MUSIC:"
-             << "can not open file: " << filename << endl;
-        exit(1);
-    }
-
-    // read in freeze-out surface positions
-    double dummy;
-    string input;
-    double tau_local, x_local, y_local, eta_s_local;
-    double u_tau_local, u_x_local, u_y_local, u_eta_local;
-    double T_local;
-    getline(FOsurf, input, '\n');
-    while (!FOsurf.eof()) {
-        stringstream ss(input);
-        ss >> tau_local >> x_local >> y_local >> eta_s_local;
-        ss >> dummy >> dummy >> dummy >> dummy;
-        // read in flow velocity
-        // here u^eta = tau*u^eta
-        ss >> dummy >> u_x_local >> u_y_local >> u_eta_local;
-        u_tau_local = sqrt(1. + u_x_local*u_x_local + u_y_local*u_y_local
-                           + u_eta_local*u_eta_local);
-        ss >> dummy >> T_local;
-        // the rest information is discarded
-        fluidCell cell_local;
+    // tau, x, y, eta_s, u^x, u^y, tau*u^eta and T, the surface vector da_mu
+    // is skipped
+    const int surface_columns[] = {0, 1, 2, 3, 9, 10, 11, 13};
+    vector<int> columns(surface_columns, surface_columns + 8);
+    vector<double> values;
+    long n_points = read_text_columns(filename, columns, &values);
+
+    // the first point with a too small mu_m is reported after the loop
+    long first_cold_point = n_points;
+    cell_list.resize(n_points);
+    #pragma omp parallel for reduction(min: first_cold_point)
+    for (long k = 0; k < n_points; k++) {
+        const double *row = &values[8*k];
+        double tau_local = row[0];
+        double x_local = row[1];
+        double y_local = row[2];
+        double eta_s_local = row[3];
+        double u_x_local = row[4];
+        double u_y_local = row[5];
+        double u_eta_local = row[6];
+        double T_local = row[7];
+        double u_tau_local = sqrt(1. + u_x_local*u_x_local
+                                  + u_y_local*u_y_local
+                                  + u_eta_local*u_eta_local);
+        fluidCell &cell_local = cell_list[k];
         cell_local.mu_m = M_PI/2.*sqrt(6*M_PI)*T_local*T_local;  // GeV^2
         if (cell_local.mu_m < 1e-5) {     // mu_m is too small
-            cout << cell_local.mu_m << "  " << T_local << endl;
-            exit(1);
+            first_cold_point = min(first_cold_point, k);
         }
         cell_local.eta = eta_s_local;
         cell_local.tau = tau_local;
@@ -528,12 +953,15 @@ void EM_fields::read_in_freezeout_surface_points_MUSIC(string filename) {
         cell_local.beta.x = u_x_local/u_t_local;
         cell_local.beta.y = u_y_local/u_t_local;
         cell_local.beta.z = u_z_local/u_t_local;
-
-        // push back the fluid cell into the cell list
-        cell_list.push_back(cell_local);
-        getline(FOsurf, input, '\n');
     }
-    FOsurf.close();
+    if (first_cold_point < n_points) {
+        double T_local = values[8*first_cold_point + 7];
+        cout << "Error:EM_fields::read_in_freezeout_surface_points_MUSIC: "
+             << "mu_m = " << M_PI/2.*sqrt(6*M_PI)*T_local*T_local
+             << " GeV^2 at T = " << T_local << " GeV of surface point "
+             << first_cold_point + 1 << " is too small!" << endl;
+        exit(1);
+    }
     if (verbose_level > 1) {
         cout << " done!" << endl;
     }
@@ -545,324 +973,981 @@ void EM_fields::read_in_freezeout_surface_points_MUSIC(string filename) {
 }
 
 void EM_fields::calculate_EM_fields() {
-    int i_array;
-    int count = 0;
-    #pragma omp parallel private(i_array, count)
-    {
-    if (omp_get_thread_num() == 0) {
-        cout << "computing EM fields with " << omp_get_num_threads()
-             << " cpu cores..." << endl;
-    }
-    #pragma omp for
-    for (i_array = 0; i_array < EM_fields_array_length; i_array++) {
-        double sigma = 0.023;       // electric conductivity [fm^-1]
-        double cosh_spectator_rap = cosh(spectator_rap);
-        double sinh_spectator_rap = sinh(spectator_rap);
-
-        double participant_coeff_a = 0.5;
-        double participant_rapidity_envelop_coeff =
-            participant_coeff_a/(2.*sinh(participant_coeff_a*spectator_rap));
-        int participant_rapidity_integral_ny = 50;
-        double *participant_rap_inte_y_array =
-                                new double[participant_rapidity_integral_ny];
-        double *participant_rap_inte_weight_array =
-                                new double[participant_rapidity_integral_ny];
-        gauss_quadrature(participant_rapidity_integral_ny, 1, 0.0, 0.0,
-                         -spectator_rap, spectator_rap,
-                         participant_rap_inte_y_array,
-                         participant_rap_inte_weight_array);
-
-        double dx_sq = nucleon_density_grid_dx*nucleon_density_grid_dx;
-
-        double field_x = cell_list[i_array].x;
-        double field_y = cell_list[i_array].y;
-        double field_tau = cell_list[i_array].tau;
-        double field_eta = cell_list[i_array].eta;
-        double temp_sum_Ex_spectator = 0.0e0;
-        double temp_sum_Ey_spectator = 0.0e0;
-        double temp_sum_Ez_spectator = 0.0e0;
-        double temp_sum_Bx_spectator = 0.0e0;
-        double temp_sum_By_spectator = 0.0e0;
-
-        double z_local_spectator_1 = field_tau*sinh(spectator_rap - field_eta);
-        double z_local_spectator_2 = (
-                                field_tau*sinh(-spectator_rap - field_eta));
-        double z_local_spectator_1_sq = (z_local_spectator_1
-                                         *z_local_spectator_1);
-        double z_local_spectator_2_sq = (z_local_spectator_2
-                                         *z_local_spectator_2);
+    if (field_cache_mode != 0) {
+        calculate_EM_fields_with_cache();
+    } else {
+        calculate_EM_fields_uncached();
+    }
+}
 
+uint64_t EM_fields::get_field_engine_hash() {
+    // hash of everything the fields at a given point depend on: the
+    // densities on the grid of the current event, the collision system, the
+    // medium and the approximations of the kernels. The settings of an
+    // unused approximation enter as 0.
+    bool participants = (include_participant_contributions == 1);
+    double parameters[15] = {
+        paraRdr->getVal("ecm"), paraRdr->getVal("atomic_number"),
+        paraRdr->getVal("number_of_proton"),
+        static_cast<double>(nucleon_density_grid_size),
+        nucleon_density_grid_dx,
+        static_cast<double>(include_participant_contributions), sigma,
+        static_cast<double>(field_kernel_method),
+        static_cast<double>(kernel_precision),
+        static_cast<double>(kernel_isa),
+        (field_kernel_method == 2) ? tree_opening_angle : 0.0,
+        static_cast<double>(mirror_symmetric),
+        (radial_profile != NULL)
+            ? paraRdr->getVal("radial_quadrature_points") : 0.0,
+        static_cast<double>(participants ? participant_kernel_method : 0),
+        (participants && participant_kernel_method == 1)
+            ? paraRdr->getVal("participant_table_bits") : 0.0};
+    uint64_t hash = Field_cache::hash_bytes(parameters, sizeof(parameters),
+                                            0);
+    size_t row_size = nucleon_density_grid_size*sizeof(double);
+    for (int i = 0; i < nucleon_density_grid_size; i++) {
+        hash = Field_cache::hash_bytes(spectator_density_1[i], row_size,
+                                       hash);
+        hash = Field_cache::hash_bytes(spectator_density_2[i], row_size,
+                                       hash);
+    }
+    if (participants) {
         for (int i = 0; i < nucleon_density_grid_size; i++) {
-            double grid_x = nucleon_density_grid_x_array[i];
-            for (int j = 0; j < nucleon_density_grid_size; j++) {
-                double grid_y = nucleon_density_grid_y_array[j];
-                double x_local = field_x - grid_x;
-                double y_local = field_y - grid_y;
-                double r_perp_local_sq = x_local*x_local + y_local*y_local;
-                double Delta_1 = sqrt(r_perp_local_sq
-                                      + z_local_spectator_1_sq);
-                double Delta_1_cubic = Delta_1*Delta_1*Delta_1;
-                double Delta_2 = sqrt(r_perp_local_sq
-                                      + z_local_spectator_2_sq);
-                double Delta_2_cubic = Delta_2*Delta_2*Delta_2;
-                double A_1 = (sigma/2.*(z_local_spectator_1 - Delta_1)
-                                      *sinh_spectator_rap);
-                double A_2 = (sigma/2.*(z_local_spectator_2 + Delta_2)
-                                      *(-sinh_spectator_rap));
-                double exp_A_1 = exp(A_1);
-                double exp_A_2 = exp(A_2);
-                double common_integrand_E = (
-                    spectator_density_1[i][j]/(Delta_1_cubic + 1e-15)
-                      *(sigma/2.*sinh_spectator_rap*Delta_1 + 1.)*exp_A_1
-                    + spectator_density_2[i][j]/(Delta_2_cubic + 1e-15)
-                      *(sigma/2.*sinh_spectator_rap*Delta_2 + 1.)*exp_A_2
-                );
-                double common_integrand_B = (
-                    spectator_density_1[i][j]/(Delta_1_cubic + 1e-15)
-                    *(sigma/2.*sinh_spectator_rap*Delta_1 + 1.)*exp_A_1
-                    - spectator_density_2[i][j]/(Delta_2_cubic + 1e-15)
-                      *(sigma/2.*sinh_spectator_rap*Delta_2 + 1.)*exp_A_2
-                );
-
-                double Ex_integrand = x_local*common_integrand_E;
-                double Ey_integrand = y_local*common_integrand_E;
-                double Bx_integrand = -y_local*common_integrand_B;
-                double By_integrand = x_local*common_integrand_B;
-                
-                temp_sum_Ex_spectator += Ex_integrand;
-                temp_sum_Ey_spectator += Ey_integrand;
-                temp_sum_Bx_spectator += Bx_integrand;
-                temp_sum_By_spectator += By_integrand;
-            }
+            hash = Field_cache::hash_bytes(participant_density_1[i],
+                                           row_size, hash);
+            hash = Field_cache::hash_bytes(participant_density_2[i],
+                                           row_size, hash);
         }
-        
-        // compute contribution from participants
-        double temp_sum_Ex_participant = 0.0e0;
-        double temp_sum_Ey_participant = 0.0e0;
-        double temp_sum_Ez_participant = 0.0e0;
-        double temp_sum_Bx_participant = 0.0e0;
-        double temp_sum_By_participant = 0.0e0;
-        
-        if (include_participant_contributions == 1) {
-            for (int k = 0; k < participant_rapidity_integral_ny; k++) {
-                double rap_local = participant_rap_inte_y_array[k];
-                double sinh_participant_rap = sinh(rap_local);
-                double cosh_participant_rap = cosh(rap_local);
-
-                double exp_participant_rap_1 =
-                                        exp(participant_coeff_a*rap_local);
-                double exp_participant_rap_2 = exp_participant_rap_1;
-                double z_local_participant_1 =
-                                    field_tau*sinh(rap_local - field_eta);
-                double z_local_participant_2 = (
-                                    field_tau*sinh(-rap_local - field_eta));
-                double z_local_participant_1_sq = (z_local_participant_1
-                                                   *z_local_participant_1);
-                double z_local_participant_2_sq = (z_local_participant_2
-                                                   *z_local_participant_2);
-
-                double Ex_integrand = 0.0;
-                double Ey_integrand = 0.0;
-                double Bx_integrand = 0.0;
-                double By_integrand = 0.0;
-                for (int i = 0; i < nucleon_density_grid_size; i++) {
-                    double grid_x = nucleon_density_grid_x_array[i];
-                    for (int j = 0; j < nucleon_density_grid_size; j++) {
-                        double grid_y = nucleon_density_grid_y_array[j];
-                        double x_local = field_x - grid_x;
-                        double y_local = field_y - grid_y;
-                        double r_perp_local_sq = (
-                                        x_local*x_local + y_local*y_local);
-                        double Delta_1 = sqrt(r_perp_local_sq
-                                              + z_local_participant_1_sq);
-                        double Delta_1_cubic = Delta_1*Delta_1*Delta_1;
-                        double Delta_2 = sqrt(r_perp_local_sq
-                                              + z_local_participant_2_sq);
-                        double Delta_2_cubic = Delta_2*Delta_2*Delta_2;
-                        double A_1 = (sigma/2.
-                                *(z_local_participant_1*sinh_participant_rap
-                                  - fabs(sinh_participant_rap)*Delta_1));
-                        double A_2 = (sigma/2.
-                                *(z_local_participant_2*(-sinh_participant_rap)
-                                  - fabs(-sinh_participant_rap)*Delta_2));
-                        double exp_A_1 = exp(A_1);
-                        double exp_A_2 = exp(A_2);
-                        double common_integrand_E = (
-                            (participant_density_1[i][j]
-                             /(Delta_1_cubic + 1e-15)
-                             *(sigma/2.*fabs(sinh_participant_rap)*Delta_1 + 1.)
-                             *exp_A_1)*exp_participant_rap_1
-                          + (participant_density_2[i][j]
-                             /(Delta_2_cubic + 1e-15)
-                             *(sigma/2.*fabs(sinh_participant_rap)*Delta_2 + 1.)
-                             *exp_A_2)*exp_participant_rap_2);
-                        double common_integrand_B = (
-                            (participant_density_1[i][j]
-                             /(Delta_1_cubic + 1e-15)
-                             *(sigma/2.*fabs(sinh_participant_rap)*Delta_1 + 1.)
-                             *exp_A_1)*exp_participant_rap_1
-                          - (participant_density_2[i][j]
-                             /(Delta_2_cubic + 1e-15)
-                             *(sigma/2.*fabs(sinh_participant_rap)*Delta_2 + 1.)
-                             *exp_A_2)*exp_participant_rap_2);
-
-                        Ex_integrand += x_local*common_integrand_E;
-                        Ey_integrand += y_local*common_integrand_E;
-                        Bx_integrand += -y_local*common_integrand_B;
-                        By_integrand += x_local*common_integrand_B;
-                    }
-                }
-                temp_sum_Ex_participant += (Ex_integrand*cosh_participant_rap
-                                        *participant_rap_inte_weight_array[k]);
-                temp_sum_Ey_participant += (Ey_integrand*cosh_participant_rap
-                                        *participant_rap_inte_weight_array[k]);
-                temp_sum_Bx_participant += (Bx_integrand*sinh_participant_rap
-                                        *participant_rap_inte_weight_array[k]);
-                temp_sum_By_participant += (By_integrand*sinh_participant_rap
-                                        *participant_rap_inte_weight_array[k]);
+    }
+    return(hash);
+}
+
+uint64_t EM_fields::get_event_hash() {
+    // hash of the field engine and of the lattice interpolation, the
+    // lattice settings enter only if the lattice is used
+    double lattice_parameters[6] = {
+        static_cast<double>(field_lattice_mode != 0), 0.0, 0.0, 0.0, 0.0,
+        0.0};
+    if (field_lattice_mode != 0) {
+        for (int d = 0; d < 4; d++) {
+            lattice_parameters[1 + d] = field_lattice_spacing[d];
+        }
+        lattice_parameters[5] = field_lattice_order;
+    }
+    uint64_t hash = get_field_engine_hash();
+    return(Field_cache::hash_bytes(lattice_parameters,
+                                   sizeof(lattice_parameters), hash));
+}
+
+void EM_fields::calculate_EM_fields_with_cache() {
+    // this function reads the fields of the cells computed by earlier runs
+    // of the same event from the memory-mapped cache and only computes the
+    // missing cells, which are added to the cache afterwards
+    mkdir("./tables", 0755);
+    Field_cache cache("./tables", get_event_hash());
+    vector<int> missing_cells;
+    vector<uint64_t> missing_keys;
+    for (int i = 0; i < EM_fields_array_length; i++) {
+        fluidCell &cell = cell_list[i];
+        uint64_t key = Field_cache::hash_cell(cell.tau, cell.x, cell.y,
+                                              cell.eta);
+        double E[3], B[3];
+        if (cache.lookup(key, E, B)) {
+            cell.E_lab.x = E[0];
+            cell.E_lab.y = E[1];
+            cell.E_lab.z = E[2];
+            cell.B_lab.x = B[0];
+            cell.B_lab.y = B[1];
+            cell.B_lab.z = B[2];
+        } else {
+            missing_cells.push_back(i);
+            missing_keys.push_back(key);
+        }
+    }
+    int n_missing = missing_cells.size();
+    if (verbose_level > 1) {
+        cout << "field cache " << cache.get_filename() << ": "
+             << EM_fields_array_length - n_missing << " of "
+             << EM_fields_array_length << " cells cached" << endl;
+    }
+    if (n_missing == 0) {
+        return;
+    }
+
+    vector<fluidCell> all_cells;
+    all_cells.swap(cell_list);
+    cell_list.resize(n_missing);
+    for (int k = 0; k < n_missing; k++) {
+        cell_list[k] = all_cells[missing_cells[k]];
+    }
+    EM_fields_array_length = n_missing;
+    calculate_EM_fields_uncached();
+    vector<double> missing_fields(6*n_missing);
+    for (int k = 0; k < n_missing; k++) {
+        const fluidCell &cell = cell_list[k];
+        double cell_fields[6] = {cell.E_lab.x, cell.E_lab.y, cell.E_lab.z,
+                                 cell.B_lab.x, cell.B_lab.y, cell.B_lab.z};
+        copy(cell_fields, cell_fields + 6, &missing_fields[6*k]);
+        all_cells[missing_cells[k]].E_lab = cell.E_lab;
+        all_cells[missing_cells[k]].B_lab = cell.B_lab;
+    }
+    cell_list.swap(all_cells);
+    EM_fields_array_length = cell_list.size();
+    cache.store(missing_keys, missing_fields);
+}
+
+void EM_fields::calculate_EM_fields_uncached() {
+    if (field_lattice_mode != 0) {
+        calculate_EM_fields_on_lattice();
+    } else {
+        calculate_EM_fields_at_cells();
+    }
+}
+
+void EM_fields::calculate_EM_fields_on_lattice() {
+    // this function computes the EM fields on a regular lattice in
+    // (ln(tau), x, y, eta) covering the bounding box of the cells and
+    // interpolates them to the cells. Away from the spectator sheets the
+    // fields scale with powers of tau, so the lattice is uniform in ln(tau).
+    // Cells too close to the sheets for the stencil to resolve the fields
+    // are evaluated directly. The interpolation is checked against the
+    // field engine at field_lattice_check_points randomly drawn cells.
+    double lower[4], upper[4];
+    bool first_cell = true;
+    for (int i = 0; i < EM_fields_array_length; i++) {
+        if (cell_list[i].tau <= 0.0) {
+            continue;
+        }
+        double position[4];
+        get_lattice_position(cell_list[i], position);
+        for (int d = 0; d < 4; d++) {
+            if (first_cell || position[d] < lower[d]) lower[d] = position[d];
+            if (first_cell || position[d] > upper[d]) upper[d] = position[d];
+        }
+        first_cell = false;
+    }
+    if (first_cell) {
+        for (int d = 0; d < 4; d++) {
+            lower[d] = upper[d] = 0.0;
+        }
+    }
+    // the fields are determined by the sources, the medium and the kernel
+    // settings, the lattice file of the event is named by their hash
+    uint64_t event_hash = get_field_engine_hash();
+    Field_lattice lattice(lower, upper, field_lattice_spacing,
+                          field_lattice_order, event_hash);
+
+    vector<fluidCell> surface_cells;
+    surface_cells.swap(cell_list);
+    int n_cells = surface_cells.size();
+    vector<int> direct_cells, interpolated_cells;
+    for (int i = 0; i < n_cells; i++) {
+        if (lattice_resolves(&lattice, surface_cells[i])) {
+            interpolated_cells.push_back(i);
+        } else {
+            direct_cells.push_back(i);
+        }
+    }
+    int n_direct = direct_cells.size();
+    int n_interpolated = interpolated_cells.size();
+
+    ostringstream lattice_filename_stream;
+    lattice_filename_stream << "./tables/field_lattice_" << hex << setw(16)
+                            << setfill('0') << event_hash << ".dat";
+    string lattice_filename = lattice_filename_stream.str();
+    if (field_lattice_mode == 2) {
+        mkdir("./tables", 0755);
+        if (lattice.read_from_file(lattice_filename) && verbose_level > 1) {
+            cout << "read field lattice from " << lattice_filename << endl;
+        }
+    }
+    // only the nodes of the stencils of the interpolated cells are needed
+    long n_nodes = lattice.get_number_of_nodes();
+    vector<char> needed(n_nodes, 0);
+    for (int k = 0; k < n_interpolated; k++) {
+        double position[4];
+        get_lattice_position(surface_cells[interpolated_cells[k]], position);
+        lattice.mark_stencil_nodes(position, &needed[0]);
+    }
+    vector<long> computed_nodes;
+    long n_needed = 0;
+    for (long node = 0; node < n_nodes; node++) {
+        if (needed[node] == 1) {
+            n_needed++;
+            if (!lattice.has_node_fields(node)) {
+                computed_nodes.push_back(node);
             }
         }
+    }
+    if (verbose_level > 1) {
+        cout << "field lattice: " << lattice.get_number_of_points(0)
+             << " x " << lattice.get_number_of_points(1) << " x "
+             << lattice.get_number_of_points(2) << " x "
+             << lattice.get_number_of_points(3) << " nodes, " << n_needed
+             << " of them used by " << n_interpolated
+             << " interpolated cells, " << n_direct
+             << " cells next to the spectator sheets evaluated directly"
+             << endl;
+    }
+    if (computed_nodes.size() > 0) {
+        // the field engine runs on the missing nodes as its cells
+        int n_computed = computed_nodes.size();
+        cell_list.assign(n_computed, surface_cells[0]);
+        for (int k = 0; k < n_computed; k++) {
+            double position[4];
+            lattice.get_node_position(computed_nodes[k], position);
+            cell_list[k].tau = exp(position[0]);
+            cell_list[k].x = position[1];
+            cell_list[k].y = position[2];
+            cell_list[k].eta = position[3];
+        }
+        EM_fields_array_length = n_computed;
+        calculate_EM_fields_at_cells();
+        for (int k = 0; k < n_computed; k++) {
+            double E[3] = {cell_list[k].E_lab.x, cell_list[k].E_lab.y,
+                           cell_list[k].E_lab.z};
+            double B[3] = {cell_list[k].B_lab.x, cell_list[k].B_lab.y,
+                           cell_list[k].B_lab.z};
+            lattice.set_node_fields(computed_nodes[k], E, B);
+        }
+        if (field_lattice_mode == 2) {
+            lattice.write_to_file(lattice_filename);
+        }
+    }
 
-        cell_list[i_array].E_lab.x = (charge_fraction*alpha_EM
-            *(temp_sum_Ex_spectator*cosh_spectator_rap
-              + temp_sum_Ex_participant*participant_rapidity_envelop_coeff
-             )*dx_sq);
-        cell_list[i_array].E_lab.y = (charge_fraction*alpha_EM
-            *(temp_sum_Ey_spectator*cosh_spectator_rap
-              + temp_sum_Ey_participant*participant_rapidity_envelop_coeff
-             )*dx_sq);
-        cell_list[i_array].E_lab.z = (charge_fraction*alpha_EM
-            *(temp_sum_Ez_spectator
-              + temp_sum_Ez_participant*participant_rapidity_envelop_coeff
-             )*dx_sq);
-        cell_list[i_array].B_lab.x = (charge_fraction*alpha_EM
-            *(temp_sum_Bx_spectator*sinh_spectator_rap
-              + temp_sum_Bx_participant*participant_rapidity_envelop_coeff
-             )*dx_sq);
-        cell_list[i_array].B_lab.y = (charge_fraction*alpha_EM
-            *(temp_sum_By_spectator*sinh_spectator_rap
-              + temp_sum_By_participant*participant_rapidity_envelop_coeff
-             )*dx_sq);
-        cell_list[i_array].B_lab.z = 0.0;
-
-        // convert units to [GeV^2]
-        cell_list[i_array].E_lab.x *= hbarCsq;
-        cell_list[i_array].E_lab.y *= hbarCsq;
-        cell_list[i_array].E_lab.z *= hbarCsq;
-        cell_list[i_array].B_lab.x *= hbarCsq;
-        cell_list[i_array].B_lab.y *= hbarCsq;
-        cell_list[i_array].B_lab.z *= hbarCsq;
+    // interpolation to the cells
+    #pragma omp parallel for
+    for (int k = 0; k < n_interpolated; k++) {
+        fluidCell &cell = surface_cells[interpolated_cells[k]];
+        double position[4];
+        get_lattice_position(cell, position);
+        double E[3], B[3];
+        lattice.interpolate(position, E, B);
+        cell.E_lab.x = E[0];
+        cell.E_lab.y = E[1];
+        cell.E_lab.z = E[2];
+        cell.B_lab.x = B[0];
+        cell.B_lab.y = B[1];
+        cell.B_lab.z = B[2];
+    }
+
+    // direct evaluation at the cells near the spectator sheets and at the
+    // check points, which are drawn with a fixed seed
+    int n_check = min(field_lattice_check_points, n_interpolated);
+    vector<int> check_cells(n_check);
+    cell_list.resize(n_direct + n_check);
+    for (int k = 0; k < n_direct; k++) {
+        cell_list[k] = surface_cells[direct_cells[k]];
+    }
+    srand(1);
+    for (int k = 0; k < n_check; k++) {
+        check_cells[k] = interpolated_cells[static_cast<int>(
+            static_cast<double>(rand())/(RAND_MAX + 1.)*n_interpolated)];
+        cell_list[n_direct + k] = surface_cells[check_cells[k]];
+    }
+    if (n_direct + n_check > 0) {
+        EM_fields_array_length = n_direct + n_check;
+        calculate_EM_fields_at_cells();
+    }
+    for (int k = 0; k < n_direct; k++) {
+        surface_cells[direct_cells[k]].E_lab = cell_list[k].E_lab;
+        surface_cells[direct_cells[k]].B_lab = cell_list[k].B_lab;
+    }
+    double max_E = 0.0, max_B = 0.0;
+    double max_error_E = 0.0, max_error_B = 0.0;
+    for (int k = 0; k < n_check; k++) {
+        const fluidCell &exact = cell_list[n_direct + k];
+        const fluidCell &interpolated = surface_cells[check_cells[k]];
+        max_E = max(max_E, max(fabs(exact.E_lab.x), max(fabs(exact.E_lab.y),
+                                                       fabs(exact.E_lab.z))));
+        max_B = max(max_B, max(fabs(exact.B_lab.x), max(fabs(exact.B_lab.y),
+                                                       fabs(exact.B_lab.z))));
+        max_error_E = max(max_error_E, max(
+            fabs(interpolated.E_lab.x - exact.E_lab.x), max(
+            fabs(interpolated.E_lab.y - exact.E_lab.y),
+            fabs(interpolated.E_lab.z - exact.E_lab.z))));
+        max_error_B = max(max_error_B, max(
+            fabs(interpolated.B_lab.x - exact.B_lab.x), max(
+            fabs(interpolated.B_lab.y - exact.B_lab.y),
+            fabs(interpolated.B_lab.z - exact.B_lab.z))));
+    }
+    if (n_check > 0) {
+        cout << "field lattice: interpolation error on " << n_check
+             << " check points, |dE|/max|E| = "
+             << ((max_E > 0.0) ? max_error_E/max_E : 0.0)
+             << ", |dB|/max|B| = "
+             << ((max_B > 0.0) ? max_error_B/max_B : 0.0) << endl;
+    }
+
+    cell_list.swap(surface_cells);
+    EM_fields_array_length = cell_list.size();
+}
 
-        if (verbose_level > 3) {
-            if (omp_get_thread_num() == 0) {
-                count++;
-                int total_num_cells = static_cast<int>(EM_fields_array_length
-                                                       /omp_get_num_threads());
-                if (count % static_cast<int>(total_num_cells/10) == 0) {
-                    cout << "computing EM fields: " << setprecision(3)
-                         << (static_cast<double>(count)
-                             /static_cast<double>(total_num_cells)*100)
-                         << "\% done." << endl;
-                }
+void EM_fields::get_lattice_position(const fluidCell &cell,
+                                     double *position) {
+    position[0] = log(cell.tau);
+    position[1] = cell.x;
+    position[2] = cell.y;
+    position[3] = cell.eta;
+}
+
+bool EM_fields::lattice_resolves(Field_lattice *lattice,
+                                 const fluidCell &cell) {
+    // away from the spectator sheets the fields fall off with powers of the
+    // longitudinal distance z to the spectators, close to them they follow
+    // the transverse structure of the nuclei. The interpolation is used if
+    // z changes by less than a factor lattice_z_ratio over the stencil and
+    // its distance to both sheets exceeds the transverse stencil size.
+    const double lattice_z_ratio = 4.0;
+    if (cell.tau <= 0.0) {
+        return(false);
+    }
+    double position[4];
+    get_lattice_position(cell, position);
+    double stencil_lower[4], stencil_upper[4];
+    for (int d = 0; d < 4; d++) {
+        lattice->get_stencil_range(d, position[d], &stencil_lower[d],
+                                   &stencil_upper[d]);
+    }
+    double transverse_extent = max(stencil_upper[1] - stencil_lower[1],
+                                   stencil_upper[2] - stencil_lower[2]);
+    double tau_lower = exp(stencil_lower[0]);
+    double tau_upper = exp(stencil_upper[0]);
+    for (int n = 0; n < 2; n++) {
+        // |z_n| = tau*|sinh(+-spectator_rap - eta)| is monotonic in tau and
+        // eta on the stencil unless it crosses the sheet
+        double rap = (n == 0) ? spectator_rap : -spectator_rap;
+        double sinh_a = sinh(rap - stencil_lower[3]);
+        double sinh_b = sinh(rap - stencil_upper[3]);
+        if (sinh_a*sinh_b <= 0.0) {
+            return(false);
+        }
+        double z_min = tau_lower*min(fabs(sinh_a), fabs(sinh_b));
+        double z_max = tau_upper*max(fabs(sinh_a), fabs(sinh_b));
+        if (z_min < transverse_extent || z_max > lattice_z_ratio*z_min) {
+            return(false);
+        }
+    }
+    return(true);
+}
+
+void EM_fields::calculate_EM_fields_at_cells() {
+    // picks the instantiation of the field engine for the electric
+    // conductivity, the participant contributions and the precision of the
+    // spectator kernel, so that none of them is tested inside the loops
+    if (field_kernel_method == 1) {
+        calculate_EM_fields_FFT();
+        return;
+    }
+    vector<int> mirror_source;
+    set_up_computed_cells(&mirror_source);
+    bool conductive = (sigma > 0.0);
+    bool participants = (include_participant_contributions == 1);
+    if (kernel_precision == 32) {
+        if (conductive && participants) {
+            calculate_EM_fields_blocks<true, true>(spectator_sources_float);
+        } else if (conductive) {
+            calculate_EM_fields_blocks<true, false>(spectator_sources_float);
+        } else if (participants) {
+            calculate_EM_fields_blocks<false, true>(spectator_sources_float);
+        } else {
+            calculate_EM_fields_blocks<false, false>(
+                                                spectator_sources_float);
+        }
+    } else {
+        if (conductive && participants) {
+            calculate_EM_fields_blocks<true, true>(spectator_sources);
+        } else if (conductive) {
+            calculate_EM_fields_blocks<true, false>(spectator_sources);
+        } else if (participants) {
+            calculate_EM_fields_blocks<false, true>(spectator_sources);
+        } else {
+            calculate_EM_fields_blocks<false, false>(spectator_sources);
+        }
+    }
+    if (mirror_symmetric) {
+        // E is odd and B is even under the point reflection
+        for (int i = 0; i < EM_fields_array_length; i++) {
+            int i_source = mirror_source[i];
+            if (i_source < 0) {
+                continue;
             }
+            cell_list[i].E_lab.x = -cell_list[i_source].E_lab.x;
+            cell_list[i].E_lab.y = -cell_list[i_source].E_lab.y;
+            cell_list[i].E_lab.z = -cell_list[i_source].E_lab.z;
+            cell_list[i].B_lab = cell_list[i_source].B_lab;
         }
-        // clean up
-        delete[] participant_rap_inte_y_array;
-        delete[] participant_rap_inte_weight_array;
     }
-    #pragma omp barrier
+}
+
+void EM_fields::set_up_computed_cells(vector<int> *mirror_source) {
+    // this function selects the cells evaluated by the field engine. With
+    // the mirror symmetry a cell whose mirror point (tau, -x, -y, -eta) is
+    // an earlier cell of cell_list is filled from that cell afterwards and
+    // mirror_source holds the index of its partner (-1 otherwise).
+    const double mirror_resolution = 1e-6;
+    computed_cells.clear();
+    mirror_source->assign(EM_fields_array_length, -1);
+    if (!mirror_symmetric) {
+        for (int i = 0; i < EM_fields_array_length; i++) {
+            computed_cells.push_back(i);
+        }
+        group_computed_cells_by_position();
+        return;
     }
-    return;
+    map<pair<pair<long, long>, pair<long, long> >, int> cell_index;
+    for (int i = 0; i < EM_fields_array_length; i++) {
+        const fluidCell &cell = cell_list[i];
+        long key[4] = {lround(cell.tau/mirror_resolution),
+                       lround(cell.x/mirror_resolution),
+                       lround(cell.y/mirror_resolution),
+                       lround(cell.eta/mirror_resolution)};
+        map<pair<pair<long, long>, pair<long, long> >, int>::iterator it = (
+            cell_index.find(make_pair(make_pair(key[0], -key[1]),
+                                      make_pair(-key[2], -key[3]))));
+        if (it != cell_index.end() && it->second != i) {
+            (*mirror_source)[i] = it->second;
+            continue;
+        }
+        computed_cells.push_back(i);
+        cell_index.insert(make_pair(make_pair(make_pair(key[0], key[1]),
+                                              make_pair(key[2], key[3])), i));
+    }
+    if (verbose_level > 1) {
+        cout << "mirror symmetry: computing " << computed_cells.size()
+             << " of " << EM_fields_array_length << " cells" << endl;
+    }
+    group_computed_cells_by_position();
 }
 
-void EM_fields::calculate_EM_fields_no_electric_conductivity() {
-    // this function calculates E and B fields
-    double cosh_spectator_rap = cosh(spectator_rap);
-    double sinh_spectator_rap = sinh(spectator_rap);
+void EM_fields::group_computed_cells_by_position() {
+    // this function reorders computed_cells such that the cells at the same
+    // transverse position (x, y) are consecutive, keeping the order of
+    // their first appearance. The boost invariant surfaces and the tau
+    // scans of mode 2 give groups of n_eta and n_tau cells.
+    map<pair<double, double>, int> position_index;
+    vector<vector<int> > positions;
+    for (unsigned int i = 0; i < computed_cells.size(); i++) {
+        const fluidCell &cell = cell_list[computed_cells[i]];
+        pair<double, double> key = make_pair(cell.x, cell.y);
+        map<pair<double, double>, int>::iterator it = (
+                                                position_index.find(key));
+        if (it == position_index.end()) {
+            it = position_index.insert(
+                            make_pair(key, positions.size())).first;
+            positions.push_back(vector<int>());
+        }
+        positions[it->second].push_back(computed_cells[i]);
+    }
+    computed_cells.clear();
+    for (unsigned int k = 0; k < positions.size(); k++) {
+        computed_cells.insert(computed_cells.end(), positions[k].begin(),
+                              positions[k].end());
+    }
+    if (verbose_level > 1) {
+        cout << "field engine: " << computed_cells.size() << " cells at "
+             << positions.size() << " transverse positions" << endl;
+    }
+}
 
-    double dx_sq = nucleon_density_grid_dx*nucleon_density_grid_dx;
-    for (int i_array = 0; i_array < EM_fields_array_length; i_array++) {
-        double field_x = cell_list[i_array].x;
-        double field_y = cell_list[i_array].y;
-        double field_tau = cell_list[i_array].tau;
-        double field_eta = cell_list[i_array].eta;
-        double temp_sum_Ex_spectator = 0.0e0;
-        double temp_sum_Ey_spectator = 0.0e0;
-        double temp_sum_Ez_spectator = 0.0e0;
-        double temp_sum_Bx_spectator = 0.0e0;
-        double temp_sum_By_spectator = 0.0e0;
-
-        double z_local_spectator_1 = field_tau*sinh(field_eta - spectator_rap);
-        double z_local_spectator_2 = field_tau*sinh(field_eta + spectator_rap);
-        double z_local_spectator_1_sq = 
-                                    z_local_spectator_1*z_local_spectator_1;
-        double z_local_spectator_2_sq =
-                                    z_local_spectator_2*z_local_spectator_2;
+template <bool conductive, bool participants, typename source_list_type>
+void EM_fields::calculate_EM_fields_blocks(const source_list_type &sources) {
+    // this function computes the EM fields for blocks of cell_block_size
+    // fluid cells at once. For the direct sum the sources are streamed in
+    // tiles of source_tile_size points, and each tile is reused from the
+    // cache by all the cells of the block before the next tile is loaded.
+    // Only the order of the floating point additions differs from the cell
+    // by cell loop (relative differences ~1e-15). Consecutive cells at the
+    // same transverse position are passed to the group kernel, which
+    // computes the transverse distances once per source for all of them.
+    // The other kernel methods evaluate the cells of a block one by one.
+    // The blocks are distributed over the threads with the schedule set by
+    // omp_schedule, or as tasks of omp_chunk_size blocks.
+    int n_computed_cells = computed_cells.size();
+    int n_blocks = ((n_computed_cells + cell_block_size - 1)
+                    /cell_block_size);
+    int padded_length = sources.padded_length;
+    int tile_size = (cell_block_size > 1) ? source_tile_size : padded_length;
+    if (omp_schedule_policy == 1) {
+        omp_set_schedule(omp_sched_dynamic, omp_chunk_size);
+    } else if (omp_schedule_policy == 2) {
+        omp_set_schedule(omp_sched_guided, omp_chunk_size);
+    } else {
+        omp_set_schedule(omp_sched_static, omp_chunk_size);
+    }
+    int task_size = max(omp_chunk_size, 1);
+    vector<cell_block_workspace> workspaces(omp_get_max_threads());
+    double start_time = omp_get_wtime();
+    #pragma omp parallel
+    {
+    if (omp_get_thread_num() == 0) {
+        cout << "computing EM fields with " << omp_get_num_threads()
+             << " cpu cores";
+        if (field_kernel_method == 0) {
+            cout << ", " << cell_block_size << " cells x " << tile_size
+                 << " sources per tile";
+        }
+        cout << "..." << endl;
+    }
+    cell_block_workspace &workspace = workspaces[omp_get_thread_num()];
+    workspace.args = new spectator_kernel_args[cell_block_size];
+    workspace.sums = new double[n_spectator_sums*cell_block_size];
+    workspace.tile_sums = new double[n_spectator_sums*cell_block_size];
+    workspace.cells.resize(cell_block_size);
+    workspace.n_blocks = 0;
+    workspace.n_cells = 0;
+    workspace.busy_time = 0.0;
+    if (omp_schedule_policy == 3) {
+        // the tasks use the buffers of the threads running them
+        #pragma omp single
+        for (int i_task = 0; i_task < n_blocks; i_task += task_size) {
+            #pragma omp task firstprivate(i_task)
+            {
+            int i_end = min(i_task + task_size, n_blocks);
+            for (int i_block = i_task; i_block < i_end; i_block++) {
+                calculate_EM_fields_block<conductive, participants>(
+                    sources, i_block, tile_size,
+                    &workspaces[omp_get_thread_num()]);
+            }
+            }
+        }
+    } else {
+        #pragma omp for schedule(runtime)
+        for (int i_block = 0; i_block < n_blocks; i_block++) {
+            calculate_EM_fields_block<conductive, participants>(
+                            sources, i_block, tile_size, &workspace);
+        }
+    }
+    delete[] workspace.args;
+    delete[] workspace.sums;
+    delete[] workspace.tile_sums;
+    }
+    report_load_balance(workspaces, omp_get_wtime() - start_time);
+    return;
+}
 
-        for (int i = 0; i < nucleon_density_grid_size; i++) {
-            double grid_x = nucleon_density_grid_x_array[i];
-            for (int j = 0; j < nucleon_density_grid_size; j++) {
-                double grid_y = nucleon_density_grid_y_array[j];
-                double x_local = field_x - grid_x;
-                double y_local = field_y - grid_y;
-                double r_perp_local_sq = x_local*x_local + y_local*y_local;
-                double r_spectator_1 = sqrt(
-                                r_perp_local_sq + z_local_spectator_1_sq);
-                double r_cubic_spectator_1 = (r_spectator_1*r_spectator_1
-                                              *r_spectator_1);
-                double r_spectator_2 = sqrt(
-                                r_perp_local_sq + z_local_spectator_2_sq);
-                double r_cubic_spectator_2 = (r_spectator_2*r_spectator_2
-                                              *r_spectator_2);
-                double spectator_integrand_1 = (
-                                spectator_density_1[i][j]/r_cubic_spectator_1);
-                double spectator_integrand_2 = (
-                                spectator_density_2[i][j]/r_cubic_spectator_2);
-
-                double Ex_spectator_integrand = x_local*(
-                                spectator_integrand_1 + spectator_integrand_2);
-                double Ey_spectator_integrand = y_local*(
-                                spectator_integrand_1 + spectator_integrand_2);
-                double Ez_spectator_integrand = (
-                                  z_local_spectator_1*spectator_integrand_1
-                                + z_local_spectator_2*spectator_integrand_2);
-                double Bx_spectator_integrand = y_local*(
-                                spectator_integrand_1 - spectator_integrand_2);
-                double By_spectator_integrand = x_local*(
-                                spectator_integrand_1 - spectator_integrand_2);
-                temp_sum_Ex_spectator += Ex_spectator_integrand;
-                temp_sum_Ey_spectator += Ey_spectator_integrand;
-                temp_sum_Ez_spectator += Ez_spectator_integrand;
-                temp_sum_Bx_spectator += Bx_spectator_integrand;
-                temp_sum_By_spectator += By_spectator_integrand;
+template <bool conductive, bool participants, typename source_list_type>
+void EM_fields::calculate_EM_fields_block(const source_list_type &sources,
+                                          int i_block, int tile_size,
+                                          cell_block_workspace *workspace) {
+    double block_start_time = omp_get_wtime();
+    int n_computed_cells = computed_cells.size();
+    int padded_length = sources.padded_length;
+    int i_begin = i_block*cell_block_size;
+    int n_cells = min(cell_block_size, n_computed_cells - i_begin);
+    spectator_kernel_args *block_args = workspace->args;
+    double *block_sums = workspace->sums;
+    double *tile_sums = workspace->tile_sums;
+    vector<int> &group_begin = workspace->group_begin;
+    fluidCell **block_cells = &workspace->cells[0];
+    for (int i = 0; i < n_cells; i++) {
+        block_cells[i] = &cell_list[computed_cells[i_begin + i]];
+    }
+    if (field_kernel_method == 0 && radial_profile == NULL) {
+        group_begin.clear();
+        for (int i = 0; i < n_cells; i++) {
+            set_spectator_kernel_args(*block_cells[i], &block_args[i]);
+            for (int k = 0; k < n_spectator_sums; k++) {
+                block_sums[n_spectator_sums*i + k] = 0.0;
+            }
+            if (i == 0 || block_cells[i]->x != block_cells[i - 1]->x
+                || block_cells[i]->y != block_cells[i - 1]->y) {
+                group_begin.push_back(i);
+            }
+        }
+        group_begin.push_back(n_cells);
+        for (int tile_begin = 0; tile_begin < padded_length;
+             tile_begin += tile_size) {
+            int tile_end = min(tile_begin + tile_size, padded_length);
+            source_list_type tile = get_source_tile(sources, tile_begin,
+                                                    tile_end);
+            for (unsigned int g = 0; g + 1 < group_begin.size(); g++) {
+                spectator_kernel_group<conductive>(
+                    kernel_isa, tile, &block_args[group_begin[g]],
+                    group_begin[g + 1] - group_begin[g],
+                    &tile_sums[n_spectator_sums*group_begin[g]]);
+            }
+            for (int i = 0; i < n_spectator_sums*n_cells; i++) {
+                block_sums[i] += tile_sums[i];
             }
         }
-        cell_list[i_array].E_lab.x = (
-            hbarCsq*charge_fraction*alpha_EM
-            *cosh_spectator_rap*temp_sum_Ex_spectator*dx_sq);
-        cell_list[i_array].E_lab.y = (
-            hbarCsq*charge_fraction*alpha_EM
-            *cosh_spectator_rap*temp_sum_Ey_spectator*dx_sq);
-        cell_list[i_array].E_lab.z = (
-            hbarCsq*charge_fraction*alpha_EM*temp_sum_Ez_spectator*dx_sq);
-        cell_list[i_array].B_lab.x = (
-            hbarCsq*charge_fraction*alpha_EM
-            *((-sinh_spectator_rap)*temp_sum_Bx_spectator)*dx_sq);
-        cell_list[i_array].B_lab.y = (
-            hbarCsq*charge_fraction*alpha_EM
-            *(sinh_spectator_rap*temp_sum_By_spectator)*dx_sq);
-        cell_list[i_array].B_lab.z = 0.0;
+    } else {
+        for (int i = 0; i < n_cells; i++) {
+            compute_spectator_sums<conductive>(
+                *block_cells[i], &block_sums[n_spectator_sums*i]);
+        }
+    }
+    for (int i = 0; i < n_cells; i++) {
+        // compute contribution from participants
+        double participant_sums[4] = {0.0, 0.0, 0.0, 0.0};
+        if (participants) {
+            compute_participant_sums(*block_cells[i], participant_sums);
+        }
+        store_EM_fields(*block_cells[i], &block_sums[n_spectator_sums*i],
+                        participant_sums);
+    }
+    workspace->n_blocks++;
+    workspace->n_cells += n_cells;
+    workspace->busy_time += omp_get_wtime() - block_start_time;
 
-        if (verbose_level > 3) {
-            if (i_array % static_cast<int>(EM_fields_array_length/10) == 0) {
+    if (verbose_level > 3) {
+        if (omp_get_thread_num() == 0) {
+            int n_blocks = ((n_computed_cells + cell_block_size - 1)
+                            /cell_block_size);
+            int total_num_blocks = static_cast<int>(
+                                    n_blocks/omp_get_num_threads());
+            if (total_num_blocks >= 10
+                && workspace->n_blocks % (total_num_blocks/10) == 0) {
                 cout << "computing EM fields: " << setprecision(3)
-                     << (static_cast<double>(i_array)
-                         /static_cast<double>(EM_fields_array_length)*100)
+                     << (static_cast<double>(workspace->n_blocks)
+                         /static_cast<double>(total_num_blocks)*100)
                      << "\% done." << endl;
             }
         }
     }
-    return;
+}
+
+void EM_fields::report_load_balance(
+        const vector<cell_block_workspace> &workspaces, double wall_time) {
+    // the load imbalance is the largest busy time of the threads over their
+    // mean, 1 for a perfectly balanced schedule
+    int n_threads = workspaces.size();
+    double max_busy_time = 0.0;
+    double mean_busy_time = 0.0;
+    for (int i = 0; i < n_threads; i++) {
+        max_busy_time = max(max_busy_time, workspaces[i].busy_time);
+        mean_busy_time += workspaces[i].busy_time/n_threads;
+        if (verbose_level > 1) {
+            cout << "thread " << i << ": " << workspaces[i].n_cells
+                 << " cells in " << workspaces[i].n_blocks << " blocks, "
+                 << "busy " << workspaces[i].busy_time << " sec." << endl;
+        }
+    }
+    double imbalance = 1.0;
+    if (mean_busy_time > 0.0) {
+        imbalance = max_busy_time/mean_busy_time;
+    }
+    const char *schedule_names[] = {"static", "dynamic", "guided", "tasks"};
+    cout << "field engine: " << wall_time << " sec. on " << n_threads
+         << " threads, " << schedule_names[omp_schedule_policy]
+         << " schedule, load imbalance (max/mean busy time) = "
+         << imbalance << endl;
+}
+
+void EM_fields::calculate_EM_fields_FFT() {
+    // this function computes the spectator fields slice by slice in
+    // (tau, eta) with FFT convolutions over the transverse density grid
+    // cells off the density grid fall back to the direct sum
+    cout << "computing EM fields with FFT convolutions on "
+         << omp_get_max_threads() << " cpu cores..." << endl;
+
+    // locate the cells on the density grid and the window they cover
+    vector<int> grid_idx_x(EM_fields_array_length, -1);
+    vector<int> grid_idx_y(EM_fields_array_length, -1);
+    int i_min = nucleon_density_grid_size;
+    int i_max = -1;
+    int j_min = nucleon_density_grid_size;
+    int j_max = -1;
+    map<pair<double, double>, vector<int> > slices;
+    for (int i = 0; i < EM_fields_array_length; i++) {
+        slices[make_pair(cell_list[i].tau, cell_list[i].eta)].push_back(i);
+        int i_x = static_cast<int>(floor(
+            (cell_list[i].x - nucleon_density_grid_x_array[0])
+            /nucleon_density_grid_dx + 0.5));
+        int i_y = static_cast<int>(floor(
+            (cell_list[i].y - nucleon_density_grid_y_array[0])
+            /nucleon_density_grid_dx + 0.5));
+        if (i_x < 0 || i_x >= nucleon_density_grid_size
+            || i_y < 0 || i_y >= nucleon_density_grid_size) {
+            continue;
+        }
+        if (fabs(nucleon_density_grid_x_array[i_x] - cell_list[i].x) > 1e-8
+            || fabs(nucleon_density_grid_y_array[i_y] - cell_list[i].y)
+               > 1e-8) {
+            continue;
+        }
+        grid_idx_x[i] = i_x;
+        grid_idx_y[i] = i_y;
+        i_min = min(i_min, i_x);
+        i_max = max(i_max, i_x);
+        j_min = min(j_min, i_y);
+        j_max = max(j_max, i_y);
+    }
+    if (i_max < 0) {
+        i_min = i_max = j_min = j_max = 0;
+    }
+    FFT_convolution fft_engine(nucleon_density_grid_size,
+                               nucleon_density_grid_dx,
+                               spectator_density_1, spectator_density_2,
+                               i_min, i_max, j_min, j_max);
+
+    double sinh_spectator_rap = sinh(spectator_rap);
+    int count = 0;
+    for (map<pair<double, double>, vector<int> >::iterator it =
+            slices.begin(); it != slices.end(); ++it) {
+        double field_tau = it->first.first;
+        double field_eta = it->first.second;
+        double z_local_spectator_1 = field_tau*sinh(spectator_rap - field_eta);
+        double z_local_spectator_2 = (
+                                field_tau*sinh(-spectator_rap - field_eta));
+        fft_engine.compute_slice(z_local_spectator_1, z_local_spectator_2,
+                                 sigma, sinh_spectator_rap);
+
+        vector<int> &slice_cells = it->second;
+        int n_slice_cells = slice_cells.size();
+        #pragma omp parallel for
+        for (int k = 0; k < n_slice_cells; k++) {
+            int i_cell = slice_cells[k];
+            fluidCell &cell = cell_list[i_cell];
+            double spectator_sums[n_spectator_sums];
+            if (grid_idx_x[i_cell] >= 0) {
+                fft_engine.get_sums(grid_idx_x[i_cell], grid_idx_y[i_cell],
+                                    spectator_sums);
+                spectator_sums[4] = 0.0;
+            } else {
+                compute_spectator_sums<true>(cell, spectator_sums);
+            }
+            double participant_sums[4] = {0.0, 0.0, 0.0, 0.0};
+            if (include_participant_contributions == 1) {
+                compute_participant_sums(cell, participant_sums);
+            }
+            store_EM_fields(cell, spectator_sums, participant_sums);
+        }
+
+        count++;
+        if (verbose_level > 3) {
+            cout << "computing EM fields: slice " << count << " of "
+                 << slices.size() << " done." << endl;
+        }
+    }
+}
+
+void EM_fields::set_spectator_kernel_args(const fluidCell &cell,
+                                          spectator_kernel_args *args) {
+    args->field_x = cell.x;
+    args->field_y = cell.y;
+    args->z_1 = cell.tau*sinh(spectator_rap - cell.eta);
+    args->z_2 = cell.tau*sinh(-spectator_rap - cell.eta);
+    args->sigma = sigma;
+    args->sinh_spectator_rap = sinh(spectator_rap);
+}
+
+template <bool conductive>
+void EM_fields::compute_spectator_sums(const fluidCell &cell, double *sums) {
+    // sums = {Ex, Ey, Bx, By, Ez} integrands of the spectators summed over
+    // the transverse source points
+    spectator_kernel_args spectator_args;
+    set_spectator_kernel_args(cell, &spectator_args);
+    if (radial_profile != NULL
+        && radial_profile->resolves(spectator_args.z_1, spectator_args.z_2)) {
+        radial_profile->spectator_sums<conductive>(kernel_isa,
+                                                   spectator_args, sums);
+        return;
+    }
+    if (field_kernel_method == 2) {
+        // far nodes of the quadtree are replaced by their quadrupole
+        // pseudo-particles
+        source_list &interactions = tree_interactions[omp_get_thread_num()];
+        spectator_tree->collect_interactions(
+            cell.x, cell.y, spectator_args.z_1, spectator_args.z_2,
+            sigma/2.*spectator_args.sinh_spectator_rap, tree_opening_angle,
+            &interactions);
+        spectator_kernel<conductive>(kernel_isa, interactions,
+                                     spectator_args, sums);
+        return;
+    }
+    if (field_kernel_method == 3) {
+        // cells outside the range of the table use the direct sum
+        double r_perp_max = (sqrt(cell.x*cell.x + cell.y*cell.y)
+                             + spectator_source_radius);
+        if (spectator_kernel_table->covers(spectator_args.z_1)
+            && spectator_kernel_table->covers(spectator_args.z_2)
+            && r_perp_max*r_perp_max
+               < spectator_kernel_table->get_r_sq_max()) {
+            double *slice_1 = kernel_table_slices[omp_get_thread_num()];
+            double *slice_2 = (slice_1
+                               + spectator_kernel_table->get_slice_length());
+            spectator_kernel_table->fill_slice(spectator_args.z_1, slice_1);
+            spectator_kernel_table->fill_slice(-spectator_args.z_2, slice_2);
+            spectator_kernel_table->spectator_sums(
+                kernel_isa, spectator_sources, cell.x, cell.y, slice_1,
+                slice_2, sums);
+            sums[4] = 0.0;
+            return;
+        }
+    }
+    if (kernel_precision == 32) {
+        spectator_kernel<conductive>(kernel_isa, spectator_sources_float,
+                                     spectator_args, sums);
+        return;
+    }
+    spectator_kernel<conductive>(kernel_isa, spectator_sources,
+                                 spectator_args, sums);
+}
+
+void EM_fields::check_single_precision_kernel() {
+    // compares the float32 spectator kernel with the double precision one
+    // on a sample of the cells and falls back to double precision if they
+    // deviate by more than single_precision_tolerance relative to the
+    // largest double precision sum
+    const int n_samples = min(64, EM_fields_array_length);
+    const double single_precision_tolerance = 1e-3;
+    double max_sum = 0.0;
+    double max_deviation = 0.0;
+    for (int i_sample = 0; i_sample < n_samples; i_sample++) {
+        const fluidCell &cell = cell_list[
+                static_cast<long>(i_sample)*EM_fields_array_length/n_samples];
+        spectator_kernel_args spectator_args;
+        set_spectator_kernel_args(cell, &spectator_args);
+        double sums[n_spectator_sums], sums_float[n_spectator_sums];
+        if (sigma > 0.0) {
+            spectator_kernel<true>(kernel_isa, spectator_sources,
+                                   spectator_args, sums);
+            spectator_kernel<true>(kernel_isa, spectator_sources_float,
+                                   spectator_args, sums_float);
+        } else {
+            spectator_kernel<false>(kernel_isa, spectator_sources,
+                                    spectator_args, sums);
+            spectator_kernel<false>(kernel_isa, spectator_sources_float,
+                                    spectator_args, sums_float);
+        }
+        for (int k = 0; k < n_spectator_sums; k++) {
+            max_sum = max(max_sum, fabs(sums[k]));
+            max_deviation = max(max_deviation,
+                                fabs(sums_float[k] - sums[k]));
+        }
+    }
+    double relative_deviation = (
+            (max_sum > 0.0) ? max_deviation/max_sum : 0.0);
+    if (verbose_level > 1) {
+        cout << "float32 spectator kernel: max relative deviation = "
+             << relative_deviation << " on " << n_samples << " cells"
+             << endl;
+    }
+    if (relative_deviation > single_precision_tolerance) {
+        cout << "EM_fields:: Warning: float32 spectator kernel deviates by "
+             << relative_deviation << " > " << single_precision_tolerance
+             << ", switching back to double precision!" << endl;
+        free_source_list_float(&spectator_sources_float);
+        kernel_precision = 64;
+    }
+}
+
+void EM_fields::compute_participant_sums(const fluidCell &cell,
+                                         double *sums) {
+    // sums = {Ex, Ey, Bx, By} integrands of the participants integrated
+    // over their rapidity distribution
+    double *node_buffer = participant_node_buffers[omp_get_thread_num()];
+    double *z_1_sq = node_buffer;
+    double *z_2_sq = node_buffer + participant_n_nodes;
+    double *exp_offset_1 = node_buffer + 2*participant_n_nodes;
+    double *exp_offset_2 = node_buffer + 3*participant_n_nodes;
+    for (int k = 0; k < participant_n_nodes; k++) {
+        double rap_local = participant_rap_array[k];
+        double z_local_participant_1 = cell.tau*sinh(rap_local - cell.eta);
+        double z_local_participant_2 = cell.tau*sinh(-rap_local - cell.eta);
+        z_1_sq[k] = z_local_participant_1*z_local_participant_1;
+        z_2_sq[k] = z_local_participant_2*z_local_participant_2;
+        exp_offset_1[k] = (sigma/2.*z_local_participant_1
+                           *participant_sinh_rap_array[k]);
+        exp_offset_2[k] = (sigma/2.*z_local_participant_2
+                           *(-participant_sinh_rap_array[k]));
+    }
+    participant_kernel_args participant_args;
+    participant_args.field_x = cell.x;
+    participant_args.field_y = cell.y;
+    participant_args.n_nodes = participant_n_nodes;
+    participant_args.z_1_sq = z_1_sq;
+    participant_args.z_2_sq = z_2_sq;
+    participant_args.exp_offset_1 = exp_offset_1;
+    participant_args.exp_offset_2 = exp_offset_2;
+    participant_args.c = participant_c_array;
+    participant_args.weight_E = participant_weight_E_array;
+    participant_args.weight_B = participant_weight_B_array;
+    if (participant_kernel_method != 1) {
+        participant_kernel(kernel_isa, participant_sources, participant_args,
+                           sums);
+        return;
+    }
+
+    // the table spans from the nearest grid point to the farthest source
+    double r_sq_nearest = 0.0;
+    double field[2] = {cell.x, cell.y};
+    for (int d = 0; d < 2; d++) {
+        int i_grid = static_cast<int>(floor(
+            (field[d] - nucleon_density_grid_x_array[0])
+            /nucleon_density_grid_dx + 0.5));
+        i_grid = min(max(i_grid, 0), nucleon_density_grid_size - 1);
+        double distance = field[d] - nucleon_density_grid_x_array[i_grid];
+        r_sq_nearest += distance*distance;
+    }
+    if (r_sq_nearest < pow(2., -60)) {
+        // the source at the cell position has x_local = y_local = 0
+        r_sq_nearest = nucleon_density_grid_dx*nucleon_density_grid_dx;
+    }
+    double r_perp_max = (sqrt(cell.x*cell.x + cell.y*cell.y)
+                         + participant_source_radius);
+    int exponent_min, exponent_max;
+    frexp(r_sq_nearest/2., &exponent_min);
+    frexp(r_perp_max*r_perp_max + 1e-6, &exponent_max);
+    participant_kernel_table &table = (
+                            participant_tables[omp_get_thread_num()]);
+    fill_participant_kernel_table(kernel_isa, participant_args,
+                                  ldexp(1., exponent_min - 1),
+                                  ldexp(1., exponent_max), &table);
+    participant_table_kernel(participant_sources, participant_args, table,
+                             sums);
+}
+
+void EM_fields::store_EM_fields(fluidCell &cell, double *spectator_sums,
+                                double *participant_sums) {
+    // combine the summed integrands into the lab frame E and B fields
+    double cosh_spectator_rap = cosh(spectator_rap);
+    double sinh_spectator_rap = sinh(spectator_rap);
+    double participant_rapidity_envelop_coeff =
+        participant_coeff_a/(2.*sinh(participant_coeff_a*spectator_rap));
+    double dx_sq = nucleon_density_grid_dx*nucleon_density_grid_dx;
+
+    double temp_sum_Ex_spectator = spectator_sums[0];
+    double temp_sum_Ey_spectator = spectator_sums[1];
+    double temp_sum_Ez_spectator = spectator_sums[4];
+    double temp_sum_Bx_spectator = spectator_sums[2];
+    double temp_sum_By_spectator = spectator_sums[3];
+    double temp_sum_Ex_participant = participant_sums[0];
+    double temp_sum_Ey_participant = participant_sums[1];
+    double temp_sum_Ez_participant = 0.0e0;
+    double temp_sum_Bx_participant = participant_sums[2];
+    double temp_sum_By_participant = participant_sums[3];
+
+    cell.E_lab.x = (charge_fraction*alpha_EM
+        *(temp_sum_Ex_spectator*cosh_spectator_rap
+          + temp_sum_Ex_participant*participant_rapidity_envelop_coeff
+         )*dx_sq);
+    cell.E_lab.y = (charge_fraction*alpha_EM
+        *(temp_sum_Ey_spectator*cosh_spectator_rap
+          + temp_sum_Ey_participant*participant_rapidity_envelop_coeff
+         )*dx_sq);
+    cell.E_lab.z = (charge_fraction*alpha_EM
+        *(temp_sum_Ez_spectator
+          + temp_sum_Ez_participant*participant_rapidity_envelop_coeff
+         )*dx_sq);
+    cell.B_lab.x = (charge_fraction*alpha_EM
+        *(temp_sum_Bx_spectator*sinh_spectator_rap
+          + temp_sum_Bx_participant*participant_rapidity_envelop_coeff
+         )*dx_sq);
+    cell.B_lab.y = (charge_fraction*alpha_EM
+        *(temp_sum_By_spectator*sinh_spectator_rap
+          + temp_sum_By_participant*participant_rapidity_envelop_coeff
+         )*dx_sq);
+    cell.B_lab.z = 0.0;
+
+    // convert units to [GeV^2]
+    cell.E_lab.x *= hbarCsq;
+    cell.E_lab.y *= hbarCsq;
+    cell.E_lab.z *= hbarCsq;
+    cell.B_lab.x *= hbarCsq;
+    cell.B_lab.y *= hbarCsq;
+    cell.B_lab.z *= hbarCsq;
 }
 
 void EM_fields::output_EM_fields(string filename) {
@@ -6,6 +6,14 @@
 #include <vector>
 
 #include "./ParameterReader.h"
+#include "./field_kernels.h"
+#include "./source_tree.h"
+#include "./kernel_table.h"
+#include "./radial_profile.h"
+#include "./field_lattice.h"
+#include "./field_cache.h"
+#include "./phase_timer.h"
+#include "./density_reader.h"
 
 using namespace std;
 
@@ -28,6 +36,16 @@ struct fluidCell {
     vector4 drift_u_minus_2;
 };
 
+// buffers of one thread of the field engine and its cost accounting
+struct cell_block_workspace {
+    spectator_kernel_args *args;
+    double *sums, *tile_sums;
+    vector<int> group_begin;
+    vector<fluidCell*> cells;
+    long n_blocks, n_cells;     // blocks and cells computed by the thread
+    double busy_time;           // time spent in the blocks [s]
+};
+
 class EM_fields {
  private:
     int debug_flag;
@@ -37,9 +55,13 @@ class EM_fields {
     int initialization_status;
     int include_participant_contributions;
     ParameterReader *paraRdr;
+    Phase_timer *timer;
 
     int nucleon_density_grid_size;
     double nucleon_density_grid_dx;
+    // the grid of parameters.dat, used by the events without a container
+    int parameter_grid_size;
+    double parameter_grid_dx;
     // matrices stored the charge density in the transverse plane from the
     // two colliding nuclei, spectators and participants
     double *nucleon_density_grid_x_array, *nucleon_density_grid_y_array;
@@ -49,22 +71,109 @@ class EM_fields {
     double **spectator_density_1, **spectator_density_2;
     double **participant_density_1, **participant_density_2;
 
+    // contiguous copies of the spectator densities for the field kernels
+    source_list spectator_sources;
+    double spectator_source_radius;     // largest |r_perp| of the sources
+    source_list participant_sources;
+    double participant_source_radius;
+    int kernel_isa;
+
+    // rapidity quadrature of the participants, padded with zero-weight
+    // nodes to a multiple of kernel_simd_width
+    double participant_coeff_a;
+    int participant_rapidity_integral_ny;
+    int participant_n_nodes;
+    double *participant_sinh_rap_array;
+    double *participant_c_array;        // sigma/2*|sinh(y_k)|
+    double *participant_weight_E_array, *participant_weight_B_array;
+    double *participant_rap_array;
+    vector<double*> participant_node_buffers;   // one per thread
+    // 0: rapidity quadrature for every source; 1: rapidity-integrated
+    // kernels tabulated on r_perp^2 for every cell
+    int participant_kernel_method;
+    vector<participant_kernel_table> participant_tables;    // one per thread
+
     // arraies for the space-time points of the EM fields
     int EM_fields_array_length;
     vector<fluidCell> cell_list;
 
     double charge_fraction;
     double spectator_rap;
+    double sigma;               // electric conductivity [1/fm]
+
+    // 0: direct sum over sources; 1: FFT convolution on transverse slices
+    // 2: Barnes-Hut quadtree; 3: tabulated kernel
+    int field_kernel_method;
+    double tree_opening_angle;
+    Source_quadtree *spectator_tree;
+    vector<source_list> tree_interactions;      // one list per thread
+    Kernel_table *spectator_kernel_table;
+    vector<double*> kernel_table_slices;        // one pair per thread
+
+    // 64: double precision spectator kernel; 32: float32 kernel with
+    // compensated sums for the direct sum, checked against 64 at start-up
+    int kernel_precision;
+    source_list_float spectator_sources_float;
+
+    // the direct sum is evaluated for blocks of cells against tiles of
+    // sources that stay in the cache, source_tile_size <= 0 selects the
+    // tile size from the L2 cache size
+    int cell_block_size;
+    int source_tile_size;
+    // distribution of the blocks over the threads, 0: static; 1: dynamic;
+    // 2: guided; 3: task queue. omp_chunk_size blocks are handed out at a
+    // time (0: OpenMP default, one block per task)
+    int omp_schedule_policy;
+    int omp_chunk_size;
+
+    // point reflection (x, y, eta) -> (-x, -y, -eta) exchanges the two
+    // nuclei when their densities are mirror images, E is odd and B is even
+    int mirror_symmetry;            // -1: detect; 0: off; 1: force
+    bool mirror_symmetric;
+    vector<int> computed_cells;     // cells evaluated by the field engine
+
+    // spectator densities depending only on the distance from the center
+    // of the grid are summed over radial and angular quadrature nodes
+    int radial_symmetry;            // -1: detect; 0: off; 1: force
+    Radial_profile *radial_profile;
+
+    // 0: fields at every cell; 1: fields on a (ln(tau), x, y, eta) lattice
+    // covering the cells, interpolated to the cells; 2: as 1 and the
+    // lattice is reused from/stored in ./tables
+    int field_lattice_mode;
+    double field_lattice_spacing[4];    // largest ln(tau), x, y, eta steps
+    int field_lattice_order;
+    int field_lattice_check_points;
+
+    // 1: fields of cells computed in earlier runs of the same event are
+    // read from ./tables
+    int field_cache_mode;
 
  public:
-    explicit EM_fields(ParameterReader* paraRdr_in);
+    EM_fields(ParameterReader* paraRdr_in, string event_path,
+              Phase_timer *timer_in);
     ~EM_fields();
 
+    // replaces the densities and cells with the ones of the event in
+    // event_path
+    void load_event(string event_path);
+    int get_number_of_cells() {return(EM_fields_array_length);}
+    // source points entering the direct sum of every cell
+    int get_number_of_sources();
+    const fluidCell &get_cell(int i) {return(cell_list[i]);}
+    // keeps only the cells with the given indices, in that order
+    void select_cells(const vector<int> &indices);
     void set_4d_grid_points();
     void set_tau_grid_points(double x_local, double y_local, double eta_local);
+    void allocate_density_grid();
+    void free_density_grid();
+    // reallocates the density grid if grid_size or grid_dx differ from it
+    void set_density_grid(int grid_size, double grid_dx);
     void read_in_densities(string path);
-    void read_in_spectators_density(string filename_1, string filename_2);
-    void read_in_participant_density(string filename_1, string filename_2);
+    void read_in_density_container(string filename,
+                                   const density_container_header &header);
+    void build_source_lists();
+    void set_up_participant_quadrature();
     void read_in_freezeout_surface_points_VISH2p1(string filename1,
                                                   string filename2);
     void read_in_freezeout_surface_points_Gubser(string filename);
@@ -72,7 +181,34 @@ class EM_fields {
                                                             string filename);
     void read_in_freezeout_surface_points_MUSIC(string filename);
     void calculate_EM_fields();
-    void calculate_EM_fields_no_electric_conductivity();
+    uint64_t get_field_engine_hash();
+    uint64_t get_event_hash();
+    void calculate_EM_fields_with_cache();
+    void calculate_EM_fields_uncached();
+    void calculate_EM_fields_at_cells();
+    void calculate_EM_fields_on_lattice();
+    void get_lattice_position(const fluidCell &cell, double *position);
+    bool lattice_resolves(Field_lattice *lattice, const fluidCell &cell);
+    void calculate_EM_fields_FFT();
+    bool detect_mirror_symmetry();
+    void set_up_computed_cells(vector<int> *mirror_source);
+    void group_computed_cells_by_position();
+    template <bool conductive, bool participants, typename source_list_type>
+    void calculate_EM_fields_blocks(const source_list_type &sources);
+    template <bool conductive, bool participants, typename source_list_type>
+    void calculate_EM_fields_block(const source_list_type &sources,
+                                   int i_block, int tile_size,
+                                   cell_block_workspace *workspace);
+    void report_load_balance(const vector<cell_block_workspace> &workspaces,
+                             double wall_time);
+    void set_spectator_kernel_args(const fluidCell &cell,
+                                   spectator_kernel_args *args);
+    template <bool conductive>
+    void compute_spectator_sums(const fluidCell &cell, double *sums);
+    void compute_participant_sums(const fluidCell &cell, double *sums);
+    void check_single_precision_kernel();
+    void store_EM_fields(fluidCell &cell, double *spectator_sums,
+                         double *participant_sums);
     void calculate_charge_drifting_velocity();
     void output_EM_fields(string filename);
     void output_surface_file_with_drifting_velocity(string filename);
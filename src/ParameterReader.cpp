@@ -163,6 +163,20 @@ double ParameterReader::getVal(string name) {
 }
 
 
+//----------------------------------------------------------------------
+double ParameterReader::getVal(string name, double default_value) {
+/*
+  Get the value for the parameter with "name", or default_value if the
+  parameter is not registered.
+*/
+    long idx = find(name);
+    if (idx!=-1) {
+        return (*values)[idx];
+    }
+    return default_value;
+}
+
+
 //----------------------------------------------------------------------
 void ParameterReader::echo() {
 /*
@@ -50,6 +50,8 @@ class ParameterReader {
     void setVal(string name, double value);
 
     double getVal(string name);  // return the value for parameter with "name"
+    // value of "name", default_value if it is not set
+    double getVal(string name, double default_value);
 
     void echo();  // print out all parameters to the screen
 
@@ -2,16 +2,33 @@
 #ifndef SRC_STOPWATCH_H_
 #define SRC_STOPWATCH_H_
 
-#include <ctime>
+#include <time.h>
 
+// measures the elapsed wall-clock time on the monotonic clock and the CPU
+// time of the process, which sums up all threads
 class Stopwatch {
  private:
-    time_t start, end;
+    double start_wall, end_wall;
+    double start_cpu, end_cpu;
+
+    static double read_clock(clockid_t clock_id) {
+        struct timespec now;
+        clock_gettime(clock_id, &now);
+        return(now.tv_sec + 1e-9*now.tv_nsec);
+    }
+
  public:
-    Stopwatch() {start = clock(); end = 0;}
-    void tic() {start = clock();}
-    void toc() {end = clock();}
-    double takeTime() {return(static_cast<double>(end - start))/CLOCKS_PER_SEC;}
+    Stopwatch() {tic(); end_wall = start_wall; end_cpu = start_cpu;}
+    void tic() {
+        start_wall = read_clock(CLOCK_MONOTONIC);
+        start_cpu = read_clock(CLOCK_PROCESS_CPUTIME_ID);
+    }
+    void toc() {
+        end_wall = read_clock(CLOCK_MONOTONIC);
+        end_cpu = read_clock(CLOCK_PROCESS_CPUTIME_ID);
+    }
+    double takeTime() {return(end_wall - start_wall);}
+    double takeCPUTime() {return(end_cpu - start_cpu);}
 };
 
 #endif  // SRC_STOPWATCH_H_
@@ -24,6 +41,6 @@ class Stopwatch {
     sw.tic();
     **** code ****
     sw.toc();
-  And the result can be outputted using:
-    cout << sw.takeTime() << endl;
+  And the wall-clock and CPU times can be outputted using:
+    cout << sw.takeTime() << " " << sw.takeCPUTime() << endl;
 -----------------------------------------------------------------------*/
@@ -0,0 +1,250 @@
+/////////////////////////////////////////////////////////////////////////
+//              Benchmark of the EM field kernels
+//
+//              author: Chun Shen <chunshen@physics.mcgill.ca>
+//              Copyright 2016 Chun Shen
+//
+//  Usage: EM_fields_benchmark.e [key=value ...]
+//
+//  Generates a synthetic Au+Au event with Woods-Saxon nuclei in
+//  ./benchmark_event and times, with the kernel settings of
+//  parameters.dat and the command line,
+//   - calculate_EM_fields() with the spectators only,
+//   - the participant contributions (the difference to the run with
+//     include_participant_contributions = 1),
+//   - calculate_charge_drifting_velocity(),
+//   - Lorentz_boost_EM_fields() and Lorentz_boost_EM_fields_tensor().
+//  The best of benchmark_repeats runs is reported in ns per interaction
+//  (cell-source pair) or per cell and boost, on screen and in
+//  ./benchmark.json.
+//
+//  Parameters (optional): benchmark_surface_points (1000),
+//  benchmark_impact_parameter (8 fm), benchmark_repeats (3),
+//  benchmark_boosts (10^6) and nucleon_density_grid_size/_dx.
+//
+/////////////////////////////////////////////////////////////////////////
+
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <omp.h>
+
+#include <iostream>
+#include <fstream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+#include "./Stopwatch.h"
+#include "./EM_fields.h"
+#include "./ParameterReader.h"
+#include "./phase_timer.h"
+#include "./synthetic_event.h"
+
+using namespace std;
+
+struct benchmark_result {
+    string name;
+    string unit;                // what one operation is
+    double seconds;             // best of the repeats
+    double operations;
+};
+
+static double time_EM_fields(EM_fields *EM, int n_repeats) {
+    double best_time = 0.0;
+    for (int i = 0; i < n_repeats; i++) {
+        Stopwatch sw;
+        EM->calculate_EM_fields();
+        sw.toc();
+        if (i == 0 || sw.takeTime() < best_time) {
+            best_time = sw.takeTime();
+        }
+    }
+    return(best_time);
+}
+
+static double time_drifting_velocity(EM_fields *EM, int n_repeats) {
+    double best_time = 0.0;
+    for (int i = 0; i < n_repeats; i++) {
+        Stopwatch sw;
+        EM->calculate_charge_drifting_velocity();
+        sw.toc();
+        if (i == 0 || sw.takeTime() < best_time) {
+            best_time = sw.takeTime();
+        }
+    }
+    return(best_time);
+}
+
+// times n_boosts boosts of random fields with the vector (tensor = false)
+// or the field tensor implementation
+static double time_lorentz_boosts(EM_fields *EM, bool tensor, int n_boosts,
+                                  int n_repeats, double *checksum) {
+    const int n_samples = 1024;
+    vector<double> fields(9*n_samples);
+    srand(1);
+    for (int k = 0; k < n_samples; k++) {
+        for (int l = 0; l < 6; l++) {
+            fields[9*k + l] = 2.*rand()/(RAND_MAX + 1.) - 1.;
+        }
+        // |beta| < 0.9
+        for (int l = 6; l < 9; l++) {
+            fields[9*k + l] = 1.04*(rand()/(RAND_MAX + 1.) - 0.5);
+        }
+    }
+    double best_time = 0.0;
+    *checksum = 0.0;
+    for (int i = 0; i < n_repeats; i++) {
+        double sum = 0.0;
+        Stopwatch sw;
+        for (int n = 0; n < n_boosts; n++) {
+            double *sample = &fields[9*(n % n_samples)];
+            double E_prime[3], B_prime[3];
+            if (tensor) {
+                EM->Lorentz_boost_EM_fields_tensor(sample, sample + 3,
+                                                   sample + 6, E_prime,
+                                                   B_prime);
+            } else {
+                EM->Lorentz_boost_EM_fields(sample, sample + 3, sample + 6,
+                                            E_prime, B_prime);
+            }
+            sum += E_prime[0] + B_prime[2];
+        }
+        sw.toc();
+        if (i == 0 || sw.takeTime() < best_time) {
+            best_time = sw.takeTime();
+        }
+        *checksum = sum;
+    }
+    return(best_time);
+}
+
+static void write_json(string filename,
+                       const vector<pair<string, double> > &setup,
+                       const vector<benchmark_result> &results) {
+    ofstream output(filename.c_str());
+    if (!output.good()) {
+        cout << "Error:write_json: can not write " << filename << endl;
+        exit(1);
+    }
+    output << "{" << endl;
+    output << "  \"format\": \"EM_fields_benchmark 1\"," << endl;
+    output << "  \"setup\": {" << endl;
+    for (unsigned int i = 0; i < setup.size(); i++) {
+        output << "    \"" << setup[i].first << "\": " << setup[i].second
+               << ((i + 1 < setup.size()) ? "," : "") << endl;
+    }
+    output << "  }," << endl;
+    output << "  \"results\": {" << endl;
+    for (unsigned int i = 0; i < results.size(); i++) {
+        const benchmark_result &result = results[i];
+        output << "    \"" << result.name << "\": {\"seconds\": "
+               << result.seconds << ", \"operations\": "
+               << result.operations << ", \"unit\": \"" << result.unit
+               << "\", \"ns_per_operation\": "
+               << 1e9*result.seconds/max(result.operations, 1.0) << "}"
+               << ((i + 1 < results.size()) ? "," : "") << endl;
+    }
+    output << "  }" << endl;
+    output << "}" << endl;
+    output.close();
+}
+
+int main(int argc, char *argv[]) {
+    ParameterReader paraRdr;
+    paraRdr.readFromFile("parameters.dat");
+    paraRdr.readFromArguments(argc, argv);
+
+    synthetic_event_setup event_setup = default_synthetic_event_setup();
+    event_setup.grid_size = paraRdr.getVal("nucleon_density_grid_size");
+    event_setup.grid_dx = paraRdr.getVal("nucleon_density_grid_dx");
+    event_setup.n_surface_points = paraRdr.getVal(
+                                        "benchmark_surface_points", 1000);
+    event_setup.impact_parameter = paraRdr.getVal(
+                                        "benchmark_impact_parameter", 8.0);
+    int n_repeats = paraRdr.getVal("benchmark_repeats", 3);
+    int n_boosts = paraRdr.getVal("benchmark_boosts", 1e6);
+
+    string event_path = "./benchmark_event";
+    mkdir(event_path.c_str(), 0755);
+    write_synthetic_event(event_path, event_setup);
+
+    // the fields are computed at every cell in every repeat
+    paraRdr.setVal("mode", 3);
+    paraRdr.setVal("field_cache", 0);
+    paraRdr.setVal("field_lattice", 0);
+    paraRdr.setVal("include_participant_contributions", 0);
+    Phase_timer timer;
+    vector<benchmark_result> results;
+    benchmark_result result;
+
+    EM_fields spectator_EM(&paraRdr, event_path, &timer);
+    double n_cells = spectator_EM.get_number_of_cells();
+    double n_spectators = spectator_EM.get_number_of_sources();
+    double spectator_time = time_EM_fields(&spectator_EM, n_repeats);
+    result.name = "spectator_fields";
+    result.unit = "interaction";
+    result.seconds = spectator_time;
+    result.operations = n_cells*n_spectators;
+    results.push_back(result);
+
+    result.name = "drifting_velocity";
+    result.unit = "cell";
+    result.seconds = time_drifting_velocity(&spectator_EM, n_repeats);
+    result.operations = n_cells;
+    results.push_back(result);
+
+    double checksum_vector, checksum_tensor;
+    result.name = "lorentz_boost";
+    result.unit = "boost";
+    result.seconds = time_lorentz_boosts(&spectator_EM, false, n_boosts,
+                                         n_repeats, &checksum_vector);
+    result.operations = n_boosts;
+    results.push_back(result);
+    result.name = "lorentz_boost_tensor";
+    result.seconds = time_lorentz_boosts(&spectator_EM, true, n_boosts,
+                                         n_repeats, &checksum_tensor);
+    results.push_back(result);
+
+    paraRdr.setVal("include_participant_contributions", 1);
+    EM_fields participant_EM(&paraRdr, event_path, &timer);
+    double n_participants = (participant_EM.get_number_of_sources()
+                             - n_spectators);
+    result.name = "participant_fields";
+    result.unit = "interaction";
+    result.seconds = max(0.0, time_EM_fields(&participant_EM, n_repeats)
+                              - spectator_time);
+    result.operations = n_cells*n_participants;
+    results.push_back(result);
+
+    cout << endl << "benchmark with " << omp_get_max_threads()
+         << " threads, " << n_cells << " cells, " << n_spectators
+         << " spectator and " << n_participants << " participant sources"
+         << endl;
+    for (unsigned int i = 0; i < results.size(); i++) {
+        cout << "  " << left << setw(24) << results[i].name << right
+             << setw(12) << setprecision(4)
+             << 1e9*results[i].seconds/max(results[i].operations, 1.0)
+             << " ns/" << results[i].unit << endl;
+    }
+    cout << "  boost checksums (vector, tensor): " << setprecision(10)
+         << checksum_vector << ", " << checksum_tensor << endl;
+
+    vector<pair<string, double> > setup;
+    setup.push_back(make_pair("threads",
+                              static_cast<double>(omp_get_max_threads())));
+    setup.push_back(make_pair("cells", n_cells));
+    setup.push_back(make_pair("spectator_sources", n_spectators));
+    setup.push_back(make_pair("participant_sources", n_participants));
+    setup.push_back(make_pair("field_kernel_method",
+                              paraRdr.getVal("field_kernel_method")));
+    setup.push_back(make_pair("kernel_precision",
+                              paraRdr.getVal("kernel_precision")));
+    setup.push_back(make_pair("participant_kernel_method",
+                              paraRdr.getVal("participant_kernel_method")));
+    setup.push_back(make_pair("electric_conductivity",
+                              paraRdr.getVal("electric_conductivity")));
+    setup.push_back(make_pair("repeats", static_cast<double>(n_repeats)));
+    write_json("./benchmark.json", setup, results);
+    return(0);
+}
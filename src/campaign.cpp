@@ -0,0 +1,60 @@
+/////////////////////////////////////////////////////////////////////////
+//              Run a campaign of events with EM_fields.e
+//
+//              author: Chun Shen <chunshen@physics.mcgill.ca>
+//              Copyright 2016 Chun Shen
+//
+//  Usage: EM_fields_campaign.e manifest n_workers [key=value ...]
+//
+//  The event directories listed in the manifest are computed by up to
+//  n_workers EM_fields.e processes at a time (n_workers <= 0: one per
+//  core), the key=value parameters are passed on to every event. The
+//  finished events are recorded in <manifest>.journal, running the same
+//  command again resumes an interrupted campaign.
+//
+/////////////////////////////////////////////////////////////////////////
+
+#include <stdlib.h>
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "./event_manifest.h"
+#include "./worker_pool.h"
+
+using namespace std;
+
+int main(int argc, char *argv[]) {
+    if (argc < 3) {
+        cout << "Usage: " << argv[0] << " manifest n_workers [key=value ...]"
+             << endl;
+        exit(1);
+    }
+    string manifest_filename = argv[1];
+    int n_workers = atoi(argv[2]);
+    vector<string> arguments;
+    for (int i = 3; i < argc; i++) {
+        arguments.push_back(argv[i]);
+    }
+
+    // EM_fields.e is expected next to this executable
+    string program_path = argv[0];
+    string executable = "./EM_fields.e";
+    if (program_path.find('/') != string::npos) {
+        executable = (program_path.substr(0, program_path.rfind('/'))
+                      + "/EM_fields.e");
+    }
+
+    vector<string> event_paths;
+    read_event_manifest(manifest_filename, &event_paths);
+    Worker_pool pool(executable, n_workers, arguments,
+                     manifest_filename + ".journal");
+    int n_failed = pool.run(event_paths);
+    if (n_failed > 0) {
+        cout << n_failed << " events failed, rerun the campaign to retry "
+             << "them" << endl;
+        return(1);
+    }
+    return(0);
+}
@@ -0,0 +1,100 @@
+/////////////////////////////////////////////////////////////////////////
+//              Convert the density files of an event to a container
+//
+//              author: Chun Shen <chunshen@physics.mcgill.ca>
+//              Copyright 2016 Chun Shen
+//
+//  Usage: EM_fields_convert_densities.e event_path [key=value ...]
+//
+//  Reads the spectator_density_A/B_fromSd_order_2.dat text files of the
+//  event (spectator_density_A/B_disk.dat for mode = -1) and, if they exist,
+//  the participant files nuclear_thickness_TA/TB_fromSd_order_2.dat on the
+//  grid nucleon_density_grid_size x nucleon_density_grid_dx of
+//  parameters.dat and writes them to the binary container densities.bin
+//  (densities_disk.bin) in the event directory. EM_fields.e reads the
+//  container instead of the text files and takes the grid from it.
+//  density_precision = 32 stores float32 values (default: 64).
+//
+/////////////////////////////////////////////////////////////////////////
+
+#include <stdlib.h>
+#include <sys/stat.h>
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "./ParameterReader.h"
+#include "./density_reader.h"
+
+using namespace std;
+
+static bool file_exists(string filename) {
+    struct stat file_status;
+    return(stat(filename.c_str(), &file_status) == 0);
+}
+
+int main(int argc, char *argv[]) {
+    if (argc < 2 || string(argv[1]).find("=") != string::npos) {
+        cout << "Usage: " << argv[0] << " event_path [key=value ...]"
+             << endl;
+        exit(1);
+    }
+    string event_path = argv[1];
+    ParameterReader paraRdr;
+    paraRdr.readFromFile("parameters.dat");
+    paraRdr.readFromArguments(argc, argv, "#", 2);
+    int mode = paraRdr.getVal("mode");
+    int grid_size = paraRdr.getVal("nucleon_density_grid_size");
+    double grid_dx = paraRdr.getVal("nucleon_density_grid_dx");
+    int precision = paraRdr.getVal("density_precision", 64);
+    if (precision != 32 && precision != 64) {
+        cout << "Error: density_precision = " << precision
+             << " is not 32 or 64!" << endl;
+        exit(1);
+    }
+    if (grid_size <= 0) {
+        cout << "Error: nucleon_density_grid_size = " << grid_size
+             << " needs to be larger than 0!" << endl;
+        exit(1);
+    }
+
+    vector<string> filenames;
+    string suffix = ((mode == -1) ? "_disk.dat" : "_fromSd_order_2.dat");
+    filenames.push_back(event_path + "/spectator_density_A" + suffix);
+    filenames.push_back(event_path + "/spectator_density_B" + suffix);
+    string participant_1_filename = (
+            event_path + "/nuclear_thickness_TA_fromSd_order_2.dat");
+    string participant_2_filename = (
+            event_path + "/nuclear_thickness_TB_fromSd_order_2.dat");
+    if (file_exists(participant_1_filename)
+        && file_exists(participant_2_filename)) {
+        filenames.push_back(participant_1_filename);
+        filenames.push_back(participant_2_filename);
+    }
+
+    vector<double**> densities(filenames.size());
+    for (unsigned int k = 0; k < densities.size(); k++) {
+        densities[k] = new double* [grid_size];
+        for (int i = 0; i < grid_size; i++) {
+            densities[k][i] = new double[grid_size];
+        }
+    }
+    read_density_files(filenames, grid_size, densities);
+    string container_filename = event_path + ((mode == -1)
+                                              ? "/densities_disk.bin"
+                                              : "/densities.bin");
+    write_density_container(container_filename, grid_size, grid_dx,
+                            precision/8, densities);
+    cout << "wrote " << densities.size() << " density maps of " << grid_size
+         << " x " << grid_size << " points (dx = " << grid_dx << " fm, "
+         << "float" << precision << ") to " << container_filename << endl;
+
+    for (unsigned int k = 0; k < densities.size(); k++) {
+        for (int i = 0; i < grid_size; i++) {
+            delete[] densities[k][i];
+        }
+        delete[] densities[k];
+    }
+    return(0);
+}
@@ -0,0 +1,303 @@
+// Copyright 2016 Chun Shen
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <vector>
+
+#include "./density_reader.h"
+#include "./text_reader.h"
+
+using namespace std;
+
+// start of the next white space separated token at or after *p, which is
+// moved to the end of the token; NULL at the end of the data
+static const char *next_token(const char **p, const char *end) {
+    while (*p < end && is_text_space(**p)) {
+        (*p)++;
+    }
+    if (*p == end) {
+        return(NULL);
+    }
+    const char *token_begin = *p;
+    while (*p < end && !is_text_space(**p)) {
+        (*p)++;
+    }
+    return(token_begin);
+}
+
+string read_density_file(string filename, int grid_size,
+                         double **density) {
+    const char *data;
+    size_t file_size;
+    if (!map_text_file(filename, &data, &file_size)) {
+        return("Error:read_density_file: can not open file " + filename);
+    }
+
+    long n_expected = static_cast<long>(grid_size)*grid_size;
+    long n_values = 0;
+    const char *p = data;
+    const char *end = data + file_size;
+    const char *token_begin;
+    while ((token_begin = next_token(&p, end)) != NULL) {
+        double value;
+        if (!parse_text_number(token_begin, p, &value)) {
+            ostringstream message;
+            message << "Error:read_density_file: " << filename << " value "
+                    << n_values + 1 << " is not a number: "
+                    << string(token_begin, p - token_begin);
+            unmap_text_file(data, file_size);
+            return(message.str());
+        }
+        if (n_values < n_expected) {
+            density[n_values/grid_size][n_values % grid_size] = value;
+        }
+        n_values++;
+    }
+    unmap_text_file(data, file_size);
+    if (n_values != n_expected) {
+        ostringstream message;
+        message << "Error:read_density_file: " << filename << " has "
+                << n_values << " values, nucleon_density_grid_size = "
+                << grid_size << " needs " << n_expected << "!";
+        return(message.str());
+    }
+    return("");
+}
+
+void read_density_files(const vector<string> &filenames, int grid_size,
+                        const vector<double**> &densities) {
+    int n_files = filenames.size();
+    vector<string> errors(n_files);
+    #pragma omp parallel for schedule(dynamic, 1)
+    for (int i = 0; i < n_files; i++) {
+        errors[i] = read_density_file(filenames[i], grid_size,
+                                      densities[i]);
+    }
+    for (int i = 0; i < n_files; i++) {
+        if (!errors[i].empty()) {
+            cout << errors[i] << endl;
+            exit(1);
+        }
+    }
+}
+
+long count_density_sources(string filename_1, string filename_2) {
+    const char *data_1, *data_2;
+    size_t size_1, size_2;
+    if (!map_text_file(filename_1, &data_1, &size_1)) {
+        return(0);
+    }
+    if (!map_text_file(filename_2, &data_2, &size_2)) {
+        unmap_text_file(data_1, size_1);
+        return(0);
+    }
+    long n_sources = 0;
+    const char *p_1 = data_1;
+    const char *p_2 = data_2;
+    while (true) {
+        const char *token_1 = next_token(&p_1, data_1 + size_1);
+        const char *token_2 = next_token(&p_2, data_2 + size_2);
+        double rho_1, rho_2;
+        if (token_1 == NULL || token_2 == NULL
+            || !parse_text_number(token_1, p_1, &rho_1)
+            || !parse_text_number(token_2, p_2, &rho_2)) {
+            break;
+        }
+        if (rho_1 != 0.0 || rho_2 != 0.0) {
+            n_sources++;
+        }
+    }
+    unmap_text_file(data_1, size_1);
+    unmap_text_file(data_2, size_2);
+    return(n_sources);
+}
+
+static const char density_container_magic[8] = {
+    'E', 'M', 'D', 'E', 'N', 'S', '\0', '\0'};
+
+// offset of map i_map in the container
+static size_t density_map_offset(const density_container_header &header,
+                                 int i_map) {
+    size_t map_bytes = (static_cast<size_t>(header.grid_size)
+                        *header.grid_size*header.value_bytes);
+    size_t aligned_map_bytes = (
+        (map_bytes + density_container_alignment - 1)
+        /density_container_alignment*density_container_alignment);
+    return(sizeof(density_container_header) + i_map*aligned_map_bytes);
+}
+
+// reads the header of the file, returns -1 if the file can not be opened,
+// 0 if it is not a container of this version and byte order and 1 if it is
+static int load_density_container_header(string filename,
+                                         density_container_header *header,
+                                         size_t *file_size) {
+    int file = open(filename.c_str(), O_RDONLY);
+    if (file < 0) {
+        return(-1);
+    }
+    struct stat file_status;
+    bool valid = (fstat(file, &file_status) == 0
+                  && read(file, header, sizeof(density_container_header))
+                     == static_cast<ssize_t>(
+                            sizeof(density_container_header)));
+    close(file);
+    *file_size = valid ? file_status.st_size : 0;
+    valid = (valid
+             && memcmp(header->magic, density_container_magic,
+                       sizeof(density_container_magic)) == 0
+             && header->version == density_container_version
+             && header->byte_order == density_container_byte_order
+             && header->grid_size > 0 && header->grid_dx > 0.0
+             && (header->value_bytes == 4 || header->value_bytes == 8)
+             && (header->n_maps == 2 || header->n_maps == 4));
+    return(valid ? 1 : 0);
+}
+
+bool read_density_container_header(string filename,
+                                   density_container_header *header) {
+    size_t file_size;
+    int status = load_density_container_header(filename, header,
+                                               &file_size);
+    if (status < 0) {
+        return(false);
+    }
+    if (status == 0) {
+        cout << "Error:read_density_container_header: " << filename
+             << " is not a density container of version "
+             << density_container_version << " in the byte order of this "
+             << "machine!" << endl;
+        exit(1);
+    }
+    if (file_size < density_map_offset(*header, header->n_maps)) {
+        cout << "Error:read_density_container_header: " << filename
+             << " is truncated!" << endl;
+        exit(1);
+    }
+    return(true);
+}
+
+long read_density_container_sources(string filename) {
+    density_container_header header;
+    size_t file_size;
+    if (load_density_container_header(filename, &header, &file_size) != 1
+        || header.n_sources <= 0) {
+        return(0);
+    }
+    return(header.n_sources);
+}
+
+void read_density_container(string filename,
+                            const vector<double**> &densities) {
+    density_container_header header;
+    if (!read_density_container_header(filename, &header)) {
+        cout << "Error:read_density_container: can not open file "
+             << filename << endl;
+        exit(1);
+    }
+    if (static_cast<int>(densities.size()) > header.n_maps) {
+        cout << "Error:read_density_container: " << filename << " holds "
+             << header.n_maps << " maps, " << densities.size()
+             << " are needed!" << endl;
+        exit(1);
+    }
+    int file = open(filename.c_str(), O_RDONLY);
+    size_t mapping_size = density_map_offset(header, densities.size());
+    void *mapping = mmap(NULL, mapping_size, PROT_READ, MAP_PRIVATE, file,
+                         0);
+    close(file);
+    if (mapping == MAP_FAILED) {
+        cout << "Error:read_density_container: can not map file "
+             << filename << endl;
+        exit(1);
+    }
+    const char *data = static_cast<const char*>(mapping);
+    int n = header.grid_size;
+    for (unsigned int k = 0; k < densities.size(); k++) {
+        const char *map = data + density_map_offset(header, k);
+        for (int i = 0; i < n; i++) {
+            if (header.value_bytes == 8) {
+                memcpy(densities[k][i], map + i*n*sizeof(double),
+                       n*sizeof(double));
+            } else {
+                const float *row = (reinterpret_cast<const float*>(map)
+                                    + i*n);
+                for (int j = 0; j < n; j++) {
+                    densities[k][i][j] = row[j];
+                }
+            }
+        }
+    }
+    munmap(mapping, mapping_size);
+}
+
+void write_density_container(string filename, int grid_size,
+                             double grid_dx, int value_bytes,
+                             const vector<double**> &densities) {
+    density_container_header header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, density_container_magic, sizeof(header.magic));
+    header.version = density_container_version;
+    header.byte_order = density_container_byte_order;
+    header.grid_size = grid_size;
+    header.value_bytes = value_bytes;
+    header.n_maps = densities.size();
+    header.grid_dx = grid_dx;
+    header.origin_x = -(grid_size - 1)/2.*grid_dx;
+    header.origin_y = header.origin_x;
+    for (int i = 0; i < grid_size; i++) {
+        for (int j = 0; j < grid_size; j++) {
+            if (densities[0][i][j] != 0.0 || densities[1][i][j] != 0.0) {
+                header.n_sources++;
+            }
+        }
+    }
+
+    ofstream output(filename.c_str(), ios::binary);
+    if (!output.good()) {
+        cout << "Error:write_density_container: can not write " << filename
+             << endl;
+        exit(1);
+    }
+    output.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    int n = grid_size;
+    vector<float> row_float(n);
+    for (unsigned int k = 0; k < densities.size(); k++) {
+        // zero padding up to the start of the map
+        size_t position = output.tellp();
+        vector<char> padding(density_map_offset(header, k) - position, 0);
+        if (!padding.empty()) {
+            output.write(&padding[0], padding.size());
+        }
+        for (int i = 0; i < n; i++) {
+            if (value_bytes == 8) {
+                output.write(reinterpret_cast<const char*>(densities[k][i]),
+                             n*sizeof(double));
+            } else {
+                for (int j = 0; j < n; j++) {
+                    row_float[j] = static_cast<float>(densities[k][i][j]);
+                }
+                output.write(reinterpret_cast<const char*>(&row_float[0]),
+                             n*sizeof(float));
+            }
+        }
+    }
+    size_t position = output.tellp();
+    vector<char> padding(density_map_offset(header, header.n_maps)
+                         - position, 0);
+    if (!padding.empty()) {
+        output.write(&padding[0], padding.size());
+    }
+    if (!output.good()) {
+        cout << "Error:write_density_container: writing " << filename
+             << " failed!" << endl;
+        exit(1);
+    }
+    output.close();
+}
@@ -0,0 +1,73 @@
+// Copyright 2016 Chun Shen
+#ifndef SRC_DENSITY_READER_H_
+#define SRC_DENSITY_READER_H_
+
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// Reads the grid_size x grid_size values of a density file, row by row,
+// into density[i][j]. The file is memory mapped and parsed in place without
+// the locale machinery of the streams; values are separated by white space.
+// Returns an empty string on success and the error message if the file can
+// not be opened, has more or less than grid_size^2 values or has a token
+// that is not a number, so that it can be called in a parallel region.
+string read_density_file(string filename, int grid_size,
+                         double **density);
+
+// reads the files into the densities, the files are parsed concurrently;
+// the first failed file is reported after all files are read
+void read_density_files(const vector<string> &filenames, int grid_size,
+                        const vector<double**> &densities);
+
+// number of grid points with a non-zero density in either of the two
+// density files, which are read up to the first token that is not a
+// number; 0 if one of them can not be opened
+long count_density_sources(string filename_1, string filename_2);
+
+// Binary density container of an event, in the byte order of the machine:
+// the header is followed by n_maps maps of grid_size^2 float64 or float32
+// values, in the order spectator A, spectator B, participant A and
+// participant B, row by row like the text files. Every map starts at a
+// multiple of density_container_alignment bytes.
+struct density_container_header {
+    char magic[8];              // "EMDENS\0\0"
+    int32_t version;
+    int32_t byte_order;         // density_container_byte_order
+    int32_t grid_size;          // nucleon_density_grid_size
+    int32_t value_bytes;        // 8: float64; 4: float32
+    int32_t n_maps;             // 2: spectators; 4: and participants
+    int32_t n_sources;          // non-zero spectator points, 0: unknown
+    double grid_dx;             // nucleon_density_grid_dx [fm]
+    double origin_x, origin_y;  // position of the value [0][0] [fm]
+    char padding[8];
+};
+
+const int density_container_version = 1;
+const int32_t density_container_byte_order = 0x01020304;
+const int density_container_alignment = 64;
+
+// reads the header of a density container, returns false if the file does
+// not exist. A file that is not a valid container is an error.
+bool read_density_container_header(string filename,
+                                   density_container_header *header);
+
+// number of spectator sources recorded in the header of the container, 0
+// if the file is not a valid container or does not record them
+long read_density_container_sources(string filename);
+
+// reads the first densities.size() maps of the container into densities,
+// which have to hold grid_size x grid_size values
+void read_density_container(string filename,
+                            const vector<double**> &densities);
+
+// writes the maps to a container with a grid centered at the origin,
+// value_bytes = 4 stores them as float32
+void write_density_container(string filename, int grid_size,
+                             double grid_dx, int value_bytes,
+                             const vector<double**> &densities);
+
+#endif  // SRC_DENSITY_READER_H_
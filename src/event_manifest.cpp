@@ -0,0 +1,34 @@
+// Copyright 2016 Chun Shen
+#include <stdlib.h>
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+
+#include "./event_manifest.h"
+
+using namespace std;
+
+void read_event_manifest(string filename, vector<string> *event_paths) {
+    ifstream manifest(filename.c_str());
+    if (!manifest.good()) {
+        cout << "Error:read_event_manifest: can not open file "
+             << filename << endl;
+        exit(1);
+    }
+    string line;
+    while (getline(manifest, line)) {
+        istringstream line_stream(line);
+        string event_path;
+        if (!(line_stream >> event_path) || event_path[0] == '#') {
+            continue;
+        }
+        event_paths->push_back(event_path);
+    }
+    manifest.close();
+    if (event_paths->size() == 0) {
+        cout << "Error:read_event_manifest: no events listed in "
+             << filename << endl;
+        exit(1);
+    }
+}
@@ -0,0 +1,14 @@
+// Copyright 2016 Chun Shen
+#ifndef SRC_EVENT_MANIFEST_H_
+#define SRC_EVENT_MANIFEST_H_
+
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// reads the event directories listed one per line in the manifest file,
+// empty lines and lines starting with # are skipped
+void read_event_manifest(string filename, vector<string> *event_paths);
+
+#endif  // SRC_EVENT_MANIFEST_H_
@@ -0,0 +1,240 @@
+// Copyright 2016 Chun Shen
+#include <stdlib.h>
+
+#include <iostream>
+#include <cmath>
+#include <complex>
+#include <algorithm>
+
+#include "./fft_convolution.h"
+
+using namespace std;
+
+// complex multiplication without the inf/nan recovery of operator*
+static inline complex<double> multiply(const complex<double> &a,
+                                       const complex<double> &b) {
+    return(complex<double>(a.real()*b.real() - a.imag()*b.imag(),
+                           a.real()*b.imag() + a.imag()*b.real()));
+}
+
+FFT_convolution::FFT_convolution(int grid_size_in, double grid_dx_in,
+                                 double **density_1, double **density_2,
+                                 int i_min, int i_max, int j_min, int j_max) {
+    grid_size = grid_size_in;
+    grid_dx = grid_dx_in;
+    window_i_min = i_min;
+    window_j_min = j_min;
+    window_size_x = i_max - i_min + 1;
+    window_size_y = j_max - j_min + 1;
+    n_fft = 1;
+    int log2_n_fft = 0;
+    while (n_fft < max(window_size_x, window_size_y) + grid_size - 1) {
+        n_fft *= 2;
+        log2_n_fft++;
+    }
+
+    bit_reverse = new int[n_fft];
+    for (int i = 0; i < n_fft; i++) {
+        int reversed = 0;
+        for (int b = 0; b < log2_n_fft; b++) {
+            if (i & (1 << b)) {
+                reversed |= 1 << (log2_n_fft - 1 - b);
+            }
+        }
+        bit_reverse[i] = reversed;
+    }
+    twiddle_forward = new complex<double>[n_fft];
+    twiddle_inverse = new complex<double>[n_fft];
+    for (int half = 1; half < n_fft; half *= 2) {
+        for (int k = 0; k < half; k++) {
+            double phase = -M_PI*k/half;
+            twiddle_forward[half - 1 + k] = complex<double>(cos(phase),
+                                                            sin(phase));
+            twiddle_inverse[half - 1 + k] = conj(
+                                            twiddle_forward[half - 1 + k]);
+        }
+    }
+
+    // rows are padded by one cache line to avoid cache set conflicts in
+    // the column transforms
+    row_stride = n_fft + 4;
+    long n_total = static_cast<long>(n_fft)*row_stride;
+    density_1_k = new complex<double>[n_total];
+    density_2_k = new complex<double>[n_total];
+    sums_E = new complex<double>[n_total];
+    sums_B = new complex<double>[n_total];
+    for (long idx = 0; idx < n_total; idx++) {
+        density_1_k[idx] = 0.0;
+        density_2_k[idx] = 0.0;
+        sums_E[idx] = 0.0;
+        sums_B[idx] = 0.0;
+    }
+    for (int i = 0; i < grid_size; i++) {
+        for (int j = 0; j < grid_size; j++) {
+            density_1_k[static_cast<long>(i)*row_stride + j] = density_1[i][j];
+            density_2_k[static_cast<long>(i)*row_stride + j] = density_2[i][j];
+        }
+    }
+    fft_rows(density_1_k, -1, 0, grid_size);
+    fft_columns(density_1_k, -1);
+    fft_rows(density_2_k, -1, 0, grid_size);
+    fft_columns(density_2_k, -1);
+}
+
+FFT_convolution::~FFT_convolution() {
+    delete[] bit_reverse;
+    delete[] twiddle_forward;
+    delete[] twiddle_inverse;
+    delete[] density_1_k;
+    delete[] density_2_k;
+    delete[] sums_E;
+    delete[] sums_B;
+}
+
+void FFT_convolution::fft_rows(complex<double> *data, int sign,
+                               int row_begin, int row_end) {
+    // in-place radix-2 FFTs along the rows row_begin <= i < row_end
+    // sign = -1 for the forward and +1 for the (unnormalized) inverse
+    const complex<double> *twiddle = (
+                        (sign < 0) ? twiddle_forward : twiddle_inverse);
+    #pragma omp parallel for
+    for (int row = row_begin; row < row_end; row++) {
+        complex<double> *x = data + static_cast<long>(row)*row_stride;
+        for (int i = 0; i < n_fft; i++) {
+            int j = bit_reverse[i];
+            if (i < j) {
+                swap(x[i], x[j]);
+            }
+        }
+        for (int half = 1; half < n_fft; half *= 2) {
+            const complex<double> *w = twiddle + half - 1;
+            for (int start = 0; start < n_fft; start += 2*half) {
+                for (int k = 0; k < half; k++) {
+                    complex<double> u = x[start + k];
+                    complex<double> v = multiply(x[start + k + half], w[k]);
+                    x[start + k] = u + v;
+                    x[start + k + half] = u - v;
+                }
+            }
+        }
+    }
+}
+
+void FFT_convolution::fft_columns(complex<double> *data, int sign) {
+    // in-place radix-2 FFTs along all columns. The butterflies are applied
+    // to blocks of neighbouring columns at once so that the inner loop runs
+    // over contiguous memory.
+    const complex<double> *twiddle = (
+                        (sign < 0) ? twiddle_forward : twiddle_inverse);
+    const int block = 16;
+    #pragma omp parallel for
+    for (int col = 0; col < n_fft; col += block) {
+        int width = 2*min(block, n_fft - col);
+        for (int i = 0; i < n_fft; i++) {
+            int j = bit_reverse[i];
+            if (i < j) {
+                double *a = reinterpret_cast<double*>(
+                                data + static_cast<long>(i)*row_stride + col);
+                double *b = reinterpret_cast<double*>(
+                                data + static_cast<long>(j)*row_stride + col);
+                for (int c = 0; c < width; c++) {
+                    swap(a[c], b[c]);
+                }
+            }
+        }
+        for (int half = 1; half < n_fft; half *= 2) {
+            const complex<double> *w = twiddle + half - 1;
+            for (int start = 0; start < n_fft; start += 2*half) {
+                for (int k = 0; k < half; k++) {
+                    double w_re = w[k].real();
+                    double w_im = w[k].imag();
+                    double *a = reinterpret_cast<double*>(
+                        data + static_cast<long>(start + k)*row_stride + col);
+                    double *b = reinterpret_cast<double*>(
+                        data + static_cast<long>(start + k + half)*row_stride
+                        + col);
+                    for (int c = 0; c < width; c += 2) {
+                        double v_re = b[c]*w_re - b[c + 1]*w_im;
+                        double v_im = b[c]*w_im + b[c + 1]*w_re;
+                        b[c] = a[c] - v_re;
+                        b[c + 1] = a[c + 1] - v_im;
+                        a[c] += v_re;
+                        a[c + 1] += v_im;
+                    }
+                }
+            }
+        }
+    }
+}
+
+void FFT_convolution::compute_slice(double z_1, double z_2, double sigma,
+                                   double sinh_spectator_rap) {
+    long n_total = static_cast<long>(n_fft)*row_stride;
+    // tabulate the kernels on the grid separations needed for the output
+    // window, shifted by the window origin and wrapped around n_fft
+    #pragma omp parallel for
+    for (int ei = 0; ei < n_fft; ei++) {
+        bool row_in_range = (ei < window_size_x || ei > n_fft - grid_size);
+        int di = ((ei < window_size_x) ? ei : ei - n_fft) + window_i_min;
+        for (int ej = 0; ej < n_fft; ej++) {
+            long idx = static_cast<long>(ei)*row_stride + ej;
+            bool in_range = (row_in_range
+                             && (ej < window_size_y
+                                 || ej > n_fft - grid_size));
+            if (!in_range) {
+                sums_E[idx] = 0.0;
+                sums_B[idx] = 0.0;
+                continue;
+            }
+            int dj = ((ej < window_size_y) ? ej : ej - n_fft) + window_j_min;
+            double x_local = di*grid_dx;
+            double y_local = dj*grid_dx;
+            double r_perp_local_sq = x_local*x_local + y_local*y_local;
+            double Delta_1 = sqrt(r_perp_local_sq + z_1*z_1);
+            double Delta_1_cubic = Delta_1*Delta_1*Delta_1;
+            double Delta_2 = sqrt(r_perp_local_sq + z_2*z_2);
+            double Delta_2_cubic = Delta_2*Delta_2*Delta_2;
+            double A_1 = sigma/2.*(z_1 - Delta_1)*sinh_spectator_rap;
+            double A_2 = sigma/2.*(z_2 + Delta_2)*(-sinh_spectator_rap);
+            double kernel_1 = (1./(Delta_1_cubic + 1e-15)
+                *(sigma/2.*sinh_spectator_rap*Delta_1 + 1.)*exp(A_1));
+            double kernel_2 = (1./(Delta_2_cubic + 1e-15)
+                *(sigma/2.*sinh_spectator_rap*Delta_2 + 1.)*exp(A_2));
+            sums_E[idx] = complex<double>(x_local*kernel_1,
+                                          y_local*kernel_1);
+            sums_B[idx] = complex<double>(x_local*kernel_2,
+                                          y_local*kernel_2);
+        }
+    }
+    // the remaining rows of the kernels are zero
+    fft_rows(sums_E, -1, 0, window_size_x);
+    fft_rows(sums_E, -1, n_fft - grid_size + 1, n_fft);
+    fft_columns(sums_E, -1);
+    fft_rows(sums_B, -1, 0, window_size_x);
+    fft_rows(sums_B, -1, n_fft - grid_size + 1, n_fft);
+    fft_columns(sums_B, -1);
+
+    // E = rho_1*K_1 + rho_2*K_2 and B = rho_1*K_1 - rho_2*K_2
+    double norm = 1./(static_cast<double>(n_fft)*n_fft);
+    #pragma omp parallel for
+    for (long idx = 0; idx < n_total; idx++) {
+        complex<double> term_1 = multiply(density_1_k[idx], sums_E[idx]);
+        complex<double> term_2 = multiply(density_2_k[idx], sums_B[idx]);
+        sums_E[idx] = (term_1 + term_2)*norm;
+        sums_B[idx] = (term_1 - term_2)*norm;
+    }
+    // only the rows of the output window are needed in the result
+    fft_columns(sums_E, 1);
+    fft_rows(sums_E, 1, 0, window_size_x);
+    fft_columns(sums_B, 1);
+    fft_rows(sums_B, 1, 0, window_size_x);
+}
+
+void FFT_convolution::get_sums(int i, int j, double *sums) {
+    long idx = (static_cast<long>(i - window_i_min)*row_stride
+                + j - window_j_min);
+    sums[0] = sums_E[idx].real();
+    sums[1] = sums_E[idx].imag();
+    sums[2] = -sums_B[idx].imag();
+    sums[3] = sums_B[idx].real();
+}
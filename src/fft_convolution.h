@@ -0,0 +1,52 @@
+// Copyright 2016 Chun Shen
+#ifndef SRC_FFT_CONVOLUTION_H_
+#define SRC_FFT_CONVOLUTION_H_
+
+#include <complex>
+
+using namespace std;
+
+// This class evaluates the spectator field sums on a rectangular window of
+// the transverse density grid at once. For a fixed (tau, eta) slice the
+// integrand depends only on the separation between the field point and the
+// source point, so the sums are 2D convolutions of the spectator densities
+// with a kernel tabulated on the grid separations. The arrays are zero
+// padded to n_fft >= window size + grid_size - 1 so that the cyclic
+// convolution from the FFT equals the linear one inside the window.
+class FFT_convolution {
+ private:
+    int grid_size;
+    double grid_dx;
+    int window_i_min, window_j_min;
+    int window_size_x, window_size_y;
+    int n_fft;
+    int row_stride;
+    int *bit_reverse;
+    // twiddle factors of all butterfly stages stored contiguously, the
+    // stage with half length h starts at index h - 1
+    complex<double> *twiddle_forward, *twiddle_inverse;
+    // Fourier transforms of the two spectator densities
+    complex<double> *density_1_k, *density_2_k;
+    // E_x + i E_y and B_y - i B_x sums after compute_slice()
+    complex<double> *sums_E, *sums_B;
+
+    void fft_rows(complex<double> *data, int sign, int row_begin,
+                  int row_end);
+    void fft_columns(complex<double> *data, int sign);
+
+ public:
+    // the output window covers the grid points i_min <= i <= i_max and
+    // j_min <= j <= j_max
+    FFT_convolution(int grid_size_in, double grid_dx_in,
+                    double **density_1, double **density_2,
+                    int i_min, int i_max, int j_min, int j_max);
+    ~FFT_convolution();
+
+    void compute_slice(double z_1, double z_2, double sigma,
+                       double sinh_spectator_rap);
+    // the spectator sums {Ex, Ey, Bx, By} at the grid point (i, j) inside
+    // the output window
+    void get_sums(int i, int j, double *sums);
+};
+
+#endif  // SRC_FFT_CONVOLUTION_H_
@@ -0,0 +1,202 @@
+// Copyright 2016 Chun Shen
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <algorithm>
+#include <utility>
+
+#include "./field_cache.h"
+
+using namespace std;
+
+static const char field_cache_magic[8] = {'E', 'M', 'C', 'A', 'C', 'H',
+                                          '0', '1'};
+static const uint64_t fnv_offset_basis = 0xcbf29ce484222325ULL;
+static const uint64_t fnv_prime = 0x100000001b3ULL;
+static const int n_field_components = 6;
+// magic, event hash and number of entries
+static const size_t field_cache_header_size = 24;
+
+Field_cache::Field_cache(string directory, uint64_t event_hash_in) {
+    event_hash = event_hash_in;
+    ostringstream cache_filename;
+    cache_filename << directory << "/field_cache_" << hex << setw(16)
+                   << setfill('0') << event_hash << ".dat";
+    filename = cache_filename.str();
+    mapped_file = NULL;
+    mapped_size = 0;
+    n_entries = 0;
+    keys = NULL;
+    fields = NULL;
+    map_file();
+}
+
+Field_cache::~Field_cache() {
+    unmap_file();
+}
+
+uint64_t Field_cache::hash_bytes(const void *data, size_t length,
+                                 uint64_t hash) {
+    const unsigned char *bytes = static_cast<const unsigned char*>(data);
+    if (hash == 0) {
+        hash = fnv_offset_basis;
+    }
+    for (size_t i = 0; i < length; i++) {
+        hash ^= bytes[i];
+        hash *= fnv_prime;
+    }
+    return(hash);
+}
+
+uint64_t Field_cache::hash_cell(double tau, double x, double y,
+                                double eta) {
+    double position[4] = {tau, x, y, eta};
+    return(hash_bytes(position, sizeof(position), 0));
+}
+
+void Field_cache::map_file() {
+    int fd = open(filename.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return;
+    }
+    struct stat file_status;
+    if (fstat(fd, &file_status) != 0
+        || static_cast<size_t>(file_status.st_size)
+           < field_cache_header_size) {
+        close(fd);
+        return;
+    }
+    size_t size = file_status.st_size;
+    void *data = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        return;
+    }
+    const char *header = static_cast<const char*>(data);
+    uint64_t file_event_hash;
+    int64_t file_n_entries;
+    memcpy(&file_event_hash, header + 8, sizeof(uint64_t));
+    memcpy(&file_n_entries, header + 16, sizeof(int64_t));
+    size_t expected_size = (
+        field_cache_header_size
+        + file_n_entries*(sizeof(uint64_t)
+                          + n_field_components*sizeof(double)));
+    if (memcmp(header, field_cache_magic, 8) != 0
+        || file_event_hash != event_hash || file_n_entries < 0
+        || size != expected_size) {
+        cout << "Field_cache:: " << filename
+             << " does not match the current event, ignoring it" << endl;
+        munmap(data, size);
+        return;
+    }
+    mapped_file = data;
+    mapped_size = size;
+    n_entries = file_n_entries;
+    keys = reinterpret_cast<const uint64_t*>(
+                                        header + field_cache_header_size);
+    fields = reinterpret_cast<const double*>(keys + n_entries);
+}
+
+void Field_cache::unmap_file() {
+    if (mapped_file != NULL) {
+        munmap(mapped_file, mapped_size);
+    }
+    mapped_file = NULL;
+    mapped_size = 0;
+    n_entries = 0;
+    keys = NULL;
+    fields = NULL;
+}
+
+bool Field_cache::lookup(uint64_t key, double *E, double *B) {
+    const uint64_t *found = lower_bound(keys, keys + n_entries, key);
+    if (found == keys + n_entries || *found != key) {
+        return(false);
+    }
+    const double *entry = fields + n_field_components*(found - keys);
+    for (int k = 0; k < 3; k++) {
+        E[k] = entry[k];
+        B[k] = entry[3 + k];
+    }
+    return(true);
+}
+
+void Field_cache::store(const vector<uint64_t> &new_keys,
+                        const vector<double> &new_fields) {
+    // merges the sorted new entries into the mapped ones, an entry already
+    // in the cache keeps its fields
+    vector<pair<uint64_t, long> > new_order(new_keys.size());
+    for (unsigned int i = 0; i < new_keys.size(); i++) {
+        new_order[i] = make_pair(new_keys[i], static_cast<long>(i));
+    }
+    sort(new_order.begin(), new_order.end());
+    vector<uint64_t> merged_keys;
+    vector<const double*> merged_fields;
+    merged_keys.reserve(n_entries + new_order.size());
+    merged_fields.reserve(n_entries + new_order.size());
+    long i_old = 0;
+    unsigned int i_new = 0;
+    while (i_old < n_entries || i_new < new_order.size()) {
+        bool take_old = (
+            i_new == new_order.size()
+            || (i_old < n_entries && keys[i_old] <= new_order[i_new].first));
+        uint64_t key;
+        const double *entry;
+        if (take_old) {
+            key = keys[i_old];
+            entry = fields + n_field_components*i_old;
+            i_old++;
+        } else {
+            key = new_order[i_new].first;
+            entry = &new_fields[n_field_components*new_order[i_new].second];
+            i_new++;
+        }
+        if (merged_keys.size() > 0 && merged_keys.back() == key) {
+            continue;
+        }
+        merged_keys.push_back(key);
+        merged_fields.push_back(entry);
+    }
+
+    string temporary_filename = filename + ".tmp";
+    ofstream cache_file(temporary_filename.c_str(), ios::binary);
+    if (!cache_file.good()) {
+        cout << "Field_cache:: Warning: can not write the field cache to "
+             << temporary_filename << endl;
+        return;
+    }
+    int64_t merged_n_entries = merged_keys.size();
+    cache_file.write(field_cache_magic, sizeof(field_cache_magic));
+    cache_file.write(reinterpret_cast<const char*>(&event_hash),
+                     sizeof(uint64_t));
+    cache_file.write(reinterpret_cast<const char*>(&merged_n_entries),
+                     sizeof(int64_t));
+    cache_file.write(reinterpret_cast<const char*>(&merged_keys[0]),
+                     merged_n_entries*sizeof(uint64_t));
+    for (long i = 0; i < merged_n_entries; i++) {
+        cache_file.write(reinterpret_cast<const char*>(merged_fields[i]),
+                         n_field_components*sizeof(double));
+    }
+    cache_file.close();
+    if (!cache_file.good()) {
+        cout << "Field_cache:: Warning: writing " << temporary_filename
+             << " failed" << endl;
+        remove(temporary_filename.c_str());
+        return;
+    }
+    unmap_file();
+    if (rename(temporary_filename.c_str(), filename.c_str()) != 0) {
+        cout << "Field_cache:: Warning: can not replace " << filename
+             << endl;
+        remove(temporary_filename.c_str());
+    }
+    map_file();
+}
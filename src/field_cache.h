@@ -0,0 +1,54 @@
+// Copyright 2016 Chun Shen
+#ifndef SRC_FIELD_CACHE_H_
+#define SRC_FIELD_CACHE_H_
+
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// On-disk cache of the lab frame fields of one event. The event is
+// identified by a 64-bit hash of its sources and parameters, which names
+// the cache file, and every cell by a hash of its (tau, x, y, eta).
+//
+// The file holds the cell hashes in ascending order followed by the fields
+// [Ex, Ey, Ez, Bx, By, Bz] of every cell. It is memory-mapped and the cells
+// are looked up with a binary search, new cells are merged into a new file
+// which replaces the old one.
+class Field_cache {
+ private:
+    string filename;
+    uint64_t event_hash;
+    void *mapped_file;
+    size_t mapped_size;
+    long n_entries;
+    const uint64_t *keys;
+    const double *fields;
+
+    void map_file();
+    void unmap_file();
+
+ public:
+    Field_cache(string directory, uint64_t event_hash_in);
+    ~Field_cache();
+
+    // 64-bit FNV-1a hash of length bytes of data, continuing from hash
+    // (0 starts a new hash)
+    static uint64_t hash_bytes(const void *data, size_t length,
+                               uint64_t hash);
+    static uint64_t hash_cell(double tau, double x, double y, double eta);
+
+    long get_number_of_entries() {return(n_entries);}
+    string get_filename() {return(filename);}
+
+    // copies the cached fields of the cell key to E and B
+    bool lookup(uint64_t key, double *E, double *B);
+
+    // adds the cells new_keys with the fields new_fields[6*i ... 6*i + 5]
+    void store(const vector<uint64_t> &new_keys,
+               const vector<double> &new_fields);
+};
+
+#endif  // SRC_FIELD_CACHE_H_
@@ -0,0 +1,1535 @@
+// Copyright 2016 Chun Shen
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include <iostream>
+#include <cmath>
+#include <algorithm>
+
+#include "./field_kernels.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define FIELD_KERNELS_X86
+// the AVX-512 intrinsics of GCC 12 start from _mm512_undefined_pd(), which
+// -Wall reports as uninitialized once they are inlined into the kernels
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wuninitialized"
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#include <immintrin.h>
+#pragma GCC diagnostic pop
+#endif
+
+using namespace std;
+
+// length rounded up to a multiple of simd_width, at least one register
+static int padded_source_length(int length, int simd_width) {
+    int padded_length = (length + simd_width - 1)/simd_width*simd_width;
+    if (padded_length == 0) {
+        padded_length = simd_width;
+    }
+    return(padded_length);
+}
+
+void allocate_source_list(source_list *sources, int length) {
+    int padded_length = padded_source_length(length, kernel_simd_width);
+    double **arrays[] = {&sources->x, &sources->y,
+                         &sources->rho_1, &sources->rho_2};
+    for (int k = 0; k < 4; k++) {
+        void *ptr = NULL;
+        if (posix_memalign(&ptr, 64, padded_length*sizeof(double)) != 0) {
+            cout << "Error:allocate_source_list: can not allocate "
+                 << padded_length << " source points!" << endl;
+            exit(1);
+        }
+        *arrays[k] = static_cast<double*>(ptr);
+        // padded points carry zero density and do not contribute
+        for (int i = 0; i < padded_length; i++) {
+            (*arrays[k])[i] = 0.0;
+        }
+    }
+    sources->length = length;
+    sources->padded_length = padded_length;
+    sources->capacity = padded_length;
+}
+
+void resize_source_list(source_list *sources, int length) {
+    int padded_length = padded_source_length(length, kernel_simd_width);
+    if (padded_length > sources->capacity) {
+        free_source_list(sources);
+        allocate_source_list(sources, length);
+        return;
+    }
+    double *arrays[] = {sources->x, sources->y,
+                        sources->rho_1, sources->rho_2};
+    for (int k = 0; k < 4; k++) {
+        for (int i = 0; i < padded_length; i++) {
+            arrays[k][i] = 0.0;
+        }
+    }
+    sources->length = length;
+    sources->padded_length = padded_length;
+}
+
+void free_source_list(source_list *sources) {
+    free(sources->x);
+    free(sources->y);
+    free(sources->rho_1);
+    free(sources->rho_2);
+    sources->x = NULL;
+    sources->y = NULL;
+    sources->rho_1 = NULL;
+    sources->rho_2 = NULL;
+    sources->length = 0;
+    sources->padded_length = 0;
+    sources->capacity = 0;
+}
+
+void convert_source_list_to_float(const source_list &sources,
+                                  source_list_float *sources_float) {
+    int padded_length = padded_source_length(sources.length,
+                                             kernel_simd_width_float);
+    if (padded_length > sources_float->capacity) {
+        free_source_list_float(sources_float);
+        float **arrays_float[] = {&sources_float->x, &sources_float->y,
+                                  &sources_float->rho_1,
+                                  &sources_float->rho_2};
+        for (int k = 0; k < 4; k++) {
+            void *ptr = NULL;
+            if (posix_memalign(&ptr, 64, padded_length*sizeof(float))
+                    != 0) {
+                cout << "Error:convert_source_list_to_float: can not "
+                     << "allocate " << padded_length << " source points!"
+                     << endl;
+                exit(1);
+            }
+            *arrays_float[k] = static_cast<float*>(ptr);
+        }
+        sources_float->capacity = padded_length;
+    }
+    const double *arrays[] = {sources.x, sources.y,
+                              sources.rho_1, sources.rho_2};
+    float *arrays_float[] = {sources_float->x, sources_float->y,
+                             sources_float->rho_1, sources_float->rho_2};
+    for (int k = 0; k < 4; k++) {
+        for (int i = 0; i < padded_length; i++) {
+            arrays_float[k][i] = (
+                (i < sources.length) ? static_cast<float>(arrays[k][i]) : 0.f);
+        }
+    }
+    sources_float->length = sources.length;
+    sources_float->padded_length = padded_length;
+}
+
+void free_source_list_float(source_list_float *sources) {
+    free(sources->x);
+    free(sources->y);
+    free(sources->rho_1);
+    free(sources->rho_2);
+    sources->x = NULL;
+    sources->y = NULL;
+    sources->rho_1 = NULL;
+    sources->rho_2 = NULL;
+    sources->length = 0;
+    sources->padded_length = 0;
+    sources->capacity = 0;
+}
+
+source_list get_source_tile(const source_list &sources, int begin, int end) {
+    source_list tile;
+    tile.length = max(0, min(sources.length, end) - begin);
+    tile.padded_length = end - begin;
+    tile.capacity = 0;
+    tile.x = sources.x + begin;
+    tile.y = sources.y + begin;
+    tile.rho_1 = sources.rho_1 + begin;
+    tile.rho_2 = sources.rho_2 + begin;
+    return(tile);
+}
+
+source_list_float get_source_tile(const source_list_float &sources,
+                                  int begin, int end) {
+    source_list_float tile;
+    tile.length = max(0, min(sources.length, end) - begin);
+    tile.padded_length = end - begin;
+    tile.capacity = 0;
+    tile.x = sources.x + begin;
+    tile.y = sources.y + begin;
+    tile.rho_1 = sources.rho_1 + begin;
+    tile.rho_2 = sources.rho_2 + begin;
+    return(tile);
+}
+
+int detect_kernel_isa() {
+#ifdef FIELD_KERNELS_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f")) {
+        return(KERNEL_ISA_AVX512);
+    }
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+        return(KERNEL_ISA_AVX2);
+    }
+#endif
+    return(KERNEL_ISA_SCALAR);
+}
+
+const char* kernel_isa_name(int isa) {
+    if (isa == KERNEL_ISA_AVX512) {
+        return("AVX-512");
+    } else if (isa == KERNEL_ISA_AVX2) {
+        return("AVX2");
+    }
+    return("scalar");
+}
+
+// the longitudinal field of the spectators is only kept without conductivity,
+// -z_1*sum rho_1/Delta_1^3 - z_2*sum rho_2/Delta_2^3
+template <bool conductive>
+static inline double spectator_Ez_sum(const spectator_kernel_args &args,
+                                      double sum_1, double sum_2) {
+    if (!conductive) {
+        return(-(args.z_1*sum_1 + args.z_2*sum_2));
+    }
+    return(0.0);
+}
+
+template <bool conductive>
+static void spectator_kernel_scalar(const source_list &sources,
+                                    const spectator_kernel_args &args,
+                                    double *sums) {
+    // portable reference implementation, identical to the original loops
+    double sigma = args.sigma;
+    double sinh_spectator_rap = args.sinh_spectator_rap;
+    double z_local_spectator_1 = args.z_1;
+    double z_local_spectator_2 = args.z_2;
+    double z_local_spectator_1_sq = z_local_spectator_1*z_local_spectator_1;
+    double z_local_spectator_2_sq = z_local_spectator_2*z_local_spectator_2;
+    double temp_sum_Ex = 0.0;
+    double temp_sum_Ey = 0.0;
+    double temp_sum_Bx = 0.0;
+    double temp_sum_By = 0.0;
+    double temp_sum_1 = 0.0;
+    double temp_sum_2 = 0.0;
+    for (int i = 0; i < sources.length; i++) {
+        double x_local = args.field_x - sources.x[i];
+        double y_local = args.field_y - sources.y[i];
+        double r_perp_local_sq = x_local*x_local + y_local*y_local;
+        double Delta_1 = sqrt(r_perp_local_sq + z_local_spectator_1_sq);
+        double Delta_1_cubic = Delta_1*Delta_1*Delta_1;
+        double Delta_2 = sqrt(r_perp_local_sq + z_local_spectator_2_sq);
+        double Delta_2_cubic = Delta_2*Delta_2*Delta_2;
+        double integrand_1, integrand_2;
+        if (conductive) {
+            double A_1 = (sigma/2.*(z_local_spectator_1 - Delta_1)
+                          *sinh_spectator_rap);
+            double A_2 = (sigma/2.*(z_local_spectator_2 + Delta_2)
+                          *(-sinh_spectator_rap));
+            integrand_1 = (
+                sources.rho_1[i]/(Delta_1_cubic + 1e-15)
+                *(sigma/2.*sinh_spectator_rap*Delta_1 + 1.)*exp(A_1));
+            integrand_2 = (
+                sources.rho_2[i]/(Delta_2_cubic + 1e-15)
+                *(sigma/2.*sinh_spectator_rap*Delta_2 + 1.)*exp(A_2));
+        } else {
+            integrand_1 = sources.rho_1[i]/(Delta_1_cubic + 1e-15);
+            integrand_2 = sources.rho_2[i]/(Delta_2_cubic + 1e-15);
+            temp_sum_1 += integrand_1;
+            temp_sum_2 += integrand_2;
+        }
+        double common_integrand_E = integrand_1 + integrand_2;
+        double common_integrand_B = integrand_1 - integrand_2;
+        temp_sum_Ex += x_local*common_integrand_E;
+        temp_sum_Ey += y_local*common_integrand_E;
+        temp_sum_Bx += -y_local*common_integrand_B;
+        temp_sum_By += x_local*common_integrand_B;
+    }
+    sums[0] = temp_sum_Ex;
+    sums[1] = temp_sum_Ey;
+    sums[2] = temp_sum_Bx;
+    sums[3] = temp_sum_By;
+    sums[4] = spectator_Ez_sum<conductive>(args, temp_sum_1, temp_sum_2);
+}
+
+template <bool conductive>
+static void spectator_kernel_group_scalar(const source_list &sources,
+                                          const spectator_kernel_args *args,
+                                          int n_cells, double *sums) {
+    // same operations as spectator_kernel_scalar() for every cell, with the
+    // transverse distance shared by the cells of the group
+    double sigma = args[0].sigma;
+    double sinh_spectator_rap = args[0].sinh_spectator_rap;
+    double temp_sums[spectator_group_width][6];
+    for (int j = 0; j < n_cells; j++) {
+        for (int k = 0; k < 6; k++) {
+            temp_sums[j][k] = 0.0;
+        }
+    }
+    for (int i = 0; i < sources.length; i++) {
+        double x_local = args[0].field_x - sources.x[i];
+        double y_local = args[0].field_y - sources.y[i];
+        double r_perp_local_sq = x_local*x_local + y_local*y_local;
+        double rho_1 = sources.rho_1[i];
+        double rho_2 = sources.rho_2[i];
+        for (int j = 0; j < n_cells; j++) {
+            double z_local_spectator_1 = args[j].z_1;
+            double z_local_spectator_2 = args[j].z_2;
+            double Delta_1 = sqrt(r_perp_local_sq
+                                  + z_local_spectator_1*z_local_spectator_1);
+            double Delta_1_cubic = Delta_1*Delta_1*Delta_1;
+            double Delta_2 = sqrt(r_perp_local_sq
+                                  + z_local_spectator_2*z_local_spectator_2);
+            double Delta_2_cubic = Delta_2*Delta_2*Delta_2;
+            double integrand_1, integrand_2;
+            if (conductive) {
+                double A_1 = (sigma/2.*(z_local_spectator_1 - Delta_1)
+                              *sinh_spectator_rap);
+                double A_2 = (sigma/2.*(z_local_spectator_2 + Delta_2)
+                              *(-sinh_spectator_rap));
+                integrand_1 = (
+                    rho_1/(Delta_1_cubic + 1e-15)
+                    *(sigma/2.*sinh_spectator_rap*Delta_1 + 1.)*exp(A_1));
+                integrand_2 = (
+                    rho_2/(Delta_2_cubic + 1e-15)
+                    *(sigma/2.*sinh_spectator_rap*Delta_2 + 1.)*exp(A_2));
+            } else {
+                integrand_1 = rho_1/(Delta_1_cubic + 1e-15);
+                integrand_2 = rho_2/(Delta_2_cubic + 1e-15);
+                temp_sums[j][4] += integrand_1;
+                temp_sums[j][5] += integrand_2;
+            }
+            double common_integrand_E = integrand_1 + integrand_2;
+            double common_integrand_B = integrand_1 - integrand_2;
+            temp_sums[j][0] += x_local*common_integrand_E;
+            temp_sums[j][1] += y_local*common_integrand_E;
+            temp_sums[j][2] += -y_local*common_integrand_B;
+            temp_sums[j][3] += x_local*common_integrand_B;
+        }
+    }
+    for (int j = 0; j < n_cells; j++) {
+        double *cell_sums = sums + n_spectator_sums*j;
+        for (int k = 0; k < 4; k++) {
+            cell_sums[k] = temp_sums[j][k];
+        }
+        cell_sums[4] = spectator_Ez_sum<conductive>(args[j], temp_sums[j][4],
+                                                    temp_sums[j][5]);
+    }
+}
+
+static void participant_kernel_scalar(const source_list &sources,
+                                      const participant_kernel_args &args,
+                                      double *sums) {
+    double temp_sum_Ex = 0.0;
+    double temp_sum_Ey = 0.0;
+    double temp_sum_Bx = 0.0;
+    double temp_sum_By = 0.0;
+    for (int i = 0; i < sources.length; i++) {
+        double x_local = args.field_x - sources.x[i];
+        double y_local = args.field_y - sources.y[i];
+        double r_perp_local_sq = x_local*x_local + y_local*y_local;
+        double rho_1 = sources.rho_1[i];
+        double rho_2 = sources.rho_2[i];
+        double common_integrand_E = 0.0;
+        double common_integrand_B = 0.0;
+        for (int k = 0; k < args.n_nodes; k++) {
+            double Delta_1 = sqrt(r_perp_local_sq + args.z_1_sq[k]);
+            double Delta_1_cubic = Delta_1*Delta_1*Delta_1;
+            double Delta_2 = sqrt(r_perp_local_sq + args.z_2_sq[k]);
+            double Delta_2_cubic = Delta_2*Delta_2*Delta_2;
+            double integrand_1 = (
+                rho_1/(Delta_1_cubic + 1e-15)*(args.c[k]*Delta_1 + 1.)
+                *exp(args.exp_offset_1[k] - args.c[k]*Delta_1));
+            double integrand_2 = (
+                rho_2/(Delta_2_cubic + 1e-15)*(args.c[k]*Delta_2 + 1.)
+                *exp(args.exp_offset_2[k] - args.c[k]*Delta_2));
+            common_integrand_E += (
+                        args.weight_E[k]*(integrand_1 + integrand_2));
+            common_integrand_B += (
+                        args.weight_B[k]*(integrand_1 - integrand_2));
+        }
+        temp_sum_Ex += x_local*common_integrand_E;
+        temp_sum_Ey += y_local*common_integrand_E;
+        temp_sum_Bx += -y_local*common_integrand_B;
+        temp_sum_By += x_local*common_integrand_B;
+    }
+    sums[0] = temp_sum_Ex;
+    sums[1] = temp_sum_Ey;
+    sums[2] = temp_sum_Bx;
+    sums[3] = temp_sum_By;
+}
+
+// The float32 kernels compute z - Delta as -r_perp^2/(Delta + z) when
+// z > 0, since z - Delta cancels catastrophically in single precision once
+// |z| >> r_perp.
+template <bool conductive>
+static void spectator_kernel_float_scalar(const source_list_float &sources,
+                                          const spectator_kernel_args &args,
+                                          double *sums) {
+    float c = static_cast<float>(args.sigma/2.*args.sinh_spectator_rap);
+    float field_x = static_cast<float>(args.field_x);
+    float field_y = static_cast<float>(args.field_y);
+    float z_sq[2] = {static_cast<float>(args.z_1*args.z_1),
+                     static_cast<float>(args.z_2*args.z_2)};
+    float z_signed[2] = {static_cast<float>(args.z_1),
+                         static_cast<float>(-args.z_2)};
+    const float *rho[2] = {sources.rho_1, sources.rho_2};
+    // sum[4] and sum[5] hold sum rho/Delta^3 of the two nuclei for Ez
+    const int n_sums = conductive ? 4 : 6;
+    float sum[6] = {0.f, 0.f, 0.f, 0.f, 0.f, 0.f};
+    float compensation[6] = {0.f, 0.f, 0.f, 0.f, 0.f, 0.f};
+    for (int i = 0; i < sources.length; i++) {
+        float x_local = field_x - sources.x[i];
+        float y_local = field_y - sources.y[i];
+        float r_perp_local_sq = x_local*x_local + y_local*y_local;
+        float integrand[2];
+        for (int n = 0; n < 2; n++) {
+            float Delta = sqrtf(r_perp_local_sq + z_sq[n]);
+            if (!conductive) {
+                integrand[n] = rho[n][i]/(Delta*Delta*Delta + 1e-15f);
+                continue;
+            }
+            float z_minus_Delta = (
+                (z_signed[n] > 0.f)
+                ? -r_perp_local_sq/(Delta + z_signed[n])
+                : z_signed[n] - Delta);
+            integrand[n] = (rho[n][i]/(Delta*Delta*Delta + 1e-15f)
+                            *(c*Delta + 1.f)*expf(c*z_minus_Delta));
+        }
+        float common_integrand_E = integrand[0] + integrand[1];
+        float common_integrand_B = integrand[0] - integrand[1];
+        float terms[6] = {x_local*common_integrand_E,
+                          y_local*common_integrand_E,
+                          -y_local*common_integrand_B,
+                          x_local*common_integrand_B,
+                          integrand[0], integrand[1]};
+        for (int k = 0; k < n_sums; k++) {
+            // Kahan summation
+            float y = terms[k] - compensation[k];
+            float t = sum[k] + y;
+            compensation[k] = (t - sum[k]) - y;
+            sum[k] = t;
+        }
+    }
+    double combined[6] = {0.0, 0.0, 0.0, 0.0, 0.0, 0.0};
+    for (int k = 0; k < n_sums; k++) {
+        combined[k] = (static_cast<double>(sum[k])
+                       - static_cast<double>(compensation[k]));
+    }
+    for (int k = 0; k < 4; k++) {
+        sums[k] = combined[k];
+    }
+    sums[4] = spectator_Ez_sum<conductive>(args, combined[4], combined[5]);
+}
+
+static inline uint64_t double_bits(double x) {
+    uint64_t bits;
+    memcpy(&bits, &x, sizeof(bits));
+    return(bits);
+}
+
+static inline double bits_double(uint64_t bits) {
+    double x;
+    memcpy(&x, &bits, sizeof(x));
+    return(x);
+}
+
+// largest number of octaves of r_perp^2 in a participant kernel table
+static const int participant_table_max_octaves = 80;
+
+void allocate_participant_kernel_table(participant_kernel_table *table,
+                                       int segment_bits) {
+    table->segment_bits = segment_bits;
+    table->capacity = participant_table_max_octaves*(1 << segment_bits);
+    table->n_segments = 0;
+    table->r_sq_min = 0.0;
+    table->r_sq_max = 0.0;
+    table->coeff = new double[16*table->capacity];
+    table->node_values = new double[8*(table->capacity + 1)];
+}
+
+void free_participant_kernel_table(participant_kernel_table *table) {
+    delete[] table->coeff;
+    delete[] table->node_values;
+    table->coeff = NULL;
+    table->node_values = NULL;
+    table->capacity = 0;
+    table->n_segments = 0;
+}
+
+static void participant_node_scalar(const participant_kernel_args &args,
+                                    double r_sq, double *node_values) {
+    // kernels and their derivatives d/d(r_perp^2) summed over the rapidity
+    // nodes, {E_1, E_2, B_1, B_2, dE_1, dE_2, dB_1, dB_2}
+    for (int q = 0; q < 8; q++) {
+        node_values[q] = 0.0;
+    }
+    for (int k = 0; k < args.n_nodes; k++) {
+        const double *z_sq[2] = {args.z_1_sq, args.z_2_sq};
+        const double *exp_offset[2] = {args.exp_offset_1, args.exp_offset_2};
+        for (int n = 0; n < 2; n++) {
+            double Delta = sqrt(r_sq + z_sq[n][k]);
+            double inv_Delta_cubic = 1./(Delta*Delta*Delta + 1e-15);
+            double prefactor = args.c[k]*Delta + 1.;
+            double exp_A = exp(exp_offset[n][k] - args.c[k]*Delta);
+            double kernel = prefactor*inv_Delta_cubic*exp_A;
+            double derivative = (-exp_A*inv_Delta_cubic
+                *(args.c[k]*args.c[k] + 3.*Delta*prefactor*inv_Delta_cubic)
+                /2.);
+            node_values[n] += args.weight_E[k]*kernel;
+            node_values[2 + n] += args.weight_B[k]*kernel;
+            node_values[4 + n] += args.weight_E[k]*derivative;
+            node_values[6 + n] += args.weight_B[k]*derivative;
+        }
+    }
+}
+
+#ifdef FIELD_KERNELS_X86
+// The vector kernels evaluate exp() with a Cody-Waite range reduction
+// followed by a degree-12 Taylor polynomial on |r| < ln(2)/2 (error below
+// 2 ulp), and 1/Delta with a hardware reciprocal square root estimate
+// refined by Newton iterations. Arguments of exp() are never positive here;
+// arguments below -708.39 are flushed to zero.
+// The 1/(Delta^3 + 1e-15) regulator of the scalar kernel is reproduced as
+// min(1/Delta^3, 1e15), which differs only for 1e-6 < Delta < 1e-4 fm.
+
+static const double exp_lower_bound = -708.39;
+static const double exp_upper_bound = 709.0;
+static const double exp_log2e = 1.4426950408889634;
+static const double exp_ln2_hi = 6.93145751953125e-1;
+static const double exp_ln2_lo = 1.42860682030941723212e-6;
+static const double exp_taylor_coeff[13] = {
+    1.0, 1.0, 1./2., 1./6., 1./24., 1./120., 1./720., 1./5040.,
+    1./40320., 1./362880., 1./3628800., 1./39916800., 1./479001600.};
+static const double tiny_r_sq = 1e-36;
+static const double inverse_cubic_cap = 1e15;
+
+__attribute__((target("avx2,fma")))
+static inline __m256d exp_avx2(__m256d x) {
+    __m256d lower = _mm256_set1_pd(exp_lower_bound);
+    __m256d underflow = _mm256_cmp_pd(x, lower, _CMP_LT_OQ);
+    x = _mm256_max_pd(x, lower);
+    x = _mm256_min_pd(x, _mm256_set1_pd(exp_upper_bound));
+    __m256d n = _mm256_round_pd(
+        _mm256_mul_pd(x, _mm256_set1_pd(exp_log2e)),
+        _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+    __m256d r = _mm256_fnmadd_pd(n, _mm256_set1_pd(exp_ln2_hi), x);
+    r = _mm256_fnmadd_pd(n, _mm256_set1_pd(exp_ln2_lo), r);
+    __m256d p = _mm256_set1_pd(exp_taylor_coeff[12]);
+    for (int k = 11; k >= 0; k--) {
+        p = _mm256_fmadd_pd(p, r, _mm256_set1_pd(exp_taylor_coeff[k]));
+    }
+    // 2^n from the exponent bits: n + 2^52 + 1023 holds n + 1023 in its
+    // low mantissa bits
+    __m256d biased = _mm256_add_pd(n, _mm256_set1_pd(4503599627370496.0
+                                                     + 1023.0));
+    __m256i two_n = _mm256_slli_epi64(_mm256_castpd_si256(biased), 52);
+    p = _mm256_mul_pd(p, _mm256_castsi256_pd(two_n));
+    return(_mm256_andnot_pd(underflow, p));
+}
+
+template <bool conductive>
+__attribute__((target("avx2,fma")))
+static inline __m256d spectator_term_avx2(__m256d r_sq, __m256d z_signed,
+                                          __m256d rho, __m256d c) {
+    // rho/Delta^3*(c*Delta + 1)*exp(c*(z_signed - Delta))
+    __m256d one = _mm256_set1_pd(1.0);
+    __m256d half_r_sq = _mm256_mul_pd(r_sq, _mm256_set1_pd(0.5));
+    __m256d inv_D = _mm256_cvtps_pd(_mm_rsqrt_ps(_mm256_cvtpd_ps(r_sq)));
+    for (int k = 0; k < 3; k++) {
+        __m256d y_sq = _mm256_mul_pd(inv_D, inv_D);
+        inv_D = _mm256_mul_pd(
+            inv_D, _mm256_fnmadd_pd(half_r_sq, y_sq, _mm256_set1_pd(1.5)));
+    }
+    __m256d tiny = _mm256_cmp_pd(r_sq, _mm256_set1_pd(tiny_r_sq),
+                                 _CMP_LT_OQ);
+    inv_D = _mm256_andnot_pd(tiny, inv_D);
+    __m256d Delta = _mm256_mul_pd(r_sq, inv_D);
+    __m256d cap = _mm256_set1_pd(inverse_cubic_cap);
+    __m256d inv_D_cubic = _mm256_min_pd(
+        _mm256_mul_pd(_mm256_mul_pd(inv_D, inv_D), inv_D), cap);
+    inv_D_cubic = _mm256_blendv_pd(inv_D_cubic, cap, tiny);
+    if (!conductive) {
+        return(_mm256_mul_pd(rho, inv_D_cubic));
+    }
+    __m256d exp_A = exp_avx2(
+        _mm256_mul_pd(c, _mm256_sub_pd(z_signed, Delta)));
+    return(_mm256_mul_pd(
+        _mm256_mul_pd(rho, inv_D_cubic),
+        _mm256_mul_pd(_mm256_fmadd_pd(c, Delta, one), exp_A)));
+}
+
+__attribute__((target("avx2,fma")))
+static inline double horizontal_sum_avx2(__m256d v) {
+    __m128d lo = _mm256_castpd256_pd128(v);
+    __m128d hi = _mm256_extractf128_pd(v, 1);
+    lo = _mm_add_pd(lo, hi);
+    return(_mm_cvtsd_f64(_mm_add_sd(lo, _mm_unpackhi_pd(lo, lo))));
+}
+
+template <bool conductive>
+__attribute__((target("avx2,fma")))
+static void spectator_kernel_avx2(const source_list &sources,
+                                  const spectator_kernel_args &args,
+                                  double *sums) {
+    __m256d c = _mm256_set1_pd(args.sigma/2.*args.sinh_spectator_rap);
+    __m256d field_x = _mm256_set1_pd(args.field_x);
+    __m256d field_y = _mm256_set1_pd(args.field_y);
+    __m256d z_1_sq = _mm256_set1_pd(args.z_1*args.z_1);
+    __m256d z_2_sq = _mm256_set1_pd(args.z_2*args.z_2);
+    __m256d z_1_signed = _mm256_set1_pd(args.z_1);
+    __m256d z_2_signed = _mm256_set1_pd(-args.z_2);
+    __m256d sum_Ex = _mm256_setzero_pd();
+    __m256d sum_Ey = _mm256_setzero_pd();
+    __m256d sum_Bx = _mm256_setzero_pd();
+    __m256d sum_By = _mm256_setzero_pd();
+    __m256d sum_1 = _mm256_setzero_pd();
+    __m256d sum_2 = _mm256_setzero_pd();
+    for (int i = 0; i < sources.padded_length; i += 4) {
+        __m256d x_local = _mm256_sub_pd(field_x,
+                                        _mm256_load_pd(sources.x + i));
+        __m256d y_local = _mm256_sub_pd(field_y,
+                                        _mm256_load_pd(sources.y + i));
+        __m256d r_perp_sq = _mm256_fmadd_pd(
+            x_local, x_local, _mm256_mul_pd(y_local, y_local));
+        __m256d integrand_1 = spectator_term_avx2<conductive>(
+            _mm256_add_pd(r_perp_sq, z_1_sq), z_1_signed,
+            _mm256_load_pd(sources.rho_1 + i), c);
+        __m256d integrand_2 = spectator_term_avx2<conductive>(
+            _mm256_add_pd(r_perp_sq, z_2_sq), z_2_signed,
+            _mm256_load_pd(sources.rho_2 + i), c);
+        __m256d common_E = _mm256_add_pd(integrand_1, integrand_2);
+        __m256d common_B = _mm256_sub_pd(integrand_1, integrand_2);
+        sum_Ex = _mm256_fmadd_pd(x_local, common_E, sum_Ex);
+        sum_Ey = _mm256_fmadd_pd(y_local, common_E, sum_Ey);
+        sum_Bx = _mm256_fnmadd_pd(y_local, common_B, sum_Bx);
+        sum_By = _mm256_fmadd_pd(x_local, common_B, sum_By);
+        if (!conductive) {
+            sum_1 = _mm256_add_pd(sum_1, integrand_1);
+            sum_2 = _mm256_add_pd(sum_2, integrand_2);
+        }
+    }
+    sums[0] = horizontal_sum_avx2(sum_Ex);
+    sums[1] = horizontal_sum_avx2(sum_Ey);
+    sums[2] = horizontal_sum_avx2(sum_Bx);
+    sums[3] = horizontal_sum_avx2(sum_By);
+    sums[4] = spectator_Ez_sum<conductive>(args, horizontal_sum_avx2(sum_1),
+                                           horizontal_sum_avx2(sum_2));
+}
+
+template <bool conductive, int n_group>
+__attribute__((target("avx2,fma")))
+static void spectator_kernel_group_avx2(const source_list &sources,
+                                        const spectator_kernel_args *args,
+                                        double *sums) {
+    __m256d c = _mm256_set1_pd(args[0].sigma/2.*args[0].sinh_spectator_rap);
+    __m256d field_x = _mm256_set1_pd(args[0].field_x);
+    __m256d field_y = _mm256_set1_pd(args[0].field_y);
+    __m256d z_1_sq[n_group], z_2_sq[n_group];
+    __m256d z_1_signed[n_group], z_2_signed[n_group];
+    __m256d sum_Ex[n_group], sum_Ey[n_group];
+    __m256d sum_Bx[n_group], sum_By[n_group];
+    __m256d sum_1[n_group], sum_2[n_group];
+    for (int j = 0; j < n_group; j++) {
+        z_1_sq[j] = _mm256_set1_pd(args[j].z_1*args[j].z_1);
+        z_2_sq[j] = _mm256_set1_pd(args[j].z_2*args[j].z_2);
+        z_1_signed[j] = _mm256_set1_pd(args[j].z_1);
+        z_2_signed[j] = _mm256_set1_pd(-args[j].z_2);
+        sum_Ex[j] = _mm256_setzero_pd();
+        sum_Ey[j] = _mm256_setzero_pd();
+        sum_Bx[j] = _mm256_setzero_pd();
+        sum_By[j] = _mm256_setzero_pd();
+        sum_1[j] = _mm256_setzero_pd();
+        sum_2[j] = _mm256_setzero_pd();
+    }
+    for (int i = 0; i < sources.padded_length; i += 4) {
+        __m256d x_local = _mm256_sub_pd(field_x,
+                                        _mm256_load_pd(sources.x + i));
+        __m256d y_local = _mm256_sub_pd(field_y,
+                                        _mm256_load_pd(sources.y + i));
+        __m256d r_perp_sq = _mm256_fmadd_pd(
+            x_local, x_local, _mm256_mul_pd(y_local, y_local));
+        __m256d rho_1 = _mm256_load_pd(sources.rho_1 + i);
+        __m256d rho_2 = _mm256_load_pd(sources.rho_2 + i);
+        for (int j = 0; j < n_group; j++) {
+            __m256d integrand_1 = spectator_term_avx2<conductive>(
+                _mm256_add_pd(r_perp_sq, z_1_sq[j]), z_1_signed[j], rho_1, c);
+            __m256d integrand_2 = spectator_term_avx2<conductive>(
+                _mm256_add_pd(r_perp_sq, z_2_sq[j]), z_2_signed[j], rho_2, c);
+            __m256d common_E = _mm256_add_pd(integrand_1, integrand_2);
+            __m256d common_B = _mm256_sub_pd(integrand_1, integrand_2);
+            sum_Ex[j] = _mm256_fmadd_pd(x_local, common_E, sum_Ex[j]);
+            sum_Ey[j] = _mm256_fmadd_pd(y_local, common_E, sum_Ey[j]);
+            sum_Bx[j] = _mm256_fnmadd_pd(y_local, common_B, sum_Bx[j]);
+            sum_By[j] = _mm256_fmadd_pd(x_local, common_B, sum_By[j]);
+            if (!conductive) {
+                sum_1[j] = _mm256_add_pd(sum_1[j], integrand_1);
+                sum_2[j] = _mm256_add_pd(sum_2[j], integrand_2);
+            }
+        }
+    }
+    for (int j = 0; j < n_group; j++) {
+        double *cell_sums = sums + n_spectator_sums*j;
+        cell_sums[0] = horizontal_sum_avx2(sum_Ex[j]);
+        cell_sums[1] = horizontal_sum_avx2(sum_Ey[j]);
+        cell_sums[2] = horizontal_sum_avx2(sum_Bx[j]);
+        cell_sums[3] = horizontal_sum_avx2(sum_By[j]);
+        cell_sums[4] = spectator_Ez_sum<conductive>(
+            args[j], horizontal_sum_avx2(sum_1[j]),
+            horizontal_sum_avx2(sum_2[j]));
+    }
+}
+
+__attribute__((target("avx2,fma")))
+static inline __m256d participant_term_avx2(__m256d r_sq, __m256d rho,
+                                            __m256d c, __m256d exp_offset) {
+    // rho/Delta^3*(c*Delta + 1)*exp(exp_offset - c*Delta)
+    __m256d one = _mm256_set1_pd(1.0);
+    __m256d half_r_sq = _mm256_mul_pd(r_sq, _mm256_set1_pd(0.5));
+    __m256d inv_D = _mm256_cvtps_pd(_mm_rsqrt_ps(_mm256_cvtpd_ps(r_sq)));
+    for (int k = 0; k < 3; k++) {
+        __m256d y_sq = _mm256_mul_pd(inv_D, inv_D);
+        inv_D = _mm256_mul_pd(
+            inv_D, _mm256_fnmadd_pd(half_r_sq, y_sq, _mm256_set1_pd(1.5)));
+    }
+    __m256d tiny = _mm256_cmp_pd(r_sq, _mm256_set1_pd(tiny_r_sq),
+                                 _CMP_LT_OQ);
+    inv_D = _mm256_andnot_pd(tiny, inv_D);
+    __m256d Delta = _mm256_mul_pd(r_sq, inv_D);
+    __m256d cap = _mm256_set1_pd(inverse_cubic_cap);
+    __m256d inv_D_cubic = _mm256_min_pd(
+        _mm256_mul_pd(_mm256_mul_pd(inv_D, inv_D), inv_D), cap);
+    inv_D_cubic = _mm256_blendv_pd(inv_D_cubic, cap, tiny);
+    __m256d exp_A = exp_avx2(_mm256_fnmadd_pd(c, Delta, exp_offset));
+    return(_mm256_mul_pd(
+        _mm256_mul_pd(rho, inv_D_cubic),
+        _mm256_mul_pd(_mm256_fmadd_pd(c, Delta, one), exp_A)));
+}
+
+__attribute__((target("avx2,fma")))
+static void participant_kernel_avx2(const source_list &sources,
+                                    const participant_kernel_args &args,
+                                    double *sums) {
+    __m256d sum_Ex = _mm256_setzero_pd();
+    __m256d sum_Ey = _mm256_setzero_pd();
+    __m256d sum_Bx = _mm256_setzero_pd();
+    __m256d sum_By = _mm256_setzero_pd();
+    for (int i = 0; i < sources.length; i++) {
+        double x_local_scalar = args.field_x - sources.x[i];
+        double y_local_scalar = args.field_y - sources.y[i];
+        __m256d x_local = _mm256_set1_pd(x_local_scalar);
+        __m256d y_local = _mm256_set1_pd(y_local_scalar);
+        __m256d r_perp_sq = _mm256_set1_pd(x_local_scalar*x_local_scalar
+                                           + y_local_scalar*y_local_scalar);
+        __m256d rho_1 = _mm256_set1_pd(sources.rho_1[i]);
+        __m256d rho_2 = _mm256_set1_pd(sources.rho_2[i]);
+        // the rapidity nodes run across the vector lanes
+        __m256d common_E = _mm256_setzero_pd();
+        __m256d common_B = _mm256_setzero_pd();
+        for (int k = 0; k < args.n_nodes; k += 4) {
+            __m256d c = _mm256_loadu_pd(args.c + k);
+            __m256d integrand_1 = participant_term_avx2(
+                _mm256_add_pd(r_perp_sq, _mm256_loadu_pd(args.z_1_sq + k)),
+                rho_1, c, _mm256_loadu_pd(args.exp_offset_1 + k));
+            __m256d integrand_2 = participant_term_avx2(
+                _mm256_add_pd(r_perp_sq, _mm256_loadu_pd(args.z_2_sq + k)),
+                rho_2, c, _mm256_loadu_pd(args.exp_offset_2 + k));
+            common_E = _mm256_fmadd_pd(
+                _mm256_loadu_pd(args.weight_E + k),
+                _mm256_add_pd(integrand_1, integrand_2), common_E);
+            common_B = _mm256_fmadd_pd(
+                _mm256_loadu_pd(args.weight_B + k),
+                _mm256_sub_pd(integrand_1, integrand_2), common_B);
+        }
+        sum_Ex = _mm256_fmadd_pd(x_local, common_E, sum_Ex);
+        sum_Ey = _mm256_fmadd_pd(y_local, common_E, sum_Ey);
+        sum_Bx = _mm256_fnmadd_pd(y_local, common_B, sum_Bx);
+        sum_By = _mm256_fmadd_pd(x_local, common_B, sum_By);
+    }
+    sums[0] = horizontal_sum_avx2(sum_Ex);
+    sums[1] = horizontal_sum_avx2(sum_Ey);
+    sums[2] = horizontal_sum_avx2(sum_Bx);
+    sums[3] = horizontal_sum_avx2(sum_By);
+}
+
+static const float exp_lower_bound_float = -87.3f;
+static const float exp_upper_bound_float = 88.0f;
+static const float exp_ln2_hi_float = 0.693359375f;
+static const float exp_ln2_lo_float = -2.12194440e-4f;
+static const float tiny_r_sq_float = 1e-30f;
+static const float inverse_cubic_cap_float = 1e15f;
+
+__attribute__((target("avx2,fma")))
+static inline __m256 exp_float_avx2(__m256 x) {
+    // degree-7 Taylor polynomial after the range reduction, below 1 ulp
+    __m256 lower = _mm256_set1_ps(exp_lower_bound_float);
+    __m256 underflow = _mm256_cmp_ps(x, lower, _CMP_LT_OQ);
+    x = _mm256_max_ps(x, lower);
+    x = _mm256_min_ps(x, _mm256_set1_ps(exp_upper_bound_float));
+    __m256 n = _mm256_round_ps(
+        _mm256_mul_ps(x, _mm256_set1_ps(static_cast<float>(exp_log2e))),
+        _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+    __m256 r = _mm256_fnmadd_ps(n, _mm256_set1_ps(exp_ln2_hi_float), x);
+    r = _mm256_fnmadd_ps(n, _mm256_set1_ps(exp_ln2_lo_float), r);
+    __m256 p = _mm256_set1_ps(static_cast<float>(exp_taylor_coeff[7]));
+    for (int k = 6; k >= 0; k--) {
+        p = _mm256_fmadd_ps(
+            p, r, _mm256_set1_ps(static_cast<float>(exp_taylor_coeff[k])));
+    }
+    __m256i two_n = _mm256_slli_epi32(
+        _mm256_add_epi32(_mm256_cvtps_epi32(n), _mm256_set1_epi32(127)), 23);
+    p = _mm256_mul_ps(p, _mm256_castsi256_ps(two_n));
+    return(_mm256_andnot_ps(underflow, p));
+}
+
+template <bool conductive>
+__attribute__((target("avx2,fma")))
+static inline __m256 spectator_term_float_avx2(__m256 r_sq, __m256 z_sq,
+                                               __m256 z_signed, bool forward,
+                                               __m256 rho, __m256 c) {
+    __m256 Delta_sq = _mm256_add_ps(r_sq, z_sq);
+    __m256 inv_D = _mm256_rsqrt_ps(Delta_sq);
+    inv_D = _mm256_mul_ps(inv_D, _mm256_fnmadd_ps(
+        _mm256_mul_ps(Delta_sq, _mm256_set1_ps(0.5f)),
+        _mm256_mul_ps(inv_D, inv_D), _mm256_set1_ps(1.5f)));
+    __m256 tiny = _mm256_cmp_ps(Delta_sq, _mm256_set1_ps(tiny_r_sq_float),
+                                _CMP_LT_OQ);
+    inv_D = _mm256_andnot_ps(tiny, inv_D);
+    __m256 Delta = _mm256_mul_ps(Delta_sq, inv_D);
+    __m256 cap = _mm256_set1_ps(inverse_cubic_cap_float);
+    __m256 inv_D_cubic = _mm256_min_ps(
+        _mm256_mul_ps(_mm256_mul_ps(inv_D, inv_D), inv_D), cap);
+    inv_D_cubic = _mm256_blendv_ps(inv_D_cubic, cap, tiny);
+    if (!conductive) {
+        return(_mm256_mul_ps(rho, inv_D_cubic));
+    }
+    __m256 z_minus_Delta;
+    if (forward) {
+        z_minus_Delta = _mm256_div_ps(
+            _mm256_sub_ps(_mm256_setzero_ps(), r_sq),
+            _mm256_add_ps(Delta, z_signed));
+    } else {
+        z_minus_Delta = _mm256_sub_ps(z_signed, Delta);
+    }
+    __m256 exp_A = exp_float_avx2(_mm256_mul_ps(c, z_minus_Delta));
+    return(_mm256_mul_ps(
+        _mm256_mul_ps(rho, inv_D_cubic),
+        _mm256_mul_ps(_mm256_fmadd_ps(c, Delta, _mm256_set1_ps(1.f)),
+                      exp_A)));
+}
+
+__attribute__((target("avx2,fma")))
+static inline void kahan_add_avx2(__m256 term, __m256 *sum,
+                                  __m256 *compensation) {
+    __m256 y = _mm256_sub_ps(term, *compensation);
+    __m256 t = _mm256_add_ps(*sum, y);
+    *compensation = _mm256_sub_ps(_mm256_sub_ps(t, *sum), y);
+    *sum = t;
+}
+
+template <bool conductive>
+__attribute__((target("avx2,fma")))
+static void spectator_kernel_float_avx2(const source_list_float &sources,
+                                        const spectator_kernel_args &args,
+                                        double *sums) {
+    __m256 c = _mm256_set1_ps(
+                static_cast<float>(args.sigma/2.*args.sinh_spectator_rap));
+    __m256 field_x = _mm256_set1_ps(static_cast<float>(args.field_x));
+    __m256 field_y = _mm256_set1_ps(static_cast<float>(args.field_y));
+    __m256 z_1_sq = _mm256_set1_ps(static_cast<float>(args.z_1*args.z_1));
+    __m256 z_2_sq = _mm256_set1_ps(static_cast<float>(args.z_2*args.z_2));
+    __m256 z_1_signed = _mm256_set1_ps(static_cast<float>(args.z_1));
+    __m256 z_2_signed = _mm256_set1_ps(static_cast<float>(-args.z_2));
+    bool forward_1 = (static_cast<float>(args.z_1) > 0.f);
+    bool forward_2 = (static_cast<float>(-args.z_2) > 0.f);
+    __m256 sum[6], compensation[6];
+    for (int k = 0; k < 6; k++) {
+        sum[k] = _mm256_setzero_ps();
+        compensation[k] = _mm256_setzero_ps();
+    }
+    for (int i = 0; i < sources.padded_length; i += 8) {
+        __m256 x_local = _mm256_sub_ps(field_x,
+                                       _mm256_load_ps(sources.x + i));
+        __m256 y_local = _mm256_sub_ps(field_y,
+                                       _mm256_load_ps(sources.y + i));
+        __m256 r_perp_sq = _mm256_fmadd_ps(
+            x_local, x_local, _mm256_mul_ps(y_local, y_local));
+        __m256 integrand_1 = spectator_term_float_avx2<conductive>(
+            r_perp_sq, z_1_sq, z_1_signed, forward_1,
+            _mm256_load_ps(sources.rho_1 + i), c);
+        __m256 integrand_2 = spectator_term_float_avx2<conductive>(
+            r_perp_sq, z_2_sq, z_2_signed, forward_2,
+            _mm256_load_ps(sources.rho_2 + i), c);
+        __m256 common_E = _mm256_add_ps(integrand_1, integrand_2);
+        __m256 common_B = _mm256_sub_ps(integrand_1, integrand_2);
+        kahan_add_avx2(_mm256_mul_ps(x_local, common_E), &sum[0],
+                       &compensation[0]);
+        kahan_add_avx2(_mm256_mul_ps(y_local, common_E), &sum[1],
+                       &compensation[1]);
+        kahan_add_avx2(_mm256_mul_ps(_mm256_sub_ps(_mm256_setzero_ps(),
+                                                   y_local), common_B),
+                       &sum[2], &compensation[2]);
+        kahan_add_avx2(_mm256_mul_ps(x_local, common_B), &sum[3],
+                       &compensation[3]);
+        if (!conductive) {
+            kahan_add_avx2(integrand_1, &sum[4], &compensation[4]);
+            kahan_add_avx2(integrand_2, &sum[5], &compensation[5]);
+        }
+    }
+    double combined[6];
+    for (int k = 0; k < 6; k++) {
+        float lanes[8], lanes_compensation[8];
+        _mm256_storeu_ps(lanes, sum[k]);
+        _mm256_storeu_ps(lanes_compensation, compensation[k]);
+        combined[k] = 0.0;
+        for (int l = 0; l < 8; l++) {
+            combined[k] += (static_cast<double>(lanes[l])
+                            - static_cast<double>(lanes_compensation[l]));
+        }
+    }
+    for (int k = 0; k < 4; k++) {
+        sums[k] = combined[k];
+    }
+    sums[4] = spectator_Ez_sum<conductive>(args, combined[4], combined[5]);
+}
+
+__attribute__((target("avx512f")))
+static inline __m512d exp_avx512(__m512d x) {
+    __m512d lower = _mm512_set1_pd(exp_lower_bound);
+    __mmask8 in_range = _mm512_cmp_pd_mask(x, lower, _CMP_GE_OQ);
+    x = _mm512_max_pd(x, lower);
+    x = _mm512_min_pd(x, _mm512_set1_pd(exp_upper_bound));
+    __m512d n = _mm512_maskz_roundscale_pd(
+        (__mmask8)-1, _mm512_mul_pd(x, _mm512_set1_pd(exp_log2e)),
+        _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+    __m512d r = _mm512_fnmadd_pd(n, _mm512_set1_pd(exp_ln2_hi), x);
+    r = _mm512_fnmadd_pd(n, _mm512_set1_pd(exp_ln2_lo), r);
+    __m512d p = _mm512_set1_pd(exp_taylor_coeff[12]);
+    for (int k = 11; k >= 0; k--) {
+        p = _mm512_fmadd_pd(p, r, _mm512_set1_pd(exp_taylor_coeff[k]));
+    }
+    return(_mm512_maskz_mov_pd(in_range, _mm512_scalef_pd(p, n)));
+}
+
+template <bool conductive>
+__attribute__((target("avx512f")))
+static inline __m512d spectator_term_avx512(__m512d r_sq, __m512d z_signed,
+                                            __m512d rho, __m512d c) {
+    // rho/Delta^3*(c*Delta + 1)*exp(c*(z_signed - Delta))
+    __m512d one = _mm512_set1_pd(1.0);
+    __m512d half_r_sq = _mm512_mul_pd(r_sq, _mm512_set1_pd(0.5));
+    __m512d inv_D = _mm512_rsqrt14_pd(r_sq);
+    for (int k = 0; k < 2; k++) {
+        __m512d y_sq = _mm512_mul_pd(inv_D, inv_D);
+        inv_D = _mm512_mul_pd(
+            inv_D, _mm512_fnmadd_pd(half_r_sq, y_sq, _mm512_set1_pd(1.5)));
+    }
+    __mmask8 regular = _mm512_cmp_pd_mask(
+        r_sq, _mm512_set1_pd(tiny_r_sq), _CMP_GE_OQ);
+    inv_D = _mm512_maskz_mov_pd(regular, inv_D);
+    __m512d Delta = _mm512_mul_pd(r_sq, inv_D);
+    __m512d cap = _mm512_set1_pd(inverse_cubic_cap);
+    __m512d inv_D_cubic = _mm512_mask_min_pd(
+        cap, regular, _mm512_mul_pd(_mm512_mul_pd(inv_D, inv_D), inv_D), cap);
+    if (!conductive) {
+        return(_mm512_mul_pd(rho, inv_D_cubic));
+    }
+    __m512d exp_A = exp_avx512(
+        _mm512_mul_pd(c, _mm512_sub_pd(z_signed, Delta)));
+    return(_mm512_mul_pd(
+        _mm512_mul_pd(rho, inv_D_cubic),
+        _mm512_mul_pd(_mm512_fmadd_pd(c, Delta, one), exp_A)));
+}
+
+template <bool conductive>
+__attribute__((target("avx512f")))
+static void spectator_kernel_avx512(const source_list &sources,
+                                    const spectator_kernel_args &args,
+                                    double *sums) {
+    __m512d c = _mm512_set1_pd(args.sigma/2.*args.sinh_spectator_rap);
+    __m512d field_x = _mm512_set1_pd(args.field_x);
+    __m512d field_y = _mm512_set1_pd(args.field_y);
+    __m512d z_1_sq = _mm512_set1_pd(args.z_1*args.z_1);
+    __m512d z_2_sq = _mm512_set1_pd(args.z_2*args.z_2);
+    __m512d z_1_signed = _mm512_set1_pd(args.z_1);
+    __m512d z_2_signed = _mm512_set1_pd(-args.z_2);
+    __m512d sum_Ex = _mm512_setzero_pd();
+    __m512d sum_Ey = _mm512_setzero_pd();
+    __m512d sum_Bx = _mm512_setzero_pd();
+    __m512d sum_By = _mm512_setzero_pd();
+    __m512d sum_1 = _mm512_setzero_pd();
+    __m512d sum_2 = _mm512_setzero_pd();
+    for (int i = 0; i < sources.padded_length; i += 8) {
+        __m512d x_local = _mm512_sub_pd(field_x,
+                                        _mm512_load_pd(sources.x + i));
+        __m512d y_local = _mm512_sub_pd(field_y,
+                                        _mm512_load_pd(sources.y + i));
+        __m512d r_perp_sq = _mm512_fmadd_pd(
+            x_local, x_local, _mm512_mul_pd(y_local, y_local));
+        __m512d integrand_1 = spectator_term_avx512<conductive>(
+            _mm512_add_pd(r_perp_sq, z_1_sq), z_1_signed,
+            _mm512_load_pd(sources.rho_1 + i), c);
+        __m512d integrand_2 = spectator_term_avx512<conductive>(
+            _mm512_add_pd(r_perp_sq, z_2_sq), z_2_signed,
+            _mm512_load_pd(sources.rho_2 + i), c);
+        __m512d common_E = _mm512_add_pd(integrand_1, integrand_2);
+        __m512d common_B = _mm512_sub_pd(integrand_1, integrand_2);
+        sum_Ex = _mm512_fmadd_pd(x_local, common_E, sum_Ex);
+        sum_Ey = _mm512_fmadd_pd(y_local, common_E, sum_Ey);
+        sum_Bx = _mm512_fnmadd_pd(y_local, common_B, sum_Bx);
+        sum_By = _mm512_fmadd_pd(x_local, common_B, sum_By);
+        if (!conductive) {
+            sum_1 = _mm512_add_pd(sum_1, integrand_1);
+            sum_2 = _mm512_add_pd(sum_2, integrand_2);
+        }
+    }
+    sums[0] = _mm512_reduce_add_pd(sum_Ex);
+    sums[1] = _mm512_reduce_add_pd(sum_Ey);
+    sums[2] = _mm512_reduce_add_pd(sum_Bx);
+    sums[3] = _mm512_reduce_add_pd(sum_By);
+    sums[4] = spectator_Ez_sum<conductive>(args, _mm512_reduce_add_pd(sum_1),
+                                           _mm512_reduce_add_pd(sum_2));
+}
+template <bool conductive, int n_group>
+__attribute__((target("avx512f")))
+static void spectator_kernel_group_avx512(const source_list &sources,
+                                        const spectator_kernel_args *args,
+                                        double *sums) {
+    __m512d c = _mm512_set1_pd(args[0].sigma/2.*args[0].sinh_spectator_rap);
+    __m512d field_x = _mm512_set1_pd(args[0].field_x);
+    __m512d field_y = _mm512_set1_pd(args[0].field_y);
+    __m512d z_1_sq[n_group], z_2_sq[n_group];
+    __m512d z_1_signed[n_group], z_2_signed[n_group];
+    __m512d sum_Ex[n_group], sum_Ey[n_group];
+    __m512d sum_Bx[n_group], sum_By[n_group];
+    __m512d sum_1[n_group], sum_2[n_group];
+    for (int j = 0; j < n_group; j++) {
+        z_1_sq[j] = _mm512_set1_pd(args[j].z_1*args[j].z_1);
+        z_2_sq[j] = _mm512_set1_pd(args[j].z_2*args[j].z_2);
+        z_1_signed[j] = _mm512_set1_pd(args[j].z_1);
+        z_2_signed[j] = _mm512_set1_pd(-args[j].z_2);
+        sum_Ex[j] = _mm512_setzero_pd();
+        sum_Ey[j] = _mm512_setzero_pd();
+        sum_Bx[j] = _mm512_setzero_pd();
+        sum_By[j] = _mm512_setzero_pd();
+        sum_1[j] = _mm512_setzero_pd();
+        sum_2[j] = _mm512_setzero_pd();
+    }
+    for (int i = 0; i < sources.padded_length; i += 8) {
+        __m512d x_local = _mm512_sub_pd(field_x,
+                                        _mm512_load_pd(sources.x + i));
+        __m512d y_local = _mm512_sub_pd(field_y,
+                                        _mm512_load_pd(sources.y + i));
+        __m512d r_perp_sq = _mm512_fmadd_pd(
+            x_local, x_local, _mm512_mul_pd(y_local, y_local));
+        __m512d rho_1 = _mm512_load_pd(sources.rho_1 + i);
+        __m512d rho_2 = _mm512_load_pd(sources.rho_2 + i);
+        for (int j = 0; j < n_group; j++) {
+            __m512d integrand_1 = spectator_term_avx512<conductive>(
+                _mm512_add_pd(r_perp_sq, z_1_sq[j]), z_1_signed[j], rho_1, c);
+            __m512d integrand_2 = spectator_term_avx512<conductive>(
+                _mm512_add_pd(r_perp_sq, z_2_sq[j]), z_2_signed[j], rho_2, c);
+            __m512d common_E = _mm512_add_pd(integrand_1, integrand_2);
+            __m512d common_B = _mm512_sub_pd(integrand_1, integrand_2);
+            sum_Ex[j] = _mm512_fmadd_pd(x_local, common_E, sum_Ex[j]);
+            sum_Ey[j] = _mm512_fmadd_pd(y_local, common_E, sum_Ey[j]);
+            sum_Bx[j] = _mm512_fnmadd_pd(y_local, common_B, sum_Bx[j]);
+            sum_By[j] = _mm512_fmadd_pd(x_local, common_B, sum_By[j]);
+            if (!conductive) {
+                sum_1[j] = _mm512_add_pd(sum_1[j], integrand_1);
+                sum_2[j] = _mm512_add_pd(sum_2[j], integrand_2);
+            }
+        }
+    }
+    for (int j = 0; j < n_group; j++) {
+        double *cell_sums = sums + n_spectator_sums*j;
+        cell_sums[0] = _mm512_reduce_add_pd(sum_Ex[j]);
+        cell_sums[1] = _mm512_reduce_add_pd(sum_Ey[j]);
+        cell_sums[2] = _mm512_reduce_add_pd(sum_Bx[j]);
+        cell_sums[3] = _mm512_reduce_add_pd(sum_By[j]);
+        cell_sums[4] = spectator_Ez_sum<conductive>(
+            args[j], _mm512_reduce_add_pd(sum_1[j]),
+            _mm512_reduce_add_pd(sum_2[j]));
+    }
+}
+
+__attribute__((target("avx512f")))
+static inline __m512d participant_term_avx512(__m512d r_sq, __m512d rho,
+                                              __m512d c,
+                                              __m512d exp_offset) {
+    // rho/Delta^3*(c*Delta + 1)*exp(exp_offset - c*Delta)
+    __m512d one = _mm512_set1_pd(1.0);
+    __m512d half_r_sq = _mm512_mul_pd(r_sq, _mm512_set1_pd(0.5));
+    __m512d inv_D = _mm512_rsqrt14_pd(r_sq);
+    for (int k = 0; k < 2; k++) {
+        __m512d y_sq = _mm512_mul_pd(inv_D, inv_D);
+        inv_D = _mm512_mul_pd(
+            inv_D, _mm512_fnmadd_pd(half_r_sq, y_sq, _mm512_set1_pd(1.5)));
+    }
+    __mmask8 regular = _mm512_cmp_pd_mask(
+        r_sq, _mm512_set1_pd(tiny_r_sq), _CMP_GE_OQ);
+    inv_D = _mm512_maskz_mov_pd(regular, inv_D);
+    __m512d Delta = _mm512_mul_pd(r_sq, inv_D);
+    __m512d cap = _mm512_set1_pd(inverse_cubic_cap);
+    __m512d inv_D_cubic = _mm512_mask_min_pd(
+        cap, regular, _mm512_mul_pd(_mm512_mul_pd(inv_D, inv_D), inv_D), cap);
+    __m512d exp_A = exp_avx512(_mm512_fnmadd_pd(c, Delta, exp_offset));
+    return(_mm512_mul_pd(
+        _mm512_mul_pd(rho, inv_D_cubic),
+        _mm512_mul_pd(_mm512_fmadd_pd(c, Delta, one), exp_A)));
+}
+
+__attribute__((target("avx512f")))
+static void participant_kernel_avx512(const source_list &sources,
+                                      const participant_kernel_args &args,
+                                      double *sums) {
+    __m512d sum_Ex = _mm512_setzero_pd();
+    __m512d sum_Ey = _mm512_setzero_pd();
+    __m512d sum_Bx = _mm512_setzero_pd();
+    __m512d sum_By = _mm512_setzero_pd();
+    for (int i = 0; i < sources.length; i++) {
+        double x_local_scalar = args.field_x - sources.x[i];
+        double y_local_scalar = args.field_y - sources.y[i];
+        __m512d x_local = _mm512_set1_pd(x_local_scalar);
+        __m512d y_local = _mm512_set1_pd(y_local_scalar);
+        __m512d r_perp_sq = _mm512_set1_pd(x_local_scalar*x_local_scalar
+                                           + y_local_scalar*y_local_scalar);
+        __m512d rho_1 = _mm512_set1_pd(sources.rho_1[i]);
+        __m512d rho_2 = _mm512_set1_pd(sources.rho_2[i]);
+        // the rapidity nodes run across the vector lanes
+        __m512d common_E = _mm512_setzero_pd();
+        __m512d common_B = _mm512_setzero_pd();
+        for (int k = 0; k < args.n_nodes; k += 8) {
+            __m512d c = _mm512_loadu_pd(args.c + k);
+            __m512d integrand_1 = participant_term_avx512(
+                _mm512_add_pd(r_perp_sq, _mm512_loadu_pd(args.z_1_sq + k)),
+                rho_1, c, _mm512_loadu_pd(args.exp_offset_1 + k));
+            __m512d integrand_2 = participant_term_avx512(
+                _mm512_add_pd(r_perp_sq, _mm512_loadu_pd(args.z_2_sq + k)),
+                rho_2, c, _mm512_loadu_pd(args.exp_offset_2 + k));
+            common_E = _mm512_fmadd_pd(
+                _mm512_loadu_pd(args.weight_E + k),
+                _mm512_add_pd(integrand_1, integrand_2), common_E);
+            common_B = _mm512_fmadd_pd(
+                _mm512_loadu_pd(args.weight_B + k),
+                _mm512_sub_pd(integrand_1, integrand_2), common_B);
+        }
+        sum_Ex = _mm512_fmadd_pd(x_local, common_E, sum_Ex);
+        sum_Ey = _mm512_fmadd_pd(y_local, common_E, sum_Ey);
+        sum_Bx = _mm512_fnmadd_pd(y_local, common_B, sum_Bx);
+        sum_By = _mm512_fmadd_pd(x_local, common_B, sum_By);
+    }
+    sums[0] = _mm512_reduce_add_pd(sum_Ex);
+    sums[1] = _mm512_reduce_add_pd(sum_Ey);
+    sums[2] = _mm512_reduce_add_pd(sum_Bx);
+    sums[3] = _mm512_reduce_add_pd(sum_By);
+}
+__attribute__((target("avx512f")))
+static inline void participant_node_term_avx512(__m512d r_sq, __m512d c,
+                                                __m512d exp_offset,
+                                                __m512d *kernel,
+                                                __m512d *derivative) {
+    __m512d Delta = _mm512_sqrt_pd(r_sq);
+    __m512d inv_Delta_cubic = _mm512_div_pd(
+        _mm512_set1_pd(1.0),
+        _mm512_fmadd_pd(_mm512_mul_pd(Delta, Delta), Delta,
+                        _mm512_set1_pd(1e-15)));
+    __m512d prefactor = _mm512_fmadd_pd(c, Delta, _mm512_set1_pd(1.0));
+    __m512d exp_A = exp_avx512(_mm512_fnmadd_pd(c, Delta, exp_offset));
+    __m512d kernel_no_exp = _mm512_mul_pd(prefactor, inv_Delta_cubic);
+    *kernel = _mm512_mul_pd(kernel_no_exp, exp_A);
+    *derivative = _mm512_mul_pd(
+        _mm512_mul_pd(exp_A, _mm512_mul_pd(inv_Delta_cubic,
+                                           _mm512_set1_pd(-0.5))),
+        _mm512_fmadd_pd(c, c, _mm512_mul_pd(_mm512_set1_pd(3.0),
+                                            _mm512_mul_pd(Delta,
+                                                          kernel_no_exp))));
+}
+
+__attribute__((target("avx512f")))
+static void participant_node_avx512(const participant_kernel_args &args,
+                                    double r_sq_in, double *node_values) {
+    __m512d r_sq = _mm512_set1_pd(r_sq_in);
+    __m512d sums[8];
+    for (int q = 0; q < 8; q++) {
+        sums[q] = _mm512_setzero_pd();
+    }
+    for (int k = 0; k < args.n_nodes; k += 8) {
+        __m512d c = _mm512_loadu_pd(args.c + k);
+        __m512d weight_E = _mm512_loadu_pd(args.weight_E + k);
+        __m512d weight_B = _mm512_loadu_pd(args.weight_B + k);
+        __m512d kernel_1, derivative_1, kernel_2, derivative_2;
+        participant_node_term_avx512(
+            _mm512_add_pd(r_sq, _mm512_loadu_pd(args.z_1_sq + k)), c,
+            _mm512_loadu_pd(args.exp_offset_1 + k), &kernel_1,
+            &derivative_1);
+        participant_node_term_avx512(
+            _mm512_add_pd(r_sq, _mm512_loadu_pd(args.z_2_sq + k)), c,
+            _mm512_loadu_pd(args.exp_offset_2 + k), &kernel_2,
+            &derivative_2);
+        sums[0] = _mm512_fmadd_pd(weight_E, kernel_1, sums[0]);
+        sums[1] = _mm512_fmadd_pd(weight_E, kernel_2, sums[1]);
+        sums[2] = _mm512_fmadd_pd(weight_B, kernel_1, sums[2]);
+        sums[3] = _mm512_fmadd_pd(weight_B, kernel_2, sums[3]);
+        sums[4] = _mm512_fmadd_pd(weight_E, derivative_1, sums[4]);
+        sums[5] = _mm512_fmadd_pd(weight_E, derivative_2, sums[5]);
+        sums[6] = _mm512_fmadd_pd(weight_B, derivative_1, sums[6]);
+        sums[7] = _mm512_fmadd_pd(weight_B, derivative_2, sums[7]);
+    }
+    for (int q = 0; q < 8; q++) {
+        node_values[q] = _mm512_reduce_add_pd(sums[q]);
+    }
+}
+__attribute__((target("avx512f")))
+static inline __m512 exp_float_avx512(__m512 x) {
+    __m512 lower = _mm512_set1_ps(exp_lower_bound_float);
+    __mmask16 in_range = _mm512_cmp_ps_mask(x, lower, _CMP_GE_OQ);
+    x = _mm512_max_ps(x, lower);
+    x = _mm512_min_ps(x, _mm512_set1_ps(exp_upper_bound_float));
+    __m512 n = _mm512_maskz_roundscale_ps(
+        (__mmask16)-1,
+        _mm512_mul_ps(x, _mm512_set1_ps(static_cast<float>(exp_log2e))),
+        _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+    __m512 r = _mm512_fnmadd_ps(n, _mm512_set1_ps(exp_ln2_hi_float), x);
+    r = _mm512_fnmadd_ps(n, _mm512_set1_ps(exp_ln2_lo_float), r);
+    __m512 p = _mm512_set1_ps(static_cast<float>(exp_taylor_coeff[7]));
+    for (int k = 6; k >= 0; k--) {
+        p = _mm512_fmadd_ps(
+            p, r, _mm512_set1_ps(static_cast<float>(exp_taylor_coeff[k])));
+    }
+    return(_mm512_maskz_mov_ps(in_range, _mm512_scalef_ps(p, n)));
+}
+
+template <bool conductive>
+__attribute__((target("avx512f")))
+static inline __m512 spectator_term_float_avx512(__m512 r_sq, __m512 z_sq,
+                                                 __m512 z_signed,
+                                                 bool forward, __m512 rho,
+                                                 __m512 c) {
+    __m512 Delta_sq = _mm512_add_ps(r_sq, z_sq);
+    __m512 inv_D = _mm512_rsqrt14_ps(Delta_sq);
+    inv_D = _mm512_mul_ps(inv_D, _mm512_fnmadd_ps(
+        _mm512_mul_ps(Delta_sq, _mm512_set1_ps(0.5f)),
+        _mm512_mul_ps(inv_D, inv_D), _mm512_set1_ps(1.5f)));
+    __mmask16 regular = _mm512_cmp_ps_mask(
+        Delta_sq, _mm512_set1_ps(tiny_r_sq_float), _CMP_GE_OQ);
+    inv_D = _mm512_maskz_mov_ps(regular, inv_D);
+    __m512 Delta = _mm512_mul_ps(Delta_sq, inv_D);
+    __m512 cap = _mm512_set1_ps(inverse_cubic_cap_float);
+    __m512 inv_D_cubic = _mm512_mask_min_ps(
+        cap, regular, _mm512_mul_ps(_mm512_mul_ps(inv_D, inv_D), inv_D), cap);
+    if (!conductive) {
+        return(_mm512_mul_ps(rho, inv_D_cubic));
+    }
+    __m512 z_minus_Delta;
+    if (forward) {
+        z_minus_Delta = _mm512_div_ps(
+            _mm512_sub_ps(_mm512_setzero_ps(), r_sq),
+            _mm512_add_ps(Delta, z_signed));
+    } else {
+        z_minus_Delta = _mm512_sub_ps(z_signed, Delta);
+    }
+    __m512 exp_A = exp_float_avx512(_mm512_mul_ps(c, z_minus_Delta));
+    return(_mm512_mul_ps(
+        _mm512_mul_ps(rho, inv_D_cubic),
+        _mm512_mul_ps(_mm512_fmadd_ps(c, Delta, _mm512_set1_ps(1.f)),
+                      exp_A)));
+}
+
+__attribute__((target("avx512f")))
+static inline void kahan_add_avx512(__m512 term, __m512 *sum,
+                                    __m512 *compensation) {
+    __m512 y = _mm512_sub_ps(term, *compensation);
+    __m512 t = _mm512_add_ps(*sum, y);
+    *compensation = _mm512_sub_ps(_mm512_sub_ps(t, *sum), y);
+    *sum = t;
+}
+
+template <bool conductive>
+__attribute__((target("avx512f")))
+static void spectator_kernel_float_avx512(const source_list_float &sources,
+                                          const spectator_kernel_args &args,
+                                          double *sums) {
+    __m512 c = _mm512_set1_ps(
+                static_cast<float>(args.sigma/2.*args.sinh_spectator_rap));
+    __m512 field_x = _mm512_set1_ps(static_cast<float>(args.field_x));
+    __m512 field_y = _mm512_set1_ps(static_cast<float>(args.field_y));
+    __m512 z_1_sq = _mm512_set1_ps(static_cast<float>(args.z_1*args.z_1));
+    __m512 z_2_sq = _mm512_set1_ps(static_cast<float>(args.z_2*args.z_2));
+    __m512 z_1_signed = _mm512_set1_ps(static_cast<float>(args.z_1));
+    __m512 z_2_signed = _mm512_set1_ps(static_cast<float>(-args.z_2));
+    bool forward_1 = (static_cast<float>(args.z_1) > 0.f);
+    bool forward_2 = (static_cast<float>(-args.z_2) > 0.f);
+    __m512 sum[6], compensation[6];
+    for (int k = 0; k < 6; k++) {
+        sum[k] = _mm512_setzero_ps();
+        compensation[k] = _mm512_setzero_ps();
+    }
+    for (int i = 0; i < sources.padded_length; i += 16) {
+        __m512 x_local = _mm512_sub_ps(field_x,
+                                       _mm512_load_ps(sources.x + i));
+        __m512 y_local = _mm512_sub_ps(field_y,
+                                       _mm512_load_ps(sources.y + i));
+        __m512 r_perp_sq = _mm512_fmadd_ps(
+            x_local, x_local, _mm512_mul_ps(y_local, y_local));
+        __m512 integrand_1 = spectator_term_float_avx512<conductive>(
+            r_perp_sq, z_1_sq, z_1_signed, forward_1,
+            _mm512_load_ps(sources.rho_1 + i), c);
+        __m512 integrand_2 = spectator_term_float_avx512<conductive>(
+            r_perp_sq, z_2_sq, z_2_signed, forward_2,
+            _mm512_load_ps(sources.rho_2 + i), c);
+        __m512 common_E = _mm512_add_ps(integrand_1, integrand_2);
+        __m512 common_B = _mm512_sub_ps(integrand_1, integrand_2);
+        kahan_add_avx512(_mm512_mul_ps(x_local, common_E), &sum[0],
+                         &compensation[0]);
+        kahan_add_avx512(_mm512_mul_ps(y_local, common_E), &sum[1],
+                         &compensation[1]);
+        kahan_add_avx512(_mm512_mul_ps(_mm512_sub_ps(_mm512_setzero_ps(),
+                                                     y_local), common_B),
+                         &sum[2], &compensation[2]);
+        kahan_add_avx512(_mm512_mul_ps(x_local, common_B), &sum[3],
+                         &compensation[3]);
+        if (!conductive) {
+            kahan_add_avx512(integrand_1, &sum[4], &compensation[4]);
+            kahan_add_avx512(integrand_2, &sum[5], &compensation[5]);
+        }
+    }
+    double combined[6];
+    for (int k = 0; k < 6; k++) {
+        float lanes[16], lanes_compensation[16];
+        _mm512_storeu_ps(lanes, sum[k]);
+        _mm512_storeu_ps(lanes_compensation, compensation[k]);
+        combined[k] = 0.0;
+        for (int l = 0; l < 16; l++) {
+            combined[k] += (static_cast<double>(lanes[l])
+                            - static_cast<double>(lanes_compensation[l]));
+        }
+    }
+    for (int k = 0; k < 4; k++) {
+        sums[k] = combined[k];
+    }
+    sums[4] = spectator_Ez_sum<conductive>(args, combined[4], combined[5]);
+}
+#endif  // FIELD_KERNELS_X86
+
+template <bool conductive>
+void spectator_kernel(int isa, const source_list &sources,
+                      const spectator_kernel_args &args, double *sums) {
+#ifdef FIELD_KERNELS_X86
+    if (isa == KERNEL_ISA_AVX512) {
+        spectator_kernel_avx512<conductive>(sources, args, sums);
+        return;
+    } else if (isa == KERNEL_ISA_AVX2) {
+        spectator_kernel_avx2<conductive>(sources, args, sums);
+        return;
+    }
+#endif
+    spectator_kernel_scalar<conductive>(sources, args, sums);
+}
+
+template <bool conductive>
+void spectator_kernel(int isa, const source_list_float &sources,
+                      const spectator_kernel_args &args, double *sums) {
+#ifdef FIELD_KERNELS_X86
+    if (isa == KERNEL_ISA_AVX512) {
+        spectator_kernel_float_avx512<conductive>(sources, args, sums);
+        return;
+    } else if (isa == KERNEL_ISA_AVX2) {
+        spectator_kernel_float_avx2<conductive>(sources, args, sums);
+        return;
+    }
+#endif
+    spectator_kernel_float_scalar<conductive>(sources, args, sums);
+}
+
+template void spectator_kernel<true>(int isa, const source_list &sources,
+                                     const spectator_kernel_args &args,
+                                     double *sums);
+template void spectator_kernel<false>(int isa, const source_list &sources,
+                                      const spectator_kernel_args &args,
+                                      double *sums);
+template void spectator_kernel<true>(int isa,
+                                     const source_list_float &sources,
+                                     const spectator_kernel_args &args,
+                                     double *sums);
+template void spectator_kernel<false>(int isa,
+                                      const source_list_float &sources,
+                                      const spectator_kernel_args &args,
+                                      double *sums);
+
+template <bool conductive>
+static bool spectator_kernel_group_simd(int isa, int n_group,
+                                        const source_list &sources,
+                                        const spectator_kernel_args *args,
+                                        double *sums) {
+    // the group width is a template parameter so that the accumulators of
+    // all cells stay in registers
+#ifdef FIELD_KERNELS_X86
+    if (isa == KERNEL_ISA_AVX512) {
+        if (n_group == 1) {
+            spectator_kernel_group_avx512<conductive, 1>(sources, args, sums);
+        } else if (n_group == 2) {
+            spectator_kernel_group_avx512<conductive, 2>(sources, args, sums);
+        } else if (n_group == 3) {
+            spectator_kernel_group_avx512<conductive, 3>(sources, args, sums);
+        } else {
+            spectator_kernel_group_avx512<conductive, 4>(sources, args, sums);
+        }
+        return(true);
+    } else if (isa == KERNEL_ISA_AVX2) {
+        if (n_group == 1) {
+            spectator_kernel_group_avx2<conductive, 1>(sources, args, sums);
+        } else if (n_group == 2) {
+            spectator_kernel_group_avx2<conductive, 2>(sources, args, sums);
+        } else if (n_group == 3) {
+            spectator_kernel_group_avx2<conductive, 3>(sources, args, sums);
+        } else {
+            spectator_kernel_group_avx2<conductive, 4>(sources, args, sums);
+        }
+        return(true);
+    }
+#endif
+    return(false);
+}
+
+template <bool conductive>
+void spectator_kernel_group(int isa, const source_list &sources,
+                            const spectator_kernel_args *args, int n_cells,
+                            double *sums) {
+    for (int j = 0; j < n_cells; j += spectator_group_width) {
+        int n_group = min(spectator_group_width, n_cells - j);
+        if (!spectator_kernel_group_simd<conductive>(
+                    isa, n_group, sources, args + j,
+                    sums + n_spectator_sums*j)) {
+            spectator_kernel_group_scalar<conductive>(
+                    sources, args + j, n_group, sums + n_spectator_sums*j);
+        }
+    }
+}
+
+template <bool conductive>
+void spectator_kernel_group(int isa, const source_list_float &sources,
+                            const spectator_kernel_args *args, int n_cells,
+                            double *sums) {
+    for (int j = 0; j < n_cells; j++) {
+        spectator_kernel<conductive>(isa, sources, args[j],
+                                     sums + n_spectator_sums*j);
+    }
+}
+
+template void spectator_kernel_group<true>(
+            int isa, const source_list &sources,
+            const spectator_kernel_args *args, int n_cells, double *sums);
+template void spectator_kernel_group<false>(
+            int isa, const source_list &sources,
+            const spectator_kernel_args *args, int n_cells, double *sums);
+template void spectator_kernel_group<true>(
+            int isa, const source_list_float &sources,
+            const spectator_kernel_args *args, int n_cells, double *sums);
+template void spectator_kernel_group<false>(
+            int isa, const source_list_float &sources,
+            const spectator_kernel_args *args, int n_cells, double *sums);
+
+void participant_kernel(int isa, const source_list &sources,
+                        const participant_kernel_args &args, double *sums) {
+#ifdef FIELD_KERNELS_X86
+    if (isa == KERNEL_ISA_AVX512) {
+        participant_kernel_avx512(sources, args, sums);
+        return;
+    } else if (isa == KERNEL_ISA_AVX2) {
+        participant_kernel_avx2(sources, args, sums);
+        return;
+    }
+#endif
+    participant_kernel_scalar(sources, args, sums);
+}
+
+void fill_participant_kernel_table(int isa,
+                                   const participant_kernel_args &args,
+                                   double r_sq_min, double r_sq_max,
+                                   participant_kernel_table *table) {
+    int segment_bits = table->segment_bits;
+    uint64_t base = double_bits(r_sq_min) >> (52 - segment_bits);
+    int n_segments = static_cast<int>(
+                    (double_bits(r_sq_max) >> (52 - segment_bits)) - base);
+    if (n_segments > table->capacity) {
+        cout << "Error:fill_participant_kernel_table: the range "
+             << r_sq_min << " to " << r_sq_max << " fm^2 exceeds the "
+             << "table capacity!" << endl;
+        exit(1);
+    }
+    table->n_segments = n_segments;
+    table->r_sq_min = r_sq_min;
+    table->r_sq_max = r_sq_max;
+    for (int node = 0; node <= n_segments; node++) {
+        double r_sq = bits_double((base + node) << (52 - segment_bits));
+        double *node_values = table->node_values + 8*node;
+#ifdef FIELD_KERNELS_X86
+        if (isa == KERNEL_ISA_AVX512) {
+            participant_node_avx512(args, r_sq, node_values);
+            continue;
+        }
+#endif
+        participant_node_scalar(args, r_sq, node_values);
+    }
+    // cubic Hermite polynomials in the fraction of each segment
+    for (int i = 0; i < n_segments; i++) {
+        double width = (
+            bits_double((base + i + 1) << (52 - segment_bits))
+            - bits_double((base + i) << (52 - segment_bits)));
+        const double *lo = table->node_values + 8*i;
+        const double *hi = lo + 8;
+        for (int q = 0; q < 4; q++) {
+            double slope_lo = width*lo[4 + q];
+            double slope_hi = width*hi[4 + q];
+            double *coeff = table->coeff + 16*i + 4*q;
+            coeff[0] = lo[q];
+            coeff[1] = slope_lo;
+            coeff[2] = 3.*(hi[q] - lo[q]) - 2.*slope_lo - slope_hi;
+            coeff[3] = 2.*(lo[q] - hi[q]) + slope_lo + slope_hi;
+        }
+    }
+}
+
+void participant_table_kernel(const source_list &sources,
+                              const participant_kernel_args &args,
+                              const participant_kernel_table &table,
+                              double *sums) {
+    static const uint64_t mantissa_mask = 0x000FFFFFFFFFFFFFULL;
+    static const uint64_t one_bits = 0x3FF0000000000000ULL;
+    int segment_bits = table.segment_bits;
+    uint64_t base = double_bits(table.r_sq_min) >> (52 - segment_bits);
+    double temp_sum_Ex = 0.0;
+    double temp_sum_Ey = 0.0;
+    double temp_sum_Bx = 0.0;
+    double temp_sum_By = 0.0;
+    for (int i = 0; i < sources.length; i++) {
+        double x_local = args.field_x - sources.x[i];
+        double y_local = args.field_y - sources.y[i];
+        double r_perp_local_sq = x_local*x_local + y_local*y_local;
+        if (r_perp_local_sq < table.r_sq_min
+            || r_perp_local_sq >= table.r_sq_max) {
+            continue;
+        }
+        uint64_t bits = double_bits(r_perp_local_sq);
+        int segment = static_cast<int>((bits >> (52 - segment_bits)) - base);
+        double f = bits_double(((bits << segment_bits) & mantissa_mask)
+                               | one_bits) - 1.;
+        const double *coeff = table.coeff + 16*segment;
+        double kernel[4];
+        for (int q = 0; q < 4; q++) {
+            kernel[q] = (((coeff[4*q + 3]*f + coeff[4*q + 2])*f
+                          + coeff[4*q + 1])*f + coeff[4*q]);
+        }
+        double common_integrand_E = (sources.rho_1[i]*kernel[0]
+                                     + sources.rho_2[i]*kernel[1]);
+        double common_integrand_B = (sources.rho_1[i]*kernel[2]
+                                     - sources.rho_2[i]*kernel[3]);
+        temp_sum_Ex += x_local*common_integrand_E;
+        temp_sum_Ey += y_local*common_integrand_E;
+        temp_sum_Bx += -y_local*common_integrand_B;
+        temp_sum_By += x_local*common_integrand_B;
+    }
+    sums[0] = temp_sum_Ex;
+    sums[1] = temp_sum_Ey;
+    sums[2] = temp_sum_Bx;
+    sums[3] = temp_sum_By;
+}
@@ -0,0 +1,156 @@
+// Copyright 2016 Chun Shen
+#ifndef SRC_FIELD_KERNELS_H_
+#define SRC_FIELD_KERNELS_H_
+
+// instruction sets for the spectator source kernel
+enum kernel_isa_type {
+    KERNEL_ISA_SCALAR = 0,
+    KERNEL_ISA_AVX2 = 1,
+    KERNEL_ISA_AVX512 = 2
+};
+
+// source points of the transverse charge densities, stored as contiguous
+// 64-byte aligned arrays. The arrays are padded with zero-density points up
+// to a multiple of the widest SIMD register so that the vector kernels never
+// need a remainder loop.
+struct source_list {
+    int length;                 // number of physical source points
+    int padded_length;          // length rounded up to kernel_simd_width
+    int capacity;               // allocated points, 0 for tiles
+    double *x, *y;              // transverse position of the source [fm]
+    double *rho_1, *rho_2;      // densities of nucleus 1 and 2 [1/fm^2]
+};
+
+// single precision copy of a source list for the float32 kernels, padded to
+// kernel_simd_width_float
+struct source_list_float {
+    int length;
+    int padded_length;
+    int capacity;
+    float *x, *y;
+    float *rho_1, *rho_2;
+};
+
+// per-cell constants of the spectator integrand
+struct spectator_kernel_args {
+    double field_x, field_y;    // transverse position of the fluid cell
+    double z_1, z_2;            // longitudinal distance to the spectators
+    double sigma;               // electric conductivity [1/fm]
+    double sinh_spectator_rap;
+};
+
+// per-cell constants of the participant integrand at the rapidity nodes y_k
+// of the quadrature. All arrays hold n_nodes entries, padded with
+// zero-weight nodes to a multiple of kernel_simd_width.
+struct participant_kernel_args {
+    double field_x, field_y;    // transverse position of the fluid cell
+    int n_nodes;
+    const double *z_1_sq, *z_2_sq;  // squared longitudinal distances
+    // exponent offsets sigma/2*sinh(y_k)*z_1 and -sigma/2*sinh(y_k)*z_2
+    const double *exp_offset_1, *exp_offset_2;
+    const double *c;            // sigma/2*|sinh(y_k)|
+    // quadrature weights including cosh(y_k) (E) or sinh(y_k) (B) and the
+    // rapidity distribution of the participants
+    const double *weight_E, *weight_B;
+};
+
+// rapidity-integrated participant kernels of one cell tabulated on
+// r_perp^2. The nodes are taken from the leading bits of r_perp^2, with
+// 2^segment_bits segments per octave between the powers of two r_sq_min and
+// r_sq_max, and each segment holds the cubic Hermite polynomials of the four
+// kernels sum_k weight_E*K_1, weight_E*K_2, weight_B*K_1, weight_B*K_2.
+struct participant_kernel_table {
+    int segment_bits;
+    int capacity;               // maximal number of segments
+    int n_segments;
+    double r_sq_min, r_sq_max;
+    double *coeff;              // [segment][kernel][4]
+    double *node_values;        // [node][kernel value, kernel derivative]
+};
+
+const int kernel_simd_width = 8;
+const int kernel_simd_width_float = 16;
+const int n_spectator_sums = 5;     // Ex, Ey, Bx, By, Ez
+// cells evaluated together by spectator_kernel_group()
+const int spectator_group_width = 4;
+
+void allocate_source_list(source_list *sources, int length);
+// sets the list to length zero-density points, the arrays are only
+// reallocated if they are too short. The list has to be allocated or
+// zero-initialized.
+void resize_source_list(source_list *sources, int length);
+void free_source_list(source_list *sources);
+// the float arrays are reused like in resize_source_list(), sources_float
+// has to be allocated or zero-initialized
+void convert_source_list_to_float(const source_list &sources,
+                                  source_list_float *sources_float);
+void free_source_list_float(source_list_float *sources);
+// views of the sources in [begin, end) sharing the storage of the list, end
+// has to be a multiple of the SIMD width or the padded length
+source_list get_source_tile(const source_list &sources, int begin, int end);
+source_list_float get_source_tile(const source_list_float &sources,
+                                  int begin, int end);
+
+int detect_kernel_isa();
+const char* kernel_isa_name(int isa);
+
+// accumulates the spectator integrand over all sources into
+// sums = {sum x*E_common, sum y*E_common, sum -y*B_common, sum x*B_common,
+//         sum of the Ez integrand}.
+// The kernel is instantiated with and without the electric conductivity.
+// Without conductivity the integrand reduces to rho/Delta^3 and the
+// longitudinal field is kept, with conductivity it is neglected
+// (sums[4] = 0).
+template <bool conductive>
+void spectator_kernel(int isa, const source_list &sources,
+                      const spectator_kernel_args &args, double *sums);
+
+// spectator_kernel() for n_cells cells at the same transverse position,
+// which only differ in z_1 and z_2 (boost invariant surfaces, tau scans).
+// x_local, y_local, r_perp^2 and the densities are computed once per source
+// for up to spectator_group_width cells. sums holds n_spectator_sums
+// entries per cell, identical to the results of spectator_kernel().
+template <bool conductive>
+void spectator_kernel_group(int isa, const source_list &sources,
+                            const spectator_kernel_args *args, int n_cells,
+                            double *sums);
+
+// single precision version of spectator_kernel(). The integrand is
+// evaluated in float32 and accumulated with Kahan compensated sums in every
+// vector lane, the lanes are combined in double precision.
+template <bool conductive>
+void spectator_kernel(int isa, const source_list_float &sources,
+                      const spectator_kernel_args &args, double *sums);
+
+// the single precision kernels keep their compensated sums per cell, so
+// the group version evaluates the cells one by one
+template <bool conductive>
+void spectator_kernel_group(int isa, const source_list_float &sources,
+                            const spectator_kernel_args *args, int n_cells,
+                            double *sums);
+
+// accumulates the participant integrand over all sources and rapidity nodes
+// into sums = {Ex, Ey, Bx, By}. The nodes are processed in the inner loop so
+// that each source is loaded once per cell.
+void participant_kernel(int isa, const source_list &sources,
+                        const participant_kernel_args &args, double *sums);
+
+void allocate_participant_kernel_table(participant_kernel_table *table,
+                                       int segment_bits);
+void free_participant_kernel_table(participant_kernel_table *table);
+
+// integrates the participant kernels over the rapidity nodes at the table
+// nodes between r_sq_min and r_sq_max (both powers of two)
+void fill_participant_kernel_table(int isa,
+                                   const participant_kernel_args &args,
+                                   double r_sq_min, double r_sq_max,
+                                   participant_kernel_table *table);
+
+// same sums as participant_kernel() with the tabulated kernels, sources
+// outside [r_sq_min, r_sq_max) of the table do not contribute
+void participant_table_kernel(const source_list &sources,
+                              const participant_kernel_args &args,
+                              const participant_kernel_table &table,
+                              double *sums);
+
+#endif  // SRC_FIELD_KERNELS_H_
@@ -0,0 +1,245 @@
+// Copyright 2016 Chun Shen
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <iostream>
+#include <fstream>
+#include <cmath>
+#include <algorithm>
+#include <sstream>
+
+#include "./field_lattice.h"
+
+using namespace std;
+
+static const char field_lattice_magic[8] = {'E', 'M', 'L', 'A', 'T', 'T',
+                                            '0', '2'};
+static const int n_field_components = 6;
+
+Field_lattice::Field_lattice(const double *lower_in, const double *upper_in,
+                             const double *max_spacing, int order_in,
+                             uint64_t event_hash_in) {
+    order = order_in;
+    event_hash = event_hash_in;
+    if (order != 1 && order != 3) {
+        cout << "Field_lattice:: Error: interpolation order " << order
+             << " is not 1 or 3!" << endl;
+        exit(1);
+    }
+    for (int d = 0; d < 4; d++) {
+        double extent = upper_in[d] - lower_in[d];
+        lower[d] = lower_in[d];
+        n_points[d] = 1;
+        spacing[d] = 0.0;
+        if (extent > 0.0 && max_spacing[d] > 0.0) {
+            n_points[d] = static_cast<int>(ceil(extent/max_spacing[d]
+                                                - 1e-8)) + 1;
+            n_points[d] = max(n_points[d], 2);
+            spacing[d] = extent/(n_points[d] - 1);
+        }
+    }
+    fields = new double[n_field_components*get_number_of_nodes()];
+    for (long i = 0; i < n_field_components*get_number_of_nodes(); i++) {
+        fields[i] = 0.0;
+    }
+    has_fields = new char[get_number_of_nodes()];
+    for (long node = 0; node < get_number_of_nodes(); node++) {
+        has_fields[node] = 0;
+    }
+}
+
+Field_lattice::~Field_lattice() {
+    delete[] fields;
+    delete[] has_fields;
+}
+
+long Field_lattice::get_number_of_nodes() {
+    return(static_cast<long>(n_points[0])*n_points[1]*n_points[2]
+           *n_points[3]);
+}
+
+void Field_lattice::get_node_position(long node, double *position) {
+    for (int d = 3; d >= 0; d--) {
+        position[d] = lower[d] + (node % n_points[d])*spacing[d];
+        node /= n_points[d];
+    }
+}
+
+void Field_lattice::set_node_fields(long node, const double *E,
+                                    const double *B) {
+    double *node_fields = fields + n_field_components*node;
+    for (int k = 0; k < 3; k++) {
+        node_fields[k] = E[k];
+        node_fields[3 + k] = B[k];
+    }
+    has_fields[node] = 1;
+}
+
+void Field_lattice::mark_stencil_nodes(const double *position,
+                                       char *needed) {
+    int first[4], n_stencil[4];
+    double weights[4];
+    for (int d = 0; d < 4; d++) {
+        first[d] = set_stencil(d, position[d], &n_stencil[d], weights);
+    }
+    for (int i_tau = 0; i_tau < n_stencil[0]; i_tau++) {
+        for (int i_x = 0; i_x < n_stencil[1]; i_x++) {
+            for (int i_y = 0; i_y < n_stencil[2]; i_y++) {
+                long node = (
+                    ((static_cast<long>(first[0] + i_tau)*n_points[1]
+                      + first[1] + i_x)*n_points[2] + first[2] + i_y)
+                    *n_points[3] + first[3]);
+                for (int i_eta = 0; i_eta < n_stencil[3]; i_eta++) {
+                    needed[node + i_eta] = 1;
+                }
+            }
+        }
+    }
+}
+
+int Field_lattice::set_stencil(int direction, double position,
+                               int *n_stencil, double *weights) {
+    int n = n_points[direction];
+    *n_stencil = min(order + 1, n);
+    if (n == 1) {
+        weights[0] = 1.0;
+        return(0);
+    }
+    double t = (position - lower[direction])/spacing[direction];
+    int cell = min(max(static_cast<int>(floor(t)), 0), n - 2);
+    int first = min(max(cell - (*n_stencil/2 - 1), 0), n - *n_stencil);
+    for (int k = 0; k < *n_stencil; k++) {
+        double weight = 1.0;
+        for (int l = 0; l < *n_stencil; l++) {
+            if (l != k) {
+                weight *= (t - (first + l))/static_cast<double>(k - l);
+            }
+        }
+        weights[k] = weight;
+    }
+    return(first);
+}
+
+void Field_lattice::interpolate(const double *position, double *E,
+                                double *B) {
+    int first[4], n_stencil[4];
+    double weights[4][4];
+    for (int d = 0; d < 4; d++) {
+        first[d] = set_stencil(d, position[d], &n_stencil[d], weights[d]);
+    }
+    double result[n_field_components];
+    for (int k = 0; k < n_field_components; k++) {
+        result[k] = 0.0;
+    }
+    for (int i_tau = 0; i_tau < n_stencil[0]; i_tau++) {
+        for (int i_x = 0; i_x < n_stencil[1]; i_x++) {
+            for (int i_y = 0; i_y < n_stencil[2]; i_y++) {
+                double weight_3d = (weights[0][i_tau]*weights[1][i_x]
+                                    *weights[2][i_y]);
+                long node = (
+                    ((static_cast<long>(first[0] + i_tau)*n_points[1]
+                      + first[1] + i_x)*n_points[2] + first[2] + i_y)
+                    *n_points[3] + first[3]);
+                const double *node_fields = fields + n_field_components*node;
+                for (int i_eta = 0; i_eta < n_stencil[3]; i_eta++) {
+                    double weight = weight_3d*weights[3][i_eta];
+                    for (int k = 0; k < n_field_components; k++) {
+                        result[k] += (
+                            weight*node_fields[n_field_components*i_eta + k]);
+                    }
+                }
+            }
+        }
+    }
+    for (int k = 0; k < 3; k++) {
+        E[k] = result[k];
+        B[k] = result[3 + k];
+    }
+}
+
+void Field_lattice::get_stencil_range(int direction, double position,
+                                      double *stencil_lower,
+                                      double *stencil_upper) {
+    int n_stencil;
+    double weights[4];
+    int first = set_stencil(direction, position, &n_stencil, weights);
+    *stencil_lower = lower[direction] + first*spacing[direction];
+    *stencil_upper = *stencil_lower + (n_stencil - 1)*spacing[direction];
+}
+
+bool Field_lattice::read_from_file(string filename) {
+    ifstream lattice_file(filename.c_str(), ios::binary);
+    if (!lattice_file.good()) {
+        return(false);
+    }
+    char magic[8];
+    int n_points_file[4];
+    double lower_file[4], spacing_file[4];
+    uint64_t event_hash_file;
+    lattice_file.read(magic, sizeof(magic));
+    lattice_file.read(reinterpret_cast<char*>(n_points_file),
+                      sizeof(n_points_file));
+    lattice_file.read(reinterpret_cast<char*>(lower_file),
+                      sizeof(lower_file));
+    lattice_file.read(reinterpret_cast<char*>(spacing_file),
+                      sizeof(spacing_file));
+    lattice_file.read(reinterpret_cast<char*>(&event_hash_file),
+                      sizeof(event_hash_file));
+    bool match = (lattice_file.good()
+                  && memcmp(magic, field_lattice_magic, 8) == 0
+                  && event_hash_file == event_hash);
+    for (int d = 0; d < 4 && match; d++) {
+        match = (n_points_file[d] == n_points[d]
+                 && lower_file[d] == lower[d]
+                 && spacing_file[d] == spacing[d]);
+    }
+    if (!match) {
+        cout << "Field_lattice:: lattice in " << filename
+             << " does not match the current setup, recomputing it" << endl;
+        return(false);
+    }
+    lattice_file.read(has_fields, get_number_of_nodes());
+    lattice_file.read(reinterpret_cast<char*>(fields),
+                      n_field_components*get_number_of_nodes()
+                      *sizeof(double));
+    if (!lattice_file.good()) {
+        for (long node = 0; node < get_number_of_nodes(); node++) {
+            has_fields[node] = 0;
+        }
+        cout << "Field_lattice:: lattice in " << filename
+             << " is truncated, recomputing it" << endl;
+        return(false);
+    }
+    lattice_file.close();
+    return(true);
+}
+
+void Field_lattice::write_to_file(string filename) {
+    ostringstream temporary_filename;
+    temporary_filename << filename << ".tmp" << getpid();
+    ofstream lattice_file(temporary_filename.str().c_str(), ios::binary);
+    if (!lattice_file.good()) {
+        cout << "Field_lattice:: Warning: can not write the field lattice to "
+             << filename << endl;
+        return;
+    }
+    lattice_file.write(field_lattice_magic, sizeof(field_lattice_magic));
+    lattice_file.write(reinterpret_cast<char*>(n_points), sizeof(n_points));
+    lattice_file.write(reinterpret_cast<char*>(lower), sizeof(lower));
+    lattice_file.write(reinterpret_cast<char*>(spacing), sizeof(spacing));
+    lattice_file.write(reinterpret_cast<char*>(&event_hash),
+                       sizeof(event_hash));
+    lattice_file.write(has_fields, get_number_of_nodes());
+    lattice_file.write(reinterpret_cast<char*>(fields),
+                       n_field_components*get_number_of_nodes()
+                       *sizeof(double));
+    lattice_file.close();
+    if (!lattice_file.good()
+        || rename(temporary_filename.str().c_str(), filename.c_str()) != 0) {
+        cout << "Field_lattice:: Warning: can not write the field lattice to "
+             << filename << endl;
+        remove(temporary_filename.str().c_str());
+    }
+}
@@ -0,0 +1,76 @@
+// Copyright 2016 Chun Shen
+#ifndef SRC_FIELD_LATTICE_H_
+#define SRC_FIELD_LATTICE_H_
+
+#include <stdint.h>
+
+#include <string>
+
+using namespace std;
+
+// Regular (ln(tau), x, y, eta) lattice of the lab frame fields E and B. The
+// lattice covers a box with n_points nodes in every direction, a direction
+// with zero extent holds a single node.
+//
+// The fields between the nodes are interpolated with Lagrange polynomials
+// of the given order in every direction (1: quadrilinear, 3: cubic with a
+// 4^4 node stencil). Near the edges of the box the stencil is shifted
+// inwards so that the interpolation keeps its order.
+//
+// The nodes are numbered with eta running fastest, so that consecutive
+// nodes share their transverse position. Only the nodes entering the
+// stencils of the interpolated points need to be computed, the lattice
+// keeps track of the nodes holding fields.
+class Field_lattice {
+ private:
+    int n_points[4];            // nodes in ln(tau), x, y and eta
+    double lower[4];            // position of the first node
+    double spacing[4];
+    int order;
+    // hash of the sources, the medium and the kernel settings the fields
+    // were computed with
+    uint64_t event_hash;
+    double *fields;             // [node][Ex, Ey, Ez, Bx, By, Bz]
+    char *has_fields;           // 1 for the nodes whose fields are set
+
+    // first node and Lagrange weights of the interpolation stencil along
+    // direction
+    int set_stencil(int direction, double position, int *n_stencil,
+                    double *weights);
+
+ public:
+    // the box [lower_in, upper_in] is covered with spacings of at most
+    // max_spacing
+    Field_lattice(const double *lower_in, const double *upper_in,
+                  const double *max_spacing, int order_in,
+                  uint64_t event_hash_in);
+    ~Field_lattice();
+
+    long get_number_of_nodes();
+    int get_number_of_points(int direction) {return(n_points[direction]);}
+    double get_spacing(int direction) {return(spacing[direction]);}
+
+    // position = {ln(tau), x, y, eta} of the node
+    void get_node_position(long node, double *position);
+    void set_node_fields(long node, const double *E, const double *B);
+    bool has_node_fields(long node) {return(has_fields[node] == 1);}
+
+    // sets needed[node] = 1 for the nodes of the stencil of position
+    void mark_stencil_nodes(const double *position, char *needed);
+
+    // fields at position = {ln(tau), x, y, eta} inside the box
+    void interpolate(const double *position, double *E, double *B);
+
+    // range [stencil_lower, stencil_upper] of the nodes entering the
+    // interpolation at position along direction
+    void get_stencil_range(int direction, double position,
+                           double *stencil_lower, double *stencil_upper);
+
+    // the fields are only read if the file holds the same lattice and
+    // event hash. The file is written to a temporary file first, which then
+    // replaces it, so that concurrent runs never read a partial lattice.
+    bool read_from_file(string filename);
+    void write_to_file(string filename);
+};
+
+#endif  // SRC_FIELD_LATTICE_H_
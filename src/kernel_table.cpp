@@ -0,0 +1,514 @@
+// Copyright 2016 Chun Shen
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+
+#include <iostream>
+#include <fstream>
+#include <cmath>
+#include <algorithm>
+#include <sstream>
+
+#include "./kernel_table.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define KERNEL_TABLE_X86
+// the AVX-512 intrinsics of GCC 12 start from _mm512_undefined_pd(), which
+// -Wall reports as uninitialized once they are inlined into the kernels
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wuninitialized"
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#include <immintrin.h>
+#pragma GCC diagnostic pop
+#endif
+
+using namespace std;
+
+static const char kernel_table_magic[8] = {'E', 'M', 'K', 'T', 'A', 'B',
+                                           '0', '1'};
+static const uint64_t mantissa_mask = 0x000FFFFFFFFFFFFFULL;
+static const uint64_t one_bits = 0x3FF0000000000000ULL;
+
+static inline uint64_t double_bits(double x) {
+    uint64_t bits;
+    memcpy(&bits, &x, sizeof(bits));
+    return(bits);
+}
+
+static inline double bits_double(uint64_t bits) {
+    double x;
+    memcpy(&x, &bits, sizeof(x));
+    return(x);
+}
+
+Kernel_table::Kernel_table(double c_in, string filename) {
+    c = c_in;
+    z_rows_per_octave = 16;
+    z_min = pow(2., -26);
+    n_z_rows = 54*z_rows_per_octave;
+    // the last interval keeps all four rows of the cubic interpolation
+    z_max = z_min*pow(2., (n_z_rows - 2.)/z_rows_per_octave);
+    segment_bits = 5;
+    r_sq_min = pow(2., -30);
+    r_sq_max = pow(2., 12);
+    n_segments = 42*(1 << segment_bits);
+    segment_width = new double[n_segments];
+    for (int i = 0; i < n_segments; i++) {
+        segment_width[i] = node_r_sq(i + 1) - node_r_sq(i);
+    }
+
+    long n_entries = static_cast<long>(2*n_z_rows + 1)*(n_segments + 1);
+    values = new double[n_entries];
+    derivatives = new double[n_entries];
+    if (!read_from_file(filename)) {
+        build_table();
+        estimate_error_bound();
+        write_to_file(filename);
+    }
+}
+
+Kernel_table::~Kernel_table() {
+    delete[] values;
+    delete[] derivatives;
+    delete[] segment_width;
+}
+
+double Kernel_table::exact_kernel(double r_perp_sq, double z,
+                                  double *derivative) {
+    // K and dK/d(r_perp^2) of the conductive spectator integrand
+    double Delta = sqrt(r_perp_sq + z*z);
+    double inv_Delta_cubic = 1./(Delta*Delta*Delta + 1e-15);
+    double prefactor = c*Delta + 1.;
+    // z - Delta without cancellation for z > 0
+    double A = (z > 0.) ? -c*r_perp_sq/(Delta + z) : c*(z - Delta);
+    double exp_A = exp(A);
+    *derivative = (-exp_A*inv_Delta_cubic
+                   *(c*c + 3.*Delta*prefactor*inv_Delta_cubic)/2.);
+    return(prefactor*inv_Delta_cubic*exp_A);
+}
+
+double Kernel_table::node_r_sq(int node) {
+    uint64_t base = double_bits(r_sq_min) >> (52 - segment_bits);
+    return(bits_double((base + node) << (52 - segment_bits)));
+}
+
+void Kernel_table::build_table() {
+    cout << "building the spectator kernel table ..." << endl;
+    int n_nodes = n_segments + 1;
+    #pragma omp parallel for
+    for (int row = 0; row < 2*n_z_rows + 1; row++) {
+        double z = 0.0;
+        if (row != n_z_rows) {
+            int k = abs(row - n_z_rows) - 1;
+            z = z_min*pow(2., static_cast<double>(k)/z_rows_per_octave);
+            if (row < n_z_rows) {
+                z = -z;
+            }
+        }
+        for (int node = 0; node < n_nodes; node++) {
+            long idx = static_cast<long>(row)*n_nodes + node;
+            values[idx] = exact_kernel(node_r_sq(node), z, &derivatives[idx]);
+        }
+    }
+}
+
+int Kernel_table::set_row_weights(double z, int *rows, double *weights) {
+    // rows and weights of the interpolation in z, returns their number
+    int sign = (z < 0.) ? -1 : 1;
+    double z_abs = fabs(z);
+    if (z_abs < z_min) {
+        // linear between z = 0 and the first row
+        rows[0] = n_z_rows;
+        rows[1] = n_z_rows + sign;
+        weights[1] = z_abs/z_min;
+        weights[0] = 1. - weights[1];
+        return(2);
+    }
+    double u = z_rows_per_octave*log2(z_abs/z_min);
+    int k_0 = static_cast<int>(floor(u));
+    double t = u - k_0;
+    double t_sq = t*t;
+    double t_cubic = t_sq*t;
+    weights[0] = (-t_cubic + 2.*t_sq - t)/2.;
+    weights[1] = (3.*t_cubic - 5.*t_sq + 2.)/2.;
+    weights[2] = (-3.*t_cubic + 4.*t_sq + t)/2.;
+    weights[3] = (t_cubic - t_sq)/2.;
+    for (int l = 0; l < 4; l++) {
+        int k = min(max(k_0 - 1 + l, 0), n_z_rows - 1);
+        rows[l] = n_z_rows + sign*(k + 1);
+    }
+    return(4);
+}
+
+void Kernel_table::fill_slice(double z, double *slice) {
+    int rows[4];
+    double weights[4];
+    int n_rows = set_row_weights(z, rows, weights);
+    int n_nodes = n_segments + 1;
+    // interpolated values and derivatives at the nodes are kept behind the
+    // polynomial coefficients
+    double *node_value = slice + 4*n_segments;
+    double *node_derivative = node_value + n_nodes;
+    for (int node = 0; node < n_nodes; node++) {
+        node_value[node] = 0.0;
+        node_derivative[node] = 0.0;
+    }
+    for (int l = 0; l < n_rows; l++) {
+        const double *row_values = values + static_cast<long>(rows[l])*n_nodes;
+        const double *row_derivatives = (
+                        derivatives + static_cast<long>(rows[l])*n_nodes);
+        double weight = weights[l];
+        for (int node = 0; node < n_nodes; node++) {
+            node_value[node] += weight*row_values[node];
+            node_derivative[node] += weight*row_derivatives[node];
+        }
+    }
+    // cubic Hermite polynomial in the fraction of each segment
+    for (int i = 0; i < n_segments; i++) {
+        double slope_lo = segment_width[i]*node_derivative[i];
+        double slope_hi = segment_width[i]*node_derivative[i + 1];
+        double *coeff = slice + 4*i;
+        coeff[0] = node_value[i];
+        coeff[1] = slope_lo;
+        coeff[2] = (3.*(node_value[i + 1] - node_value[i])
+                    - 2.*slope_lo - slope_hi);
+        coeff[3] = (2.*(node_value[i] - node_value[i + 1])
+                    + slope_lo + slope_hi);
+    }
+}
+
+double Kernel_table::evaluate(double r_perp_sq, double z) {
+    // table value at a single point, the same arithmetic as fill_slice()
+    // followed by the source loop
+    if (r_perp_sq < r_sq_min || r_perp_sq >= r_sq_max) {
+        return(0.0);
+    }
+    uint64_t bits = double_bits(r_perp_sq);
+    uint64_t base = double_bits(r_sq_min) >> (52 - segment_bits);
+    int segment = static_cast<int>((bits >> (52 - segment_bits)) - base);
+    double f = bits_double(((bits << segment_bits) & mantissa_mask)
+                           | one_bits) - 1.;
+    int rows[4];
+    double weights[4];
+    int n_rows = set_row_weights(z, rows, weights);
+    int n_nodes = n_segments + 1;
+    double value[2] = {0.0, 0.0};
+    double derivative[2] = {0.0, 0.0};
+    for (int m = 0; m < 2; m++) {
+        for (int l = 0; l < n_rows; l++) {
+            long idx = static_cast<long>(rows[l])*n_nodes + segment + m;
+            value[m] += weights[l]*values[idx];
+            derivative[m] += weights[l]*derivatives[idx];
+        }
+    }
+    double slope_lo = segment_width[segment]*derivative[0];
+    double slope_hi = segment_width[segment]*derivative[1];
+    double coeff_2 = 3.*(value[1] - value[0]) - 2.*slope_lo - slope_hi;
+    double coeff_3 = 2.*(value[0] - value[1]) + slope_lo + slope_hi;
+    return(((coeff_3*f + coeff_2)*f + slope_lo)*f + value[0]);
+}
+
+void Kernel_table::estimate_error_bound() {
+    // the largest interpolation error at random points, measured relative
+    // to the undamped Coulomb kernel (c*Delta + 1)/Delta^3 at the same point
+    // so that strongly damped kernels do not dominate the estimate
+    int n_samples = 200000;
+    srand48(1);
+    error_bound = 0.0;
+    double log_r_sq_range = log(r_sq_max/r_sq_min);
+    double log_z_range = log(z_max/z_min);
+    for (int i = 0; i < n_samples; i++) {
+        double r_perp_sq = r_sq_min*exp(drand48()*log_r_sq_range);
+        double z = z_min*exp(drand48()*log_z_range);
+        if (i % 10 == 0) {
+            z = drand48()*z_min;
+        }
+        if (drand48() < 0.5) {
+            z = -z;
+        }
+        double derivative;
+        double exact = exact_kernel(r_perp_sq, z, &derivative);
+        double Delta = sqrt(r_perp_sq + z*z);
+        double scale = (c*Delta + 1.)/(Delta*Delta*Delta + 1e-15);
+        double error = fabs(evaluate(r_perp_sq, z) - exact)/scale;
+        error_bound = max(error_bound, error);
+    }
+    cout << "spectator kernel table: sampled interpolation error bound = "
+         << error_bound << " (relative to (c*Delta + 1)/Delta^3)" << endl;
+}
+
+bool Kernel_table::read_from_file(string filename) {
+    ifstream table_file(filename.c_str(), ios::binary);
+    if (!table_file.good()) {
+        return(false);
+    }
+    char magic[8];
+    double c_file, range[4];
+    int layout[4];
+    table_file.read(magic, sizeof(magic));
+    table_file.read(reinterpret_cast<char*>(&c_file), sizeof(double));
+    table_file.read(reinterpret_cast<char*>(range), sizeof(range));
+    table_file.read(reinterpret_cast<char*>(layout), sizeof(layout));
+    table_file.read(reinterpret_cast<char*>(&error_bound), sizeof(double));
+    if (!table_file.good() || memcmp(magic, kernel_table_magic, 8) != 0
+        || c_file != c || range[0] != z_min || range[1] != z_max
+        || range[2] != r_sq_min || range[3] != r_sq_max
+        || layout[0] != z_rows_per_octave || layout[1] != n_z_rows
+        || layout[2] != segment_bits || layout[3] != n_segments) {
+        cout << "Kernel_table:: table in " << filename
+             << " does not match the current setup, rebuilding it" << endl;
+        return(false);
+    }
+    long n_entries = static_cast<long>(2*n_z_rows + 1)*(n_segments + 1);
+    table_file.read(reinterpret_cast<char*>(values),
+                    n_entries*sizeof(double));
+    table_file.read(reinterpret_cast<char*>(derivatives),
+                    n_entries*sizeof(double));
+    if (!table_file.good()) {
+        cout << "Kernel_table:: table in " << filename
+             << " is truncated, rebuilding it" << endl;
+        return(false);
+    }
+    table_file.close();
+    cout << "read spectator kernel table from " << filename
+         << ": sampled interpolation error bound = " << error_bound
+         << " (relative to (c*Delta + 1)/Delta^3)" << endl;
+    return(true);
+}
+
+void Kernel_table::write_to_file(string filename) {
+    // written to a temporary file which then replaces the table, so that
+    // concurrent runs never read a partial table
+    ostringstream temporary_filename;
+    temporary_filename << filename << ".tmp" << getpid();
+    ofstream table_file(temporary_filename.str().c_str(), ios::binary);
+    if (!table_file.good()) {
+        cout << "Kernel_table:: Warning: can not write the kernel table to "
+             << filename << endl;
+        return;
+    }
+    double range[4] = {z_min, z_max, r_sq_min, r_sq_max};
+    int layout[4] = {z_rows_per_octave, n_z_rows, segment_bits, n_segments};
+    long n_entries = static_cast<long>(2*n_z_rows + 1)*(n_segments + 1);
+    table_file.write(kernel_table_magic, sizeof(kernel_table_magic));
+    table_file.write(reinterpret_cast<char*>(&c), sizeof(double));
+    table_file.write(reinterpret_cast<char*>(range), sizeof(range));
+    table_file.write(reinterpret_cast<char*>(layout), sizeof(layout));
+    table_file.write(reinterpret_cast<char*>(&error_bound), sizeof(double));
+    table_file.write(reinterpret_cast<char*>(values),
+                     n_entries*sizeof(double));
+    table_file.write(reinterpret_cast<char*>(derivatives),
+                     n_entries*sizeof(double));
+    table_file.close();
+    if (!table_file.good()
+        || rename(temporary_filename.str().c_str(), filename.c_str()) != 0) {
+        cout << "Kernel_table:: Warning: can not write the kernel table to "
+             << filename << endl;
+        remove(temporary_filename.str().c_str());
+    }
+}
+
+static void table_sums_scalar(const source_list &sources,
+                              double field_x, double field_y,
+                              const double *slice_1, const double *slice_2,
+                              double r_sq_min, double r_sq_max,
+                              int segment_bits, double *sums) {
+    uint64_t base = double_bits(r_sq_min) >> (52 - segment_bits);
+    double temp_sum_Ex = 0.0;
+    double temp_sum_Ey = 0.0;
+    double temp_sum_Bx = 0.0;
+    double temp_sum_By = 0.0;
+    for (int i = 0; i < sources.length; i++) {
+        double x_local = field_x - sources.x[i];
+        double y_local = field_y - sources.y[i];
+        double r_perp_local_sq = x_local*x_local + y_local*y_local;
+        if (r_perp_local_sq < r_sq_min || r_perp_local_sq >= r_sq_max) {
+            continue;
+        }
+        uint64_t bits = double_bits(r_perp_local_sq);
+        int segment = static_cast<int>((bits >> (52 - segment_bits)) - base);
+        double f = bits_double(((bits << segment_bits) & mantissa_mask)
+                               | one_bits) - 1.;
+        const double *coeff_1 = slice_1 + 4*segment;
+        const double *coeff_2 = slice_2 + 4*segment;
+        double integrand_1 = sources.rho_1[i]*(
+            ((coeff_1[3]*f + coeff_1[2])*f + coeff_1[1])*f + coeff_1[0]);
+        double integrand_2 = sources.rho_2[i]*(
+            ((coeff_2[3]*f + coeff_2[2])*f + coeff_2[1])*f + coeff_2[0]);
+        double common_integrand_E = integrand_1 + integrand_2;
+        double common_integrand_B = integrand_1 - integrand_2;
+        temp_sum_Ex += x_local*common_integrand_E;
+        temp_sum_Ey += y_local*common_integrand_E;
+        temp_sum_Bx += -y_local*common_integrand_B;
+        temp_sum_By += x_local*common_integrand_B;
+    }
+    sums[0] = temp_sum_Ex;
+    sums[1] = temp_sum_Ey;
+    sums[2] = temp_sum_Bx;
+    sums[3] = temp_sum_By;
+}
+
+#ifdef KERNEL_TABLE_X86
+__attribute__((target("avx2,fma")))
+static inline __m256d table_term_avx2(const double *slice, __m256i index,
+                                      __m256d f) {
+    __m256d coeff_0 = _mm256_i64gather_pd(slice, index, 8);
+    __m256d coeff_1 = _mm256_i64gather_pd(slice + 1, index, 8);
+    __m256d coeff_2 = _mm256_i64gather_pd(slice + 2, index, 8);
+    __m256d coeff_3 = _mm256_i64gather_pd(slice + 3, index, 8);
+    __m256d p = _mm256_fmadd_pd(coeff_3, f, coeff_2);
+    p = _mm256_fmadd_pd(p, f, coeff_1);
+    return(_mm256_fmadd_pd(p, f, coeff_0));
+}
+
+__attribute__((target("avx2,fma")))
+static void table_sums_avx2(const source_list &sources,
+                            double field_x_in, double field_y_in,
+                            const double *slice_1, const double *slice_2,
+                            double r_sq_min, double r_sq_max,
+                            int segment_bits, double *sums) {
+    __m256i base = _mm256_set1_epi64x(
+        static_cast<long long>(double_bits(r_sq_min) >> (52 - segment_bits)));
+    __m256i mantissa = _mm256_set1_epi64x(
+                                    static_cast<long long>(mantissa_mask));
+    __m256i one = _mm256_set1_epi64x(static_cast<long long>(one_bits));
+    __m256d lower = _mm256_set1_pd(r_sq_min);
+    __m256d upper = _mm256_set1_pd(r_sq_max);
+    __m256d field_x = _mm256_set1_pd(field_x_in);
+    __m256d field_y = _mm256_set1_pd(field_y_in);
+    __m256d sum_Ex = _mm256_setzero_pd();
+    __m256d sum_Ey = _mm256_setzero_pd();
+    __m256d sum_Bx = _mm256_setzero_pd();
+    __m256d sum_By = _mm256_setzero_pd();
+    for (int i = 0; i < sources.padded_length; i += 4) {
+        __m256d x_local = _mm256_sub_pd(field_x,
+                                        _mm256_load_pd(sources.x + i));
+        __m256d y_local = _mm256_sub_pd(field_y,
+                                        _mm256_load_pd(sources.y + i));
+        __m256d r_perp_sq = _mm256_fmadd_pd(
+            x_local, x_local, _mm256_mul_pd(y_local, y_local));
+        __m256d valid = _mm256_and_pd(
+            _mm256_cmp_pd(r_perp_sq, lower, _CMP_GE_OQ),
+            _mm256_cmp_pd(r_perp_sq, upper, _CMP_LT_OQ));
+        __m256i bits = _mm256_castpd_si256(r_perp_sq);
+        __m256i segment = _mm256_sub_epi64(
+            _mm256_srli_epi64(bits, 52 - segment_bits), base);
+        segment = _mm256_and_si256(segment, _mm256_castpd_si256(valid));
+        __m256i index = _mm256_slli_epi64(segment, 2);
+        __m256d f = _mm256_sub_pd(
+            _mm256_castsi256_pd(_mm256_or_si256(
+                _mm256_and_si256(_mm256_slli_epi64(bits, segment_bits),
+                                 mantissa), one)),
+            _mm256_set1_pd(1.0));
+        __m256d integrand_1 = _mm256_mul_pd(
+            _mm256_load_pd(sources.rho_1 + i),
+            _mm256_and_pd(valid, table_term_avx2(slice_1, index, f)));
+        __m256d integrand_2 = _mm256_mul_pd(
+            _mm256_load_pd(sources.rho_2 + i),
+            _mm256_and_pd(valid, table_term_avx2(slice_2, index, f)));
+        __m256d common_E = _mm256_add_pd(integrand_1, integrand_2);
+        __m256d common_B = _mm256_sub_pd(integrand_1, integrand_2);
+        sum_Ex = _mm256_fmadd_pd(x_local, common_E, sum_Ex);
+        sum_Ey = _mm256_fmadd_pd(y_local, common_E, sum_Ey);
+        sum_Bx = _mm256_fnmadd_pd(y_local, common_B, sum_Bx);
+        sum_By = _mm256_fmadd_pd(x_local, common_B, sum_By);
+    }
+    double lanes[4][4];
+    _mm256_storeu_pd(lanes[0], sum_Ex);
+    _mm256_storeu_pd(lanes[1], sum_Ey);
+    _mm256_storeu_pd(lanes[2], sum_Bx);
+    _mm256_storeu_pd(lanes[3], sum_By);
+    for (int k = 0; k < 4; k++) {
+        sums[k] = (lanes[k][0] + lanes[k][1]) + (lanes[k][2] + lanes[k][3]);
+    }
+}
+
+__attribute__((target("avx512f")))
+static inline __m512d table_term_avx512(const double *slice, __m512i index,
+                                        __m512d f) {
+    __m512d coeff_0 = _mm512_i64gather_pd(index, slice, 8);
+    __m512d coeff_1 = _mm512_i64gather_pd(index, slice + 1, 8);
+    __m512d coeff_2 = _mm512_i64gather_pd(index, slice + 2, 8);
+    __m512d coeff_3 = _mm512_i64gather_pd(index, slice + 3, 8);
+    __m512d p = _mm512_fmadd_pd(coeff_3, f, coeff_2);
+    p = _mm512_fmadd_pd(p, f, coeff_1);
+    return(_mm512_fmadd_pd(p, f, coeff_0));
+}
+
+__attribute__((target("avx512f")))
+static void table_sums_avx512(const source_list &sources,
+                              double field_x_in, double field_y_in,
+                              const double *slice_1, const double *slice_2,
+                              double r_sq_min, double r_sq_max,
+                              int segment_bits, double *sums) {
+    __m512i base = _mm512_set1_epi64(
+        static_cast<long long>(double_bits(r_sq_min) >> (52 - segment_bits)));
+    __m512i mantissa = _mm512_set1_epi64(
+                                    static_cast<long long>(mantissa_mask));
+    __m512i one = _mm512_set1_epi64(static_cast<long long>(one_bits));
+    __m512d lower = _mm512_set1_pd(r_sq_min);
+    __m512d upper = _mm512_set1_pd(r_sq_max);
+    __m512d field_x = _mm512_set1_pd(field_x_in);
+    __m512d field_y = _mm512_set1_pd(field_y_in);
+    __m512d sum_Ex = _mm512_setzero_pd();
+    __m512d sum_Ey = _mm512_setzero_pd();
+    __m512d sum_Bx = _mm512_setzero_pd();
+    __m512d sum_By = _mm512_setzero_pd();
+    for (int i = 0; i < sources.padded_length; i += 8) {
+        __m512d x_local = _mm512_sub_pd(field_x,
+                                        _mm512_load_pd(sources.x + i));
+        __m512d y_local = _mm512_sub_pd(field_y,
+                                        _mm512_load_pd(sources.y + i));
+        __m512d r_perp_sq = _mm512_fmadd_pd(
+            x_local, x_local, _mm512_mul_pd(y_local, y_local));
+        __mmask8 valid = (_mm512_cmp_pd_mask(r_perp_sq, lower, _CMP_GE_OQ)
+                          & _mm512_cmp_pd_mask(r_perp_sq, upper, _CMP_LT_OQ));
+        __m512i bits = _mm512_castpd_si512(r_perp_sq);
+        __m512i segment = _mm512_maskz_sub_epi64(
+            valid, _mm512_srli_epi64(bits, 52 - segment_bits), base);
+        __m512i index = _mm512_slli_epi64(segment, 2);
+        __m512d f = _mm512_sub_pd(
+            _mm512_castsi512_pd(_mm512_or_si512(
+                _mm512_and_si512(_mm512_slli_epi64(bits, segment_bits),
+                                 mantissa), one)),
+            _mm512_set1_pd(1.0));
+        __m512d integrand_1 = _mm512_maskz_mul_pd(
+            valid, _mm512_load_pd(sources.rho_1 + i),
+            table_term_avx512(slice_1, index, f));
+        __m512d integrand_2 = _mm512_maskz_mul_pd(
+            valid, _mm512_load_pd(sources.rho_2 + i),
+            table_term_avx512(slice_2, index, f));
+        __m512d common_E = _mm512_add_pd(integrand_1, integrand_2);
+        __m512d common_B = _mm512_sub_pd(integrand_1, integrand_2);
+        sum_Ex = _mm512_fmadd_pd(x_local, common_E, sum_Ex);
+        sum_Ey = _mm512_fmadd_pd(y_local, common_E, sum_Ey);
+        sum_Bx = _mm512_fnmadd_pd(y_local, common_B, sum_Bx);
+        sum_By = _mm512_fmadd_pd(x_local, common_B, sum_By);
+    }
+    sums[0] = _mm512_reduce_add_pd(sum_Ex);
+    sums[1] = _mm512_reduce_add_pd(sum_Ey);
+    sums[2] = _mm512_reduce_add_pd(sum_Bx);
+    sums[3] = _mm512_reduce_add_pd(sum_By);
+}
+#endif  // KERNEL_TABLE_X86
+
+void Kernel_table::spectator_sums(int isa, const source_list &sources,
+                                  double field_x, double field_y,
+                                  const double *slice_1,
+                                  const double *slice_2, double *sums) {
+#ifdef KERNEL_TABLE_X86
+    if (isa == KERNEL_ISA_AVX512) {
+        table_sums_avx512(sources, field_x, field_y, slice_1, slice_2,
+                          r_sq_min, r_sq_max, segment_bits, sums);
+        return;
+    } else if (isa == KERNEL_ISA_AVX2) {
+        table_sums_avx2(sources, field_x, field_y, slice_1, slice_2,
+                        r_sq_min, r_sq_max, segment_bits, sums);
+        return;
+    }
+#endif
+    table_sums_scalar(sources, field_x, field_y, slice_1, slice_2,
+                      r_sq_min, r_sq_max, segment_bits, sums);
+}
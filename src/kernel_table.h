@@ -0,0 +1,75 @@
+// Copyright 2016 Chun Shen
+#ifndef SRC_KERNEL_TABLE_H_
+#define SRC_KERNEL_TABLE_H_
+
+#include <cmath>
+#include <string>
+
+#include "./field_kernels.h"
+
+using namespace std;
+
+// Interpolation table of the conductive spectator kernel
+//     K(r_perp^2, z) = (c*Delta + 1)/(Delta^3 + 1e-15)*exp(c*(z - Delta)),
+// with Delta = sqrt(r_perp^2 + z^2) and c = sigma/2*sinh(spectator_rap).
+// Nucleus 1 uses K(r_perp^2, z_1) and nucleus 2 uses K(r_perp^2, -z_2).
+//
+// The rows are logarithmically spaced in |z| for both signs of z, plus a
+// row at z = 0. Along r_perp^2 the nodes are taken from the leading bits of
+// its floating point representation, so every octave holds the same number
+// of uniform segments and the segment index needs no transcendental call.
+// Each row stores K and dK/d(r_perp^2) at the nodes.
+//
+// For a fluid cell the rows are combined with a cubic (Catmull-Rom)
+// interpolation in log|z| into a slice, which holds the cubic Hermite
+// polynomial of every r_perp^2 segment. The source loop then only needs
+// one polynomial evaluation per nucleus.
+class Kernel_table {
+ private:
+    double c;                   // sigma/2*sinh(spectator_rap) [1/fm]
+    int z_rows_per_octave;
+    int n_z_rows;               // rows with |z| > 0 for each sign of z
+    double z_min, z_max;        // range of |z| covered by the rows [fm]
+    int segment_bits;           // 2^segment_bits segments per octave
+    int n_segments;
+    double r_sq_min, r_sq_max;  // range of r_perp^2 [fm^2]
+    double *segment_width;
+    double error_bound;         // sampled interpolation error, see below
+    double *values, *derivatives;   // [row][node]
+
+    void build_table();
+    void estimate_error_bound();
+    bool read_from_file(string filename);
+    void write_to_file(string filename);
+    double exact_kernel(double r_perp_sq, double z, double *derivative);
+    double node_r_sq(int node);
+    int set_row_weights(double z, int *rows, double *weights);
+    double evaluate(double r_perp_sq, double z);
+
+ public:
+    // the table is read from filename if it holds a table with the same
+    // layout and c, otherwise it is built and written to filename
+    Kernel_table(double c_in, string filename);
+    ~Kernel_table();
+
+    double get_error_bound() {return(error_bound);}
+    double get_r_sq_max() {return(r_sq_max);}
+    // the slice holds 4 coefficients per segment followed by scratch space
+    int get_slice_length() {return(4*n_segments + 2*(n_segments + 1));}
+
+    // whether the rows cover the longitudinal distance z
+    bool covers(double z) {return(fabs(z) < z_max);}
+
+    // fills slice with the Hermite coefficients of K(r_perp^2, z)
+    void fill_slice(double z, double *slice);
+
+    // accumulates the spectator sums {Ex, Ey, Bx, By} with the kernels
+    // slice_1 = K(., z_1) and slice_2 = K(., -z_2). Sources closer than
+    // sqrt(r_sq_min) to the field point do not contribute.
+    void spectator_sums(int isa, const source_list &sources,
+                        double field_x, double field_y,
+                        const double *slice_1, const double *slice_2,
+                        double *sums);
+};
+
+#endif  // SRC_KERNEL_TABLE_H_
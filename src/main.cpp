@@ -14,38 +14,97 @@
 //
 /////////////////////////////////////////////////////////////////////////
 
+#include <sys/stat.h>
+
 #include <iostream>
 #include <sstream>
 #include <fstream>
 #include <cmath>
 #include <iomanip>
+#include <string>
+#include <vector>
 
 #include "./Stopwatch.h"
 #include "./EM_fields.h"
 #include "./ParameterReader.h"
+#include "./event_manifest.h"
+#include "./phase_timer.h"
 
 using namespace std;
 
 int main(int argc, char *argv[]) {
     Stopwatch sw;
+    Phase_timer timer;
 
     sw.tic();
 
+    // a first argument without "=" is an event directory or a manifest of
+    // event directories, the events are computed one after the other with
+    // the same EM_fields object. Otherwise the event in ./results is
+    // computed.
+    // The wall-clock and CPU times of the phases are written to timing.dat
+    // in the event directory, or to <manifest>.timing.dat.
+    vector<string> event_paths;
+    string timing_filename = "./results/timing.dat";
+    int first_parameter_argument = 1;
+    if (argc > 1 && string(argv[1]).find("=") == string::npos) {
+        struct stat path_status;
+        if (stat(argv[1], &path_status) == 0
+            && S_ISDIR(path_status.st_mode)) {
+            event_paths.push_back(argv[1]);
+            timing_filename = string(argv[1]) + "/timing.dat";
+        } else {
+            read_event_manifest(argv[1], &event_paths);
+            timing_filename = string(argv[1]) + ".timing.dat";
+        }
+        first_parameter_argument = 2;
+    } else {
+        event_paths.push_back("./results");
+    }
+
     // Read-in parameters
+    timer.start("parameter read");
     ParameterReader paraRdr;
     paraRdr.readFromFile("parameters.dat");
-    paraRdr.readFromArguments(argc, argv);
+    paraRdr.readFromArguments(argc, argv, "#", first_parameter_argument);
     paraRdr.echo();
+    timer.stop();
 
-    EM_fields testEM(&paraRdr);
-    testEM.calculate_EM_fields();
-    testEM.output_EM_fields("./results/EM_fields.dat");
-    testEM.calculate_charge_drifting_velocity();
-    testEM.output_surface_file_with_drifting_velocity(
-                            "./results/surface_with_drifting_velocity.dat");
+    timer.start("setup");
+    EM_fields testEM(&paraRdr, event_paths[0], &timer);
+    timer.stop();
+    for (unsigned int i = 0; i < event_paths.size(); i++) {
+        if (i > 0) {
+            timer.start("setup");
+            testEM.load_event(event_paths[i]);
+            timer.stop();
+        }
+        if (event_paths.size() > 1) {
+            cout << "event " << i + 1 << " of " << event_paths.size()
+                 << ": " << event_paths[i] << endl;
+        }
+        double n_cells = testEM.get_number_of_cells();
+        // the throughput is given in cell-source pairs of the direct sum,
+        // whichever shortcuts the field engine takes
+        timer.start("field kernel");
+        testEM.calculate_EM_fields();
+        timer.stop(n_cells, n_cells*testEM.get_number_of_sources());
+        timer.start("output");
+        testEM.output_EM_fields(event_paths[i] + "/EM_fields.dat");
+        timer.stop(n_cells);
+        timer.start("drift");
+        testEM.calculate_charge_drifting_velocity();
+        timer.stop(n_cells);
+        timer.start("output");
+        testEM.output_surface_file_with_drifting_velocity(
+                event_paths[i] + "/surface_with_drifting_velocity.dat");
+        timer.stop(n_cells);
+    }
 
     sw.toc();
-    cout << "Totally takes " << sw.takeTime() << " sec." << endl;
+    timer.report();
+    timer.write_to_file(timing_filename);
+    cout << "Totally takes " << sw.takeTime() << " sec. (cpu time "
+         << sw.takeCPUTime() << " sec.)" << endl;
     return(0);
 }
-
@@ -0,0 +1,136 @@
+// Copyright 2016 Chun Shen
+#include <stdlib.h>
+
+#include <iostream>
+#include <fstream>
+#include <iomanip>
+
+#include "./phase_timer.h"
+
+using namespace std;
+
+static double throughput(double work, double wall_time) {
+    if (wall_time <= 0.0) {
+        return(0.0);
+    }
+    return(work/wall_time);
+}
+
+void Phase_timer::start(string name) {
+    int parent = -1;
+    if (running_phases.size() > 0) {
+        parent = running_phases.back();
+    }
+    int idx = -1;
+    for (unsigned int i = 0; i < phases.size(); i++) {
+        if (phases[i].parent == parent && phases[i].name == name) {
+            idx = i;
+            break;
+        }
+    }
+    if (idx < 0) {
+        timed_phase phase;
+        phase.name = name;
+        phase.parent = parent;
+        phase.depth = running_phases.size();
+        phase.calls = 0;
+        phase.wall_time = 0.0;
+        phase.cpu_time = 0.0;
+        phase.n_cells = 0.0;
+        phase.n_interactions = 0.0;
+        phases.push_back(phase);
+        idx = phases.size() - 1;
+    }
+    running_phases.push_back(idx);
+    phases[idx].stopwatch.tic();
+}
+
+void Phase_timer::stop(double n_cells, double n_interactions) {
+    if (running_phases.size() == 0) {
+        cout << "Error:Phase_timer::stop: no phase is running!" << endl;
+        exit(1);
+    }
+    timed_phase &phase = phases[running_phases.back()];
+    running_phases.pop_back();
+    phase.stopwatch.toc();
+    phase.calls++;
+    phase.wall_time += phase.stopwatch.takeTime();
+    phase.cpu_time += phase.stopwatch.takeCPUTime();
+    phase.n_cells += n_cells;
+    phase.n_interactions += n_interactions;
+}
+
+void Phase_timer::report() {
+    // children are listed below their parents in the order they started
+    vector<int> order;
+    vector<int> stack;
+    for (int i = phases.size() - 1; i >= 0; i--) {
+        if (phases[i].parent < 0) {
+            stack.push_back(i);
+        }
+    }
+    while (stack.size() > 0) {
+        int idx = stack.back();
+        stack.pop_back();
+        order.push_back(idx);
+        for (int i = phases.size() - 1; i >= 0; i--) {
+            if (phases[i].parent == idx) {
+                stack.push_back(i);
+            }
+        }
+    }
+    cout << "timing of the run: wall [s], cpu [s], cells/s, "
+         << "equivalent direct-sum interactions/s" << endl;
+    for (unsigned int k = 0; k < order.size(); k++) {
+        const timed_phase &phase = phases[order[k]];
+        string label = string(2*phase.depth, ' ') + phase.name;
+        cout << "  " << left << setw(28) << label << right << fixed
+             << setprecision(3) << setw(10) << phase.wall_time
+             << setw(10) << phase.cpu_time;
+        cout.unsetf(ios::fixed);
+        if (phase.n_cells > 0.0) {
+            cout << setprecision(3) << setw(12)
+                 << throughput(phase.n_cells, phase.wall_time);
+        }
+        if (phase.n_interactions > 0.0) {
+            cout << setprecision(3) << setw(12)
+                 << throughput(phase.n_interactions, phase.wall_time);
+        }
+        cout << endl;
+    }
+    cout << setprecision(6);
+}
+
+void Phase_timer::write_to_file(string filename) {
+    ofstream output(filename.c_str());
+    if (!output.good()) {
+        cout << "Phase_timer:: Warning: can not write the timing to "
+             << filename << endl;
+        return;
+    }
+    output << "# phase  depth  calls  wall[s]  cpu[s]  cells  cells/s  "
+           << "equivalent_interactions  equivalent_interactions/s" << endl;
+    for (unsigned int i = 0; i < phases.size(); i++) {
+        const timed_phase &phase = phases[i];
+        // nested phases are labeled with the path of their parents
+        string label = phase.name;
+        for (int parent = phase.parent; parent >= 0;
+             parent = phases[parent].parent) {
+            label = phases[parent].name + "/" + label;
+        }
+        for (unsigned int k = 0; k < label.size(); k++) {
+            if (label[k] == ' ') {
+                label[k] = '_';
+            }
+        }
+        output << scientific << setprecision(6)
+               << label << "  " << phase.depth << "  " << phase.calls
+               << "  " << phase.wall_time << "  " << phase.cpu_time
+               << "  " << phase.n_cells << "  "
+               << throughput(phase.n_cells, phase.wall_time) << "  "
+               << phase.n_interactions << "  "
+               << throughput(phase.n_interactions, phase.wall_time)
+               << endl;
+    }
+    output.close();
+}
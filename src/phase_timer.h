@@ -0,0 +1,46 @@
+// Copyright 2016 Chun Shen
+#ifndef SRC_PHASE_TIMER_H_
+#define SRC_PHASE_TIMER_H_
+
+#include <string>
+#include <vector>
+
+#include "./Stopwatch.h"
+
+using namespace std;
+
+struct timed_phase {
+    string name;
+    int parent;                 // index of the enclosing phase, -1 if none
+    int depth;
+    long calls;
+    double wall_time, cpu_time;     // summed over the calls [s]
+    double n_cells;                 // cells processed in the phase
+    // cell-source pairs of the equivalent direct sum, the cache, lattice,
+    // symmetry and tree paths evaluate fewer of them
+    double n_interactions;
+    Stopwatch stopwatch;
+};
+
+// Wall-clock and CPU times of named phases of the run. A phase started
+// while another one is running is nested in it, a phase started again
+// within the same parent accumulates its times and work over the calls.
+class Phase_timer {
+ private:
+    vector<timed_phase> phases;
+    vector<int> running_phases;
+
+ public:
+    void start(string name);
+    // stops the innermost running phase and adds the work done in it
+    void stop(double n_cells = 0.0, double n_interactions = 0.0);
+
+    // table of the phases with their wall and CPU times and throughputs
+    void report();
+    // the same table with one phase per line as
+    // phase depth calls wall cpu cells cells/s equivalent_interactions
+    // equivalent_interactions/s
+    void write_to_file(string filename);
+};
+
+#endif  // SRC_PHASE_TIMER_H_
@@ -0,0 +1,237 @@
+// Copyright 2016 Chun Shen
+#include <iostream>
+#include <cmath>
+#include <map>
+#include <vector>
+#include <algorithm>
+
+#include "./radial_profile.h"
+
+using namespace std;
+
+// field points closer than resolution_factor node spacings to the
+// spectator sheets are left to the grid sum
+static const double resolution_factor = 4.0;
+
+// averages of density over the rings of grid points with the same distance
+// from the center, labeled by the squared distance in units of (dx/2)^2
+static void ring_averages(int grid_size, double **density,
+                          map<long, double> *averages) {
+    map<long, int> counts;
+    for (int i = 0; i < grid_size; i++) {
+        long a = 2*i - (grid_size - 1);
+        for (int j = 0; j < grid_size; j++) {
+            long b = 2*j - (grid_size - 1);
+            (*averages)[a*a + b*b] += density[i][j];
+            counts[a*a + b*b]++;
+        }
+    }
+    for (map<long, double>::iterator it = averages->begin();
+         it != averages->end(); ++it) {
+        it->second /= counts[it->first];
+    }
+}
+
+// sums of the density of one nucleus over the grid points of a radial bin,
+// with t = s - s_center: the radial moments sum rho t^p, p = 0, ..., 3, of
+// the monopole and the angular harmonics sum rho t^p cos(m theta) and
+// sum rho t^p sin(m theta) for p = 0 (cos_0, sin_0) and p = 1 (cos_1, sin_1)
+struct radial_bin {
+    double moments[4];
+    vector<double> cos_0, sin_0, cos_1, sin_1;
+};
+
+// two-point Gauss rule of the monopole of a bin, in the frame centered at
+// the bin center. Returns the number of nodes, 0 for an empty bin and 1 if
+// the charges sit at a single radius.
+static int bin_gauss_rule(const double *m, double *nodes, double *weights) {
+    if (m[0] == 0.0) {
+        return(0);
+    }
+    double det = m[1]*m[1] - m[0]*m[2];
+    if (m[0] < 0.0 || fabs(det) <= 1e-12*m[0]*fabs(m[2])) {
+        nodes[0] = m[1]/m[0];
+        weights[0] = m[0];
+        return(1);
+    }
+    // the orthogonal polynomial t^2 + alpha*t + beta of the measure
+    double alpha = (m[0]*m[3] - m[1]*m[2])/det;
+    double beta = (m[2]*m[2] - m[1]*m[3])/det;
+    double root = sqrt(max(alpha*alpha - 4.*beta, 0.0));
+    nodes[0] = (-alpha + root)/2.;
+    nodes[1] = (-alpha - root)/2.;
+    weights[0] = (m[1] - m[0]*nodes[1])/(nodes[0] - nodes[1]);
+    weights[1] = m[0] - weights[0];
+    return(2);
+}
+
+Radial_profile::Radial_profile(int grid_size, double grid_dx_in,
+                               double **density_1, double **density_2,
+                               int n_radial_in, int n_angular_in) {
+    grid_dx = grid_dx_in;
+    n_radial = max(2, n_radial_in);
+    n_angular = 2*max(1, n_angular_in/2);
+    int n_harmonics = n_angular/2 + 1;
+
+    double **density[2] = {density_1, density_2};
+    bool same_densities = true;
+    r_max = 0.0;
+    for (int i = 0; i < grid_size; i++) {
+        for (int j = 0; j < grid_size; j++) {
+            if (density_1[i][j] != density_2[i][j]) {
+                same_densities = false;
+            }
+            if (density_1[i][j] != 0.0 || density_2[i][j] != 0.0) {
+                double x = (i - (grid_size - 1)/2.)*grid_dx;
+                double y = (j - (grid_size - 1)/2.)*grid_dx;
+                r_max = max(r_max, sqrt(x*x + y*y));
+            }
+        }
+    }
+    r_max = max(r_max, grid_dx)*(1. + 1e-8);
+    // the radial nodes are the two-point Gauss rules of the monopole in
+    // n_radial/2 bins of equal width, the angular nodes are the
+    // trapezoidal rule of n_angular points on the circle. The arc length
+    // between the angular nodes at r_max and the bin width set the
+    // smallest longitudinal distance the nodes resolve.
+    int n_bins = max(1, n_radial/2);
+    double bin_width = r_max/n_bins;
+    double node_spacing = max(2.*M_PI*r_max/n_angular, bin_width);
+    z_min = resolution_factor*node_spacing;
+
+    int n_nuclei = same_densities ? 1 : 2;
+    vector<radial_bin> bins(n_nuclei*n_bins);
+    for (unsigned int k = 0; k < bins.size(); k++) {
+        for (int p = 0; p < 4; p++) {
+            bins[k].moments[p] = 0.0;
+        }
+        bins[k].cos_0.resize(n_harmonics, 0.0);
+        bins[k].sin_0.resize(n_harmonics, 0.0);
+        bins[k].cos_1.resize(n_harmonics, 0.0);
+        bins[k].sin_1.resize(n_harmonics, 0.0);
+    }
+    for (int i = 0; i < grid_size; i++) {
+        for (int j = 0; j < grid_size; j++) {
+            double x = (i - (grid_size - 1)/2.)*grid_dx;
+            double y = (j - (grid_size - 1)/2.)*grid_dx;
+            double s = sqrt(x*x + y*y);
+            int k = min(static_cast<int>(s/bin_width), n_bins - 1);
+            double t = s - (k + 0.5)*bin_width;
+            double cos_theta = (s > 0.0) ? x/s : 1.0;
+            double sin_theta = (s > 0.0) ? y/s : 0.0;
+            for (int n = 0; n < n_nuclei; n++) {
+                double rho = density[n][i][j];
+                if (rho == 0.0) {
+                    continue;
+                }
+                radial_bin &bin = bins[n*n_bins + k];
+                double rho_t = rho;
+                for (int p = 0; p < 4; p++) {
+                    bin.moments[p] += rho_t;
+                    rho_t *= t;
+                }
+                // cos(m theta) and sin(m theta) by the angle addition
+                double cos_m = 1.0, sin_m = 0.0;
+                for (int m = 0; m < n_harmonics; m++) {
+                    bin.cos_0[m] += rho*cos_m;
+                    bin.sin_0[m] += rho*sin_m;
+                    bin.cos_1[m] += rho*t*cos_m;
+                    bin.sin_1[m] += rho*t*sin_m;
+                    double cos_next = cos_m*cos_theta - sin_m*sin_theta;
+                    sin_m = sin_m*cos_theta + cos_m*sin_theta;
+                    cos_m = cos_next;
+                }
+            }
+        }
+    }
+
+    // the weights of the angular nodes phi_l = 2 pi l/n_angular reproduce
+    // the harmonics |m| <= n_angular/2 of the bin. The monopole is
+    // distributed over the radial nodes with the Gauss weights, the
+    // harmonics m > 0 with the weights matching their moments t^0 and t^1.
+    vector<double> node_x, node_y, node_rho_1, node_rho_2;
+    for (int n = 0; n < n_nuclei; n++) {
+        for (int k = 0; k < n_bins; k++) {
+            const radial_bin &bin = bins[n*n_bins + k];
+            double t_nodes[2], gauss_weights[2];
+            int n_nodes = bin_gauss_rule(bin.moments, t_nodes,
+                                         gauss_weights);
+            for (int q = 0; q < n_nodes; q++) {
+                // harmonic weights of the radial node q
+                vector<double> cos_w(n_harmonics), sin_w(n_harmonics);
+                for (int m = 1; m < n_harmonics; m++) {
+                    if (n_nodes == 1) {
+                        cos_w[m] = bin.cos_0[m];
+                        sin_w[m] = bin.sin_0[m];
+                        continue;
+                    }
+                    double t_other = t_nodes[1 - q];
+                    double dt = t_nodes[q] - t_other;
+                    cos_w[m] = (bin.cos_1[m] - bin.cos_0[m]*t_other)/dt;
+                    sin_w[m] = (bin.sin_1[m] - bin.sin_0[m]*t_other)/dt;
+                }
+                double r = (k + 0.5)*bin_width + t_nodes[q];
+                for (int l = 0; l < n_angular; l++) {
+                    double phi = 2.*M_PI*l/n_angular;
+                    double weight = gauss_weights[q];
+                    for (int m = 1; m < n_harmonics; m++) {
+                        double factor = (m == n_angular/2) ? 1. : 2.;
+                        weight += factor*(cos_w[m]*cos(m*phi)
+                                          + sin_w[m]*sin(m*phi));
+                    }
+                    weight /= n_angular;
+                    node_x.push_back(r*cos(phi));
+                    node_y.push_back(r*sin(phi));
+                    node_rho_1.push_back((n == 0) ? weight : 0.0);
+                    node_rho_2.push_back((n == 1 || same_densities)
+                                         ? weight : 0.0);
+                }
+            }
+        }
+    }
+
+    int n_nodes = node_x.size();
+    allocate_source_list(&nodes, n_nodes);
+    for (int i = 0; i < n_nodes; i++) {
+        nodes.x[i] = node_x[i];
+        nodes.y[i] = node_y[i];
+        nodes.rho_1[i] = node_rho_1[i];
+        nodes.rho_2[i] = node_rho_2[i];
+    }
+}
+
+Radial_profile::~Radial_profile() {
+    free_source_list(&nodes);
+}
+
+double Radial_profile::ring_asymmetry(int grid_size, double **density) {
+    map<long, double> rings;
+    ring_averages(grid_size, density, &rings);
+    double max_density = 0.0;
+    double max_deviation = 0.0;
+    for (int i = 0; i < grid_size; i++) {
+        long a = 2*i - (grid_size - 1);
+        for (int j = 0; j < grid_size; j++) {
+            long b = 2*j - (grid_size - 1);
+            max_density = max(max_density, fabs(density[i][j]));
+            max_deviation = max(max_deviation,
+                                fabs(density[i][j] - rings[a*a + b*b]));
+        }
+    }
+    if (max_density == 0.0) {
+        return(0.0);
+    }
+    return(max_deviation/max_density);
+}
+
+template <bool conductive>
+void Radial_profile::spectator_sums(int isa,
+                                    const spectator_kernel_args &args,
+                                    double *sums) {
+    spectator_kernel<conductive>(isa, nodes, args, sums);
+}
+
+template void Radial_profile::spectator_sums<true>(
+            int isa, const spectator_kernel_args &args, double *sums);
+template void Radial_profile::spectator_sums<false>(
+            int isa, const spectator_kernel_args &args, double *sums);
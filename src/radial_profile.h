@@ -0,0 +1,59 @@
+// Copyright 2016 Chun Shen
+#ifndef SRC_RADIAL_PROFILE_H_
+#define SRC_RADIAL_PROFILE_H_
+
+#include <cmath>
+
+#include "./field_kernels.h"
+
+// Spectator densities that only depend on the distance r from the center
+// of the density grid, rho_n(x, y) = f_n(r). Their fields are sums over
+// rings of sources, which are replaced by quadrature nodes in (r, phi):
+//  - the grid points are sorted into n_radial/2 radial bins of equal width,
+//    the monopole of every bin is put on the two nodes of its Gauss rule,
+//    which keep the charges and their radial moments up to t^3 in the bin,
+//  - the angular nodes are the trapezoidal rule with n_angular points,
+//    which converges exponentially for the periodic integrand. Their
+//    weights also carry the angular harmonics |m| <= n_angular/2 of the
+//    charges in the bin (moments t^0 and t^1), so the lattice anisotropy
+//    of a sharp edge (hard disks) is kept.
+// The nodes are stored as weighted point sources and summed with
+// spectator_kernel(). For field points with |z| >= z_min the error
+// relative to the grid sum is ~3e-8 of the field with 64 nodes in r and
+// phi, also for hard disks.
+class Radial_profile {
+ private:
+    double grid_dx;
+    int n_radial, n_angular;
+    double r_max;           // the profiles vanish beyond r_max [fm]
+    double z_min;           // smallest |z| resolved by the nodes [fm]
+    source_list nodes;      // quadrature nodes as point sources
+
+ public:
+    Radial_profile(int grid_size, double grid_dx_in, double **density_1,
+                   double **density_2, int n_radial_in, int n_angular_in);
+    ~Radial_profile();
+
+    // largest deviation of density from its ring averages, relative to the
+    // largest density on the grid
+    static double ring_asymmetry(int grid_size, double **density);
+
+    double get_r_max() {return(r_max);}
+    double get_z_min() {return(z_min);}
+    int get_number_of_nodes() {return(nodes.length);}
+
+    // whether the nodes resolve the integrand of a field point with the
+    // longitudinal distances z_1 and z_2. Closer to the sources the kernel
+    // is peaked below the node spacing and the grid sum has to be used.
+    bool resolves(double z_1, double z_2) {
+        return(fabs(z_1) >= z_min && fabs(z_2) >= z_min);
+    }
+
+    // same sums {Ex, Ey, Bx, By, Ez} as spectator_kernel<conductive>()
+    // over the full density grid
+    template <bool conductive>
+    void spectator_sums(int isa, const spectator_kernel_args &args,
+                        double *sums);
+};
+
+#endif  // SRC_RADIAL_PROFILE_H_
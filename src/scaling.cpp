@@ -0,0 +1,296 @@
+/////////////////////////////////////////////////////////////////////////
+//              Thread and problem size scaling of EM_fields.e
+//
+//              author: Chun Shen <chunshen@physics.mcgill.ca>
+//              Copyright 2016 Chun Shen
+//
+//  Usage: EM_fields_scaling.e [key=value ...]
+//
+//  Runs the full EM_fields.e pipeline on synthetic Woods-Saxon events in
+//  ./scaling_runs for every combination of
+//   - thread counts 1, 2, 4, ... up to scaling_max_threads (all cores),
+//   - cell counts scaling_min_cells, 10x, 100x, ... up to
+//     scaling_max_cells (10^3 ... 10^5),
+//   - nucleon_density_grid_size from scaling_min_grid_size up to
+//     scaling_max_grid_size (the value of parameters.dat), doubling the
+//     number of intervals of a grid of fixed extent.
+//  Weak scaling runs use scaling_min_cells cells per thread. The wall
+//  times of the phases are taken from the timing.dat of every run and the
+//  speedups and parallel efficiencies per phase are printed and written to
+//  ./scaling_runs/strong_scaling.dat and weak_scaling.dat. Other key=value
+//  arguments are passed on to EM_fields.e.
+//
+/////////////////////////////////////////////////////////////////////////
+
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <utility>
+#include <algorithm>
+
+#include "./ParameterReader.h"
+#include "./synthetic_event.h"
+#include "./worker_pool.h"
+
+using namespace std;
+
+struct scaling_run {
+    int grid_size;
+    double n_cells;
+    int n_threads;
+    vector<pair<string, double> > phase_wall_times;     // [s]
+};
+
+struct scaling_setup {
+    string executable;
+    vector<string> arguments;   // passed on to every run
+    double grid_extent;         // (grid_size - 1)*grid_dx [fm]
+    int n_eta;
+    string run_directory;
+};
+
+static void read_phase_wall_times(string filename,
+                                  vector<pair<string, double> > *phases) {
+    ifstream timing(filename.c_str());
+    if (!timing.good()) {
+        cout << "Error:read_phase_wall_times: can not open file "
+             << filename << endl;
+        exit(1);
+    }
+    string line;
+    while (getline(timing, line)) {
+        if (line.size() == 0 || line[0] == '#') {
+            continue;
+        }
+        istringstream line_stream(line);
+        string name;
+        int depth;
+        long calls;
+        double wall_time;
+        line_stream >> name >> depth >> calls >> wall_time;
+        phases->push_back(make_pair(name, wall_time));
+    }
+}
+
+static double get_phase_wall_time(const scaling_run &run, string name) {
+    for (unsigned int i = 0; i < run.phase_wall_times.size(); i++) {
+        if (run.phase_wall_times[i].first == name) {
+            return(run.phase_wall_times[i].second);
+        }
+    }
+    return(0.0);
+}
+
+// writes a synthetic event with n_cells cells and runs it with
+// n_threads threads
+static scaling_run run_scaling_point(const scaling_setup &setup,
+                                     int grid_size, double n_cells,
+                                     int n_threads) {
+    ostringstream event_path;
+    event_path << setup.run_directory << "/grid_" << grid_size << "_cells_"
+               << static_cast<long>(n_cells);
+    string event_directory = event_path.str();
+    double grid_dx = setup.grid_extent/(grid_size - 1);
+    struct stat path_status;
+    if (stat((event_directory + "/surface.dat").c_str(), &path_status)
+            != 0) {
+        mkdir(event_directory.c_str(), 0755);
+        synthetic_event_setup event_setup = default_synthetic_event_setup();
+        event_setup.grid_size = grid_size;
+        event_setup.grid_dx = grid_dx;
+        event_setup.n_surface_points = max(
+            1, static_cast<int>(n_cells/setup.n_eta + 0.5));
+        write_synthetic_event(event_directory, event_setup);
+    }
+
+    vector<string> run_arguments;
+    run_arguments.push_back(event_directory);
+    run_arguments.insert(run_arguments.end(), setup.arguments.begin(),
+                         setup.arguments.end());
+    ostringstream grid_arguments;
+    grid_arguments << "nucleon_density_grid_size=" << grid_size;
+    run_arguments.push_back(grid_arguments.str());
+    grid_arguments.str("");
+    grid_arguments << setprecision(12) << "nucleon_density_grid_dx="
+                   << grid_dx;
+    run_arguments.push_back(grid_arguments.str());
+    // every run computes all cells of the surface
+    run_arguments.push_back("mode=3");
+    run_arguments.push_back("field_cache=0");
+    run_arguments.push_back("field_lattice=0");
+
+    ostringstream log_filename;
+    log_filename << event_directory << "/EM_fields_threads_"
+                 << n_threads << ".log";
+    cout << "running " << event_directory << " on " << n_threads
+         << " threads ..." << flush;
+    int exit_code = wait_for_worker_process(
+            start_worker_process(setup.executable, run_arguments, n_threads,
+                                 log_filename.str()));
+    if (exit_code != 0) {
+        cout << endl << "Error:run_scaling_point: EM_fields.e failed "
+             << "with status " << exit_code << ", see "
+             << log_filename.str() << endl;
+        exit(1);
+    }
+    scaling_run result;
+    result.grid_size = grid_size;
+    result.n_cells = n_cells;
+    result.n_threads = n_threads;
+    read_phase_wall_times(event_directory + "/timing.dat",
+                          &result.phase_wall_times);
+    cout << " " << get_phase_wall_time(result, "field_kernel")
+         << " sec. in the field kernel" << endl;
+    return(result);
+}
+
+// speedups and efficiencies of the phases relative to the first run. The
+// efficiency is speedup/threads for strong scaling (same problem) and the
+// speedup itself for weak scaling (problem growing with the threads).
+static void report_scaling(string title, const vector<scaling_run> &runs,
+                           bool weak, ofstream *output) {
+    const scaling_run &reference = runs[0];
+    cout << endl << title << endl;
+    cout << "  " << left << setw(26) << "phase" << right << setw(10)
+         << "wall [s]";
+    for (unsigned int k = 0; k < runs.size(); k++) {
+        ostringstream column;
+        column << "eff(" << runs[k].n_threads << ")";
+        cout << setw(10) << column.str();
+    }
+    cout << endl;
+    for (unsigned int i = 0; i < reference.phase_wall_times.size(); i++) {
+        string name = reference.phase_wall_times[i].first;
+        double reference_time = reference.phase_wall_times[i].second;
+        cout << "  " << left << setw(26) << name << right << fixed
+             << setprecision(3) << setw(10) << reference_time;
+        for (unsigned int k = 0; k < runs.size(); k++) {
+            double wall_time = get_phase_wall_time(runs[k], name);
+            double speedup = 0.0;
+            if (wall_time > 0.0) {
+                speedup = reference_time/wall_time;
+            }
+            double efficiency = (weak ? speedup
+                                      : speedup/runs[k].n_threads);
+            cout << setw(10) << efficiency;
+            (*output) << scientific << setprecision(6)
+                      << runs[k].grid_size << "  " << runs[k].n_cells
+                      << "  " << runs[k].n_threads << "  " << name << "  "
+                      << wall_time << "  " << speedup << "  "
+                      << efficiency << endl;
+        }
+        cout << endl;
+        cout.unsetf(ios::fixed);
+    }
+    cout << setprecision(6);
+}
+
+int main(int argc, char *argv[]) {
+    ParameterReader paraRdr;
+    paraRdr.readFromFile("parameters.dat");
+    paraRdr.readFromArguments(argc, argv);
+    vector<string> arguments;
+    for (int i = 1; i < argc; i++) {
+        if (string(argv[i]).find("scaling_") != 0) {
+            arguments.push_back(argv[i]);
+        }
+    }
+
+    int n_cores = sysconf(_SC_NPROCESSORS_ONLN);
+    int max_threads = paraRdr.getVal("scaling_max_threads",
+                                     max(n_cores, 1));
+    double min_cells = paraRdr.getVal("scaling_min_cells", 1e3);
+    double max_cells = paraRdr.getVal("scaling_max_cells", 1e5);
+    int grid_size = paraRdr.getVal("nucleon_density_grid_size");
+    int min_grid_size = paraRdr.getVal("scaling_min_grid_size", grid_size);
+    int max_grid_size = paraRdr.getVal("scaling_max_grid_size", grid_size);
+    double grid_extent = ((grid_size - 1)
+                          *paraRdr.getVal("nucleon_density_grid_dx"));
+    int n_eta = paraRdr.getVal("n_eta");
+    // the grid sizes grow as 2*(size - 1) + 1 and the cell counts by
+    // factors of 10, smaller values would never reach the maxima
+    if (min_grid_size < 2) {
+        cout << "Error: scaling_min_grid_size = " << min_grid_size
+             << " needs to be at least 2!" << endl;
+        exit(1);
+    }
+    if (min_cells < 1.0) {
+        cout << "Error: scaling_min_cells = " << min_cells
+             << " needs to be at least 1!" << endl;
+        exit(1);
+    }
+
+    vector<int> thread_counts;
+    for (int n_threads = 1; n_threads < max_threads; n_threads *= 2) {
+        thread_counts.push_back(n_threads);
+    }
+    thread_counts.push_back(max_threads);
+    vector<double> cell_counts;
+    for (double n_cells = min_cells; n_cells <= max_cells*(1. + 1e-8);
+         n_cells *= 10.) {
+        cell_counts.push_back(n_cells);
+    }
+    vector<int> grid_sizes;
+    for (int size = min_grid_size; size <= max_grid_size;
+         size = 2*(size - 1) + 1) {
+        grid_sizes.push_back(size);
+    }
+
+    // EM_fields.e is expected next to this executable
+    string program_path = argv[0];
+    string executable = "./EM_fields.e";
+    if (program_path.find('/') != string::npos) {
+        executable = (program_path.substr(0, program_path.rfind('/'))
+                      + "/EM_fields.e");
+    }
+    scaling_setup setup;
+    setup.executable = executable;
+    setup.arguments = arguments;
+    setup.grid_extent = grid_extent;
+    setup.n_eta = n_eta;
+    setup.run_directory = "./scaling_runs";
+    mkdir(setup.run_directory.c_str(), 0755);
+
+    string strong_filename = setup.run_directory + "/strong_scaling.dat";
+    string weak_filename = setup.run_directory + "/weak_scaling.dat";
+    ofstream strong_output(strong_filename.c_str());
+    ofstream weak_output(weak_filename.c_str());
+    strong_output << "# grid_size  cells  threads  phase  wall[s]  speedup  "
+                  << "efficiency" << endl;
+    weak_output << "# grid_size  cells  threads  phase  wall[s]  speedup  "
+                << "efficiency" << endl;
+    for (unsigned int g = 0; g < grid_sizes.size(); g++) {
+        for (unsigned int c = 0; c < cell_counts.size(); c++) {
+            vector<scaling_run> runs;
+            for (unsigned int t = 0; t < thread_counts.size(); t++) {
+                runs.push_back(run_scaling_point(setup, grid_sizes[g],
+                                                 cell_counts[c],
+                                                 thread_counts[t]));
+            }
+            ostringstream title;
+            title << "strong scaling: grid size " << grid_sizes[g] << ", "
+                  << cell_counts[c] << " cells";
+            report_scaling(title.str(), runs, false, &strong_output);
+        }
+        vector<scaling_run> runs;
+        for (unsigned int t = 0; t < thread_counts.size(); t++) {
+            runs.push_back(run_scaling_point(setup, grid_sizes[g],
+                                             min_cells*thread_counts[t],
+                                             thread_counts[t]));
+        }
+        ostringstream title;
+        title << "weak scaling: grid size " << grid_sizes[g] << ", "
+              << min_cells << " cells per thread";
+        report_scaling(title.str(), runs, true, &weak_output);
+    }
+    strong_output.close();
+    weak_output.close();
+    return(0);
+}
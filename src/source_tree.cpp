@@ -0,0 +1,254 @@
+// Copyright 2016 Chun Shen
+#include <iostream>
+#include <cmath>
+#include <algorithm>
+
+#include "./source_tree.h"
+
+using namespace std;
+
+static const int quadtree_max_depth = 64;
+// nodes with exp(c*(z - Delta)) < exp(-50) ~ 2e-22 everywhere are dropped
+static const double log_damping_cutoff = -50.;
+
+Source_quadtree::Source_quadtree(const source_list &input,
+                                 int leaf_size_in) {
+    leaf_size = max(1, leaf_size_in);
+    // bounding square of all source points
+    double x_min = 0.0, x_max = 0.0, y_min = 0.0, y_max = 0.0;
+    for (int i = 0; i < input.length; i++) {
+        if (i == 0 || input.x[i] < x_min) x_min = input.x[i];
+        if (i == 0 || input.x[i] > x_max) x_max = input.x[i];
+        if (i == 0 || input.y[i] < y_min) y_min = input.y[i];
+        if (i == 0 || input.y[i] > y_max) y_max = input.y[i];
+    }
+    double size = max(max(x_max - x_min, y_max - y_min), 1e-6)*(1. + 1e-8);
+
+    int *order = new int[input.length];
+    int *buffer = new int[input.length];
+    for (int i = 0; i < input.length; i++) {
+        order[i] = i;
+    }
+    nodes.reserve(2*input.length/leaf_size + 1);
+    build_node(0, input.length, (x_min + x_max)/2., (y_min + y_max)/2.,
+               size, order, buffer, input);
+
+    allocate_source_list(&sources, input.length);
+    for (int i = 0; i < input.length; i++) {
+        sources.x[i] = input.x[order[i]];
+        sources.y[i] = input.y[order[i]];
+        sources.rho_1[i] = input.rho_1[order[i]];
+        sources.rho_2[i] = input.rho_2[order[i]];
+    }
+    delete[] order;
+    delete[] buffer;
+}
+
+Source_quadtree::~Source_quadtree() {
+    free_source_list(&sources);
+    nodes.clear();
+}
+
+int Source_quadtree::build_node(int begin, int end, double center_x,
+                                double center_y, double size, int *order,
+                                int *buffer, const source_list &input) {
+    // builds the node holding order[begin:end] and returns its index
+    int node_idx = nodes.size();
+    quadtree_node node;
+    node.center_x = center_x;
+    node.center_y = center_y;
+    node.size = size;
+    node.begin = begin;
+    node.end = end;
+    const double *rho[2] = {input.rho_1, input.rho_2};
+    for (int k = 0; k < 2; k++) {
+        // charge, centroid and second moments about the centroid
+        double charge = 0.0, mean_x = 0.0, mean_y = 0.0;
+        for (int i = begin; i < end; i++) {
+            int idx = order[i];
+            charge += rho[k][idx];
+            mean_x += rho[k][idx]*input.x[idx];
+            mean_y += rho[k][idx]*input.y[idx];
+        }
+        double xx = 0.0, xy = 0.0, yy = 0.0;
+        if (charge != 0.0) {
+            mean_x /= charge;
+            mean_y /= charge;
+            for (int i = begin; i < end; i++) {
+                int idx = order[i];
+                double dx = input.x[idx] - mean_x;
+                double dy = input.y[idx] - mean_y;
+                xx += rho[k][idx]*dx*dx;
+                xy += rho[k][idx]*dx*dy;
+                yy += rho[k][idx]*dy*dy;
+            }
+            xx /= charge;
+            xy /= charge;
+            yy /= charge;
+        } else {
+            mean_x = center_x;
+            mean_y = center_y;
+        }
+        if (k == 0) {
+            node.charge_1 = charge;
+        } else {
+            node.charge_2 = charge;
+        }
+        // principal axes (cos(phi), sin(phi)) and (-sin(phi), cos(phi))
+        // of the second moments with the eigenvalues lambda_1, lambda_2
+        double phi = 0.5*atan2(2.*xy, xx - yy);
+        double cos_phi = cos(phi);
+        double sin_phi = sin(phi);
+        double lambda_1 = (xx*cos_phi*cos_phi + 2.*xy*sin_phi*cos_phi
+                           + yy*sin_phi*sin_phi);
+        double lambda_2 = xx + yy - lambda_1;
+        double a = sqrt(2.*max(lambda_1, 0.0));
+        double b = sqrt(2.*max(lambda_2, 0.0));
+        double offset_x[4] = {a*cos_phi, -a*cos_phi, -b*sin_phi, b*sin_phi};
+        double offset_y[4] = {a*sin_phi, -a*sin_phi, b*cos_phi, -b*cos_phi};
+        for (int j = 0; j < 4; j++) {
+            node.pseudo_x[k][j] = mean_x + offset_x[j];
+            node.pseudo_y[k][j] = mean_y + offset_y[j];
+        }
+    }
+    for (int k = 0; k < 4; k++) {
+        node.children[k] = -1;
+    }
+    nodes.push_back(node);
+
+    int depth = static_cast<int>(log2(nodes[0].size/size) + 0.5);
+    if (end - begin <= leaf_size || depth >= quadtree_max_depth) {
+        return(node_idx);
+    }
+
+    // sort the sources into the four quadrants
+    int quadrant_begin[5];
+    int n_filled = begin;
+    for (int k = 0; k < 4; k++) {
+        quadrant_begin[k] = n_filled;
+        for (int i = begin; i < end; i++) {
+            int idx = order[i];
+            int quadrant = ((input.x[idx] >= center_x ? 1 : 0)
+                            + (input.y[idx] >= center_y ? 2 : 0));
+            if (quadrant == k) {
+                buffer[n_filled++] = idx;
+            }
+        }
+    }
+    quadrant_begin[4] = end;
+    for (int i = begin; i < end; i++) {
+        order[i] = buffer[i];
+    }
+    for (int k = 0; k < 4; k++) {
+        if (quadrant_begin[k + 1] == quadrant_begin[k]) {
+            continue;
+        }
+        double child_x = center_x + ((k & 1) ? size/4. : -size/4.);
+        double child_y = center_y + ((k & 2) ? size/4. : -size/4.);
+        int child = build_node(quadrant_begin[k], quadrant_begin[k + 1],
+                               child_x, child_y, size/2., order, buffer,
+                               input);
+        nodes[node_idx].children[k] = child;
+    }
+    return(node_idx);
+}
+
+void Source_quadtree::collect_interactions(double field_x, double field_y,
+                                           double z_1, double z_2, double c,
+                                           double opening_angle,
+                                           source_list *interactions) {
+    // the two nuclei are opened independently, bit k of the mask is set
+    // while the node still has to be resolved for nucleus k + 1
+    double z_sq[2] = {z_1*z_1, z_2*z_2};
+    // z - Delta in the exponent is z_1 - Delta_1 and -z_2 - Delta_2
+    double z_signed[2] = {z_1, -z_2};
+    int count = 0;
+    int stack_node[3*quadtree_max_depth + 4];
+    int stack_mask[3*quadtree_max_depth + 4];
+    int stack_size = 0;
+    stack_node[stack_size] = 0;
+    stack_mask[stack_size++] = 3;
+    while (stack_size > 0) {
+        stack_size--;
+        const quadtree_node &node = nodes[stack_node[stack_size]];
+        int mask = stack_mask[stack_size];
+        double dx = field_x - node.center_x;
+        double dy = field_y - node.center_y;
+        double d_perp_sq = dx*dx + dy*dy;
+        double gap_x = max(fabs(dx) - node.size/2., 0.0);
+        double gap_y = max(fabs(dy) - node.size/2., 0.0);
+        double d_min_sq = gap_x*gap_x + gap_y*gap_y;
+        double charge[2] = {node.charge_1, node.charge_2};
+        int open_mask = 0;
+        for (int k = 0; k < 2; k++) {
+            if (!(mask & (1 << k)) || charge[k] == 0.0) {
+                continue;
+            }
+            // drop nodes whose conductivity damping exp(c*(z - Delta)) is
+            // below exp(log_damping_cutoff) everywhere inside the box
+            double Delta_min = sqrt(d_min_sq + z_sq[k]);
+            if (c*(z_signed[k] - Delta_min) < log_damping_cutoff) {
+                continue;
+            }
+            // nodes with at most four sources are cheaper to open
+            bool accept = false;
+            if (node.end - node.begin > 4
+                && d_perp_sq > node.size*node.size) {
+                double d_perp = sqrt(d_perp_sq);
+                double Delta = sqrt(d_perp_sq + z_sq[k]);
+                accept = (node.size*(1./d_perp + c*d_perp/Delta)
+                          < opening_angle);
+            }
+            if (!accept) {
+                open_mask |= (1 << k);
+                continue;
+            }
+            for (int j = 0; j < 4; j++) {
+                interactions->x[count] = node.pseudo_x[k][j];
+                interactions->y[count] = node.pseudo_y[k][j];
+                interactions->rho_1[count] = (k == 0) ? charge[k]/4. : 0.0;
+                interactions->rho_2[count] = (k == 0) ? 0.0 : charge[k]/4.;
+                count++;
+            }
+        }
+        if (open_mask == 0) {
+            continue;
+        }
+        if (node.children[0] < 0 && node.children[1] < 0
+            && node.children[2] < 0 && node.children[3] < 0) {
+            for (int i = node.begin; i < node.end; i++) {
+                double rho_1 = (open_mask & 1) ? sources.rho_1[i] : 0.0;
+                double rho_2 = (open_mask & 2) ? sources.rho_2[i] : 0.0;
+                if (rho_1 == 0.0 && rho_2 == 0.0) {
+                    continue;
+                }
+                interactions->x[count] = sources.x[i];
+                interactions->y[count] = sources.y[i];
+                interactions->rho_1[count] = rho_1;
+                interactions->rho_2[count] = rho_2;
+                count++;
+            }
+        } else {
+            for (int k = 3; k >= 0; k--) {
+                if (node.children[k] >= 0) {
+                    stack_node[stack_size] = node.children[k];
+                    stack_mask[stack_size++] = open_mask;
+                }
+            }
+        }
+    }
+    // pad with zero-density points up to the SIMD width
+    int padded_length = (count + kernel_simd_width - 1)/kernel_simd_width
+                        *kernel_simd_width;
+    if (padded_length == 0) {
+        padded_length = kernel_simd_width;
+    }
+    for (int i = count; i < padded_length; i++) {
+        interactions->x[i] = 0.0;
+        interactions->y[i] = 0.0;
+        interactions->rho_1[i] = 0.0;
+        interactions->rho_2[i] = 0.0;
+    }
+    interactions->length = count;
+    interactions->padded_length = padded_length;
+}
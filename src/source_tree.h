@@ -0,0 +1,63 @@
+// Copyright 2016 Chun Shen
+#ifndef SRC_SOURCE_TREE_H_
+#define SRC_SOURCE_TREE_H_
+
+#include <vector>
+
+#include "./field_kernels.h"
+
+using namespace std;
+
+struct quadtree_node {
+    double center_x, center_y;  // center of the node box [fm]
+    double size;                // side length of the node box [fm]
+    int begin, end;             // range of its sources in tree order
+    int children[4];            // child nodes, -1 for a leaf
+    // charges of the two nuclei in the node
+    double charge_1, charge_2;
+    // four pseudo-particles of charge/4 per nucleus reproducing its
+    // monopole, dipole and quadrupole moments: they sit on the principal
+    // axes of the charge distribution at +-sqrt(2*lambda) from its centroid,
+    // lambda the eigenvalues of the second moments per unit charge
+    double pseudo_x[2][4], pseudo_y[2][4];
+};
+
+// Barnes-Hut quadtree over the transverse source points. A node is
+// replaced by the pseudo-particles of its two nuclei when
+//     size*(1/d_perp + c*d_perp/Delta) < opening_angle,
+// where d_perp is the transverse distance from the field point to the node
+// center, Delta = sqrt(d_perp^2 + z^2) with z of the given nucleus,
+// and c = sigma/2*sinh(spectator_rap). The bracket bounds the
+// relative variation of the integrand across the node, including the
+// exp(c*(z - Delta)) damping from the electric conductivity. The two
+// nuclei are opened independently, and nodes whose damping factor is below
+// exp(-50) over the whole box are skipped.
+class Source_quadtree {
+ private:
+    int leaf_size;
+    source_list sources;            // sources reordered in tree order
+    vector<quadtree_node> nodes;
+
+    int build_node(int begin, int end, double center_x, double center_y,
+                   double size, int *order, int *buffer,
+                   const source_list &input);
+
+ public:
+    Source_quadtree(const source_list &input, int leaf_size_in);
+    ~Source_quadtree();
+
+    int get_number_of_nodes() {return(nodes.size());}
+    int get_interaction_capacity() {
+        return(sources.length + 8*static_cast<int>(nodes.size()));
+    }
+
+    // fills interactions with the sources of opened nodes and the
+    // pseudo-particles of accepted nodes, ready to be passed to
+    // spectator_kernel()
+    void collect_interactions(double field_x, double field_y,
+                              double z_1, double z_2, double c,
+                              double opening_angle,
+                              source_list *interactions);
+};
+
+#endif  // SRC_SOURCE_TREE_H_
@@ -0,0 +1,214 @@
+// Copyright 2016 Chun Shen
+#include <stdlib.h>
+
+#include <iostream>
+#include <fstream>
+#include <iomanip>
+#include <cmath>
+#include <vector>
+#include <algorithm>
+
+#include "./synthetic_event.h"
+
+using namespace std;
+
+synthetic_event_setup default_synthetic_event_setup() {
+    synthetic_event_setup setup;
+    setup.grid_size = 261;
+    setup.grid_dx = 0.1;
+    setup.impact_parameter = 8.0;
+    setup.atomic_number = 197;
+    setup.radius = 6.38;
+    setup.diffuseness = 0.535;
+    setup.sigma_NN = 4.2;       // 42 mb
+    setup.n_surface_points = 1000;
+    setup.seed = 1;
+    return(setup);
+}
+
+// nuclear thickness T(s) of the Woods-Saxon nucleus on a table with
+// spacing ds, normalized to the atomic number
+static void woods_saxon_thickness(const synthetic_event_setup &setup,
+                                  double ds, vector<double> *thickness) {
+    double z_max = setup.radius + 20.*setup.diffuseness;
+    double dz = 0.02;
+    int n_z = static_cast<int>(z_max/dz);
+    int n_s = thickness->size();
+    for (int k = 0; k < n_s; k++) {
+        double s = k*ds;
+        double sum = 0.0;
+        for (int l = -n_z; l <= n_z; l++) {
+            double r = sqrt(s*s + l*dz*l*dz);
+            sum += 1./(1. + exp((r - setup.radius)/setup.diffuseness));
+        }
+        (*thickness)[k] = sum*dz;
+    }
+    double norm = 0.0;
+    for (int k = 0; k < n_s; k++) {
+        norm += 2.*M_PI*k*ds*(*thickness)[k]*ds;
+    }
+    for (int k = 0; k < n_s; k++) {
+        (*thickness)[k] *= setup.atomic_number/norm;
+    }
+}
+
+static double interpolate_thickness(const vector<double> &thickness,
+                                    double ds, double s) {
+    double t = s/ds;
+    int k = static_cast<int>(t);
+    if (k + 1 >= static_cast<int>(thickness.size())) {
+        return(0.0);
+    }
+    double frac = t - k;
+    return((1. - frac)*thickness[k] + frac*thickness[k + 1]);
+}
+
+static void write_density(string filename, int grid_size,
+                          const vector<double> &density) {
+    ofstream output(filename.c_str());
+    if (!output.good()) {
+        cout << "Error:write_synthetic_event: can not write " << filename
+             << endl;
+        exit(1);
+    }
+    output << scientific << setprecision(8);
+    for (int i = 0; i < grid_size; i++) {
+        for (int j = 0; j < grid_size; j++) {
+            output << density[i*grid_size + j] << "  ";
+        }
+        output << endl;
+    }
+    output.close();
+}
+
+void write_synthetic_event(string directory,
+                           const synthetic_event_setup &setup) {
+    int n = setup.grid_size;
+    double ds = 0.01;
+    double grid_extent = sqrt(2.)*(n - 1)/2.*setup.grid_dx;
+    vector<double> thickness(static_cast<int>(
+        (grid_extent + setup.impact_parameter)/ds) + 2);
+    woods_saxon_thickness(setup, ds, &thickness);
+    double density_cutoff = 1e-8*thickness[0];
+
+    vector<double> spectator_A(n*n), spectator_B(n*n);
+    vector<double> participant_A(n*n), participant_B(n*n);
+    for (int i = 0; i < n; i++) {
+        double x = (-(n - 1)/2. + i)*setup.grid_dx;
+        for (int j = 0; j < n; j++) {
+            double y = (-(n - 1)/2. + j)*setup.grid_dx;
+            double b_half = setup.impact_parameter/2.;
+            double T_A = interpolate_thickness(
+                    thickness, ds, sqrt((x - b_half)*(x - b_half) + y*y));
+            double T_B = interpolate_thickness(
+                    thickness, ds, sqrt((x + b_half)*(x + b_half) + y*y));
+            // wounded nucleons of the optical Glauber model
+            double part_A = T_A*(1. - exp(-setup.sigma_NN*T_B));
+            double part_B = T_B*(1. - exp(-setup.sigma_NN*T_A));
+            int idx = i*n + j;
+            spectator_A[idx] = T_A - part_A;
+            spectator_B[idx] = T_B - part_B;
+            participant_A[idx] = part_A;
+            participant_B[idx] = part_B;
+            double *densities[4] = {&spectator_A[idx], &spectator_B[idx],
+                                    &participant_A[idx],
+                                    &participant_B[idx]};
+            for (int k = 0; k < 4; k++) {
+                if (*densities[k] < density_cutoff) {
+                    *densities[k] = 0.0;
+                }
+            }
+        }
+    }
+    write_density(directory + "/spectator_density_A_fromSd_order_2.dat", n,
+                  spectator_A);
+    write_density(directory + "/spectator_density_B_fromSd_order_2.dat", n,
+                  spectator_B);
+    write_density(directory + "/nuclear_thickness_TA_fromSd_order_2.dat", n,
+                  participant_A);
+    write_density(directory + "/nuclear_thickness_TB_fromSd_order_2.dat", n,
+                  participant_B);
+
+    // freeze-out cells in the almond of the overlap region, with a radial
+    // flow growing with the distance from the center
+    string surface_filename = directory + "/surface.dat";
+    ofstream surface(surface_filename.c_str());
+    if (!surface.good()) {
+        cout << "Error:write_synthetic_event: can not write "
+             << surface_filename << endl;
+        exit(1);
+    }
+    srand(setup.seed);
+    double R_x = max(setup.radius - setup.impact_parameter/2., 1.0);
+    double R_y = sqrt(max(setup.radius*setup.radius
+                          - setup.impact_parameter*setup.impact_parameter
+                            /4., 1.0));
+    surface << scientific << setprecision(8);
+    for (int k = 0; k < setup.n_surface_points; k++) {
+        double phi = 2.*M_PI*rand()/(RAND_MAX + 1.);
+        double r = sqrt(rand()/(RAND_MAX + 1.));
+        double x = r*R_x*cos(phi);
+        double y = r*R_y*sin(phi);
+        double tau = 0.6 + 9.4*rand()/(RAND_MAX + 1.);
+        double u_x = 0.1*x;
+        double u_y = 0.1*y;
+        double u_tau = sqrt(1. + u_x*u_x + u_y*u_y);
+        double T = 0.15;
+        double columns[29] = {tau, x, y, 0.0,       // position
+                              1.0, 0.1, 0.1, 0.0,   // da_mu
+                              u_tau, u_x, u_y, 0.0,
+                              0.3, 0.0, T};     // remaining columns: 0
+        for (int c = 0; c < 29; c++) {
+            surface << columns[c] << " ";
+        }
+        surface << endl;
+    }
+    surface.close();
+}
+
+void write_point_charge_event(string directory,
+                              const synthetic_event_setup &setup,
+                              double *x_A, double *y_A) {
+    int n = setup.grid_size;
+    double center = (n - 1)/2.;
+    int i_A = lround(setup.impact_parameter/2./setup.grid_dx + center);
+    int j_A = lround(setup.impact_parameter/4./setup.grid_dx + center);
+    i_A = min(max(i_A, 0), n - 1);
+    j_A = min(max(j_A, 0), n - 1);
+    *x_A = (-center + i_A)*setup.grid_dx;
+    *y_A = (-center + j_A)*setup.grid_dx;
+
+    vector<double> spectator_A(n*n, 0.0), spectator_B(n*n, 0.0);
+    vector<double> participants(n*n, 0.0);
+    double point_density = (setup.atomic_number
+                            /(setup.grid_dx*setup.grid_dx));
+    spectator_A[i_A*n + j_A] = point_density;
+    spectator_B[(n - 1 - i_A)*n + (n - 1 - j_A)] = point_density;
+    write_density(directory + "/spectator_density_A_disk.dat", n,
+                  spectator_A);
+    write_density(directory + "/spectator_density_B_disk.dat", n,
+                  spectator_B);
+    write_density(directory + "/nuclear_thickness_TA_fromSd_order_2.dat", n,
+                  participants);
+    write_density(directory + "/nuclear_thickness_TB_fromSd_order_2.dat", n,
+                  participants);
+
+    string surface_filename = directory + "/surface.dat";
+    ofstream surface(surface_filename.c_str());
+    if (!surface.good()) {
+        cout << "Error:write_point_charge_event: can not write "
+             << surface_filename << endl;
+        exit(1);
+    }
+    srand(setup.seed);
+    surface << "# x[fm]  tau[fm]  u^tau  u^x" << endl;
+    surface << scientific << setprecision(8);
+    for (int k = 0; k < setup.n_surface_points; k++) {
+        double x = -10. + 20.*rand()/(RAND_MAX + 1.);
+        double tau = 0.5 + 4.5*rand()/(RAND_MAX + 1.);
+        double u_x = 0.1*x;
+        surface << x << " " << tau << " " << sqrt(1. + u_x*u_x) << " "
+                << u_x << endl;
+    }
+    surface.close();
+}
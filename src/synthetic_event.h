@@ -0,0 +1,48 @@
+// Copyright 2016 Chun Shen
+#ifndef SRC_SYNTHETIC_EVENT_H_
+#define SRC_SYNTHETIC_EVENT_H_
+
+#include <string>
+
+using namespace std;
+
+struct synthetic_event_setup {
+    int grid_size;              // nucleon_density_grid_size
+    double grid_dx;             // nucleon_density_grid_dx [fm]
+    double impact_parameter;    // [fm]
+    int atomic_number;
+    double radius;              // Woods-Saxon radius [fm]
+    double diffuseness;         // Woods-Saxon diffuseness [fm]
+    double sigma_NN;            // inelastic nucleon-nucleon cross section
+                                // [fm^2]
+    int n_surface_points;       // transverse points of surface.dat
+    int seed;
+};
+
+// setup of two Au nuclei at the given impact parameter
+synthetic_event_setup default_synthetic_event_setup();
+
+// Writes the input files of an event with two Woods-Saxon nuclei to
+// directory, which has to exist:
+//  - the spectator and participant densities of the optical Glauber model,
+//    nucleus A centered at x = b/2 and nucleus B at x = -b/2. Densities
+//    below 1e-8 of the largest thickness are set to zero, so the sources
+//    have a finite support like the Monte-Carlo densities.
+//  - surface.dat in the boost invariant VISH2+1 format (mode 3) with
+//    n_surface_points random cells inside the overlap region.
+void write_synthetic_event(string directory,
+                           const synthetic_event_setup &setup);
+
+// Writes the input files of the Gubser mode (mode -1) for two point charges
+// of atomic_number nucleons each to directory, which has to exist:
+//  - spectator_density_A/B_disk.dat with all nucleons of nucleus A at the
+//    grid point closest to (b/2, b/4) and the ones of nucleus B at the
+//    mirror point, returned in (x_A, y_A) and (-x_A, -y_A),
+//  - zero participant densities,
+//  - surface.dat in the Gubser format with n_surface_points cells at
+//    y = eta = 0 for -10 fm < x < 10 fm and 0.5 fm < tau < 5 fm.
+void write_point_charge_event(string directory,
+                              const synthetic_event_setup &setup,
+                              double *x_A, double *y_A);
+
+#endif  // SRC_SYNTHETIC_EVENT_H_
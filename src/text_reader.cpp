@@ -0,0 +1,284 @@
+// Copyright 2016 Chun Shen
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <omp.h>
+
+#include <iostream>
+#include <algorithm>
+
+#include "./text_reader.h"
+
+using namespace std;
+
+// Decimal numbers with at most 19
+// significant digits, a mantissa below 2^53 and a decimal exponent of at
+// most 22 are one exact multiplication or division by an exact power of
+// ten, hence correctly rounded like strtod(). All other tokens go through
+// strtod().
+bool parse_text_number(const char *begin, const char *end, double *value) {
+    static const double powers_of_ten[23] = {
+        1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11, 1e12,
+        1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+    const char *p = begin;
+    bool negative = false;
+    if (p < end && (*p == '+' || *p == '-')) {
+        negative = (*p == '-');
+        p++;
+    }
+    unsigned long long mantissa = 0;
+    int n_digits = 0;               // significant digits in the mantissa
+    int exponent = 0;
+    bool has_digits = false;
+    bool fast = true;
+    while (p < end && *p >= '0' && *p <= '9') {
+        has_digits = true;
+        if (mantissa != 0 || *p != '0') {
+            mantissa = 10*mantissa + (*p - '0');
+            n_digits++;
+        }
+        p++;
+    }
+    if (p < end && *p == '.') {
+        p++;
+        while (p < end && *p >= '0' && *p <= '9') {
+            has_digits = true;
+            if (mantissa != 0 || *p != '0') {
+                mantissa = 10*mantissa + (*p - '0');
+                n_digits++;
+            }
+            exponent--;
+            p++;
+        }
+    }
+    if (has_digits && p < end && (*p == 'e' || *p == 'E')) {
+        p++;
+        bool negative_exponent = false;
+        if (p < end && (*p == '+' || *p == '-')) {
+            negative_exponent = (*p == '-');
+            p++;
+        }
+        if (p == end || *p < '0' || *p > '9') {
+            has_digits = false;
+        }
+        int explicit_exponent = 0;
+        while (p < end && *p >= '0' && *p <= '9') {
+            if (explicit_exponent < 10000) {
+                explicit_exponent = 10*explicit_exponent + (*p - '0');
+            } else {
+                fast = false;
+            }
+            p++;
+        }
+        exponent += (negative_exponent ? -explicit_exponent
+                                       : explicit_exponent);
+    }
+    if (has_digits && p == end && fast && n_digits <= 19
+        && mantissa <= (1ULL << 53) && exponent >= -22 && exponent <= 22) {
+        double result = static_cast<double>(mantissa);
+        if (exponent >= 0) {
+            result *= powers_of_ten[exponent];
+        } else {
+            result /= powers_of_ten[-exponent];
+        }
+        *value = negative ? -result : result;
+        return(true);
+    }
+
+    // long mantissas, large exponents, nan, inf, hexadecimal numbers
+    char token[64];
+    int length = end - begin;
+    if (length >= static_cast<int>(sizeof(token))) {
+        return(false);
+    }
+    memcpy(token, begin, length);
+    token[length] = '\0';
+    char *token_end;
+    *value = strtod(token, &token_end);
+    return(token_end == token + length);
+}
+
+// start of the line after the one holding p
+static const char *skip_to_next_line(const char *p, const char *end) {
+    const char *line_end = static_cast<const char*>(
+                                        memchr(p, '\n', end - p));
+    return((line_end == NULL) ? end : line_end + 1);
+}
+
+// first character of the data in the line starting at p, line_end if the
+// line is empty or a comment
+static const char *skip_to_data(const char *p, const char *line_end) {
+    while (p < line_end && is_text_space(*p)) {
+        p++;
+    }
+    if (p < line_end && *p == '#') {
+        return(line_end);
+    }
+    return(p);
+}
+
+static long count_data_lines(const char *begin, const char *end) {
+    long n_lines = 0;
+    const char *p = begin;
+    while (p < end) {
+        const char *next_line = skip_to_next_line(p, end);
+        if (skip_to_data(p, next_line) < next_line) {
+            n_lines++;
+        }
+        p = next_line;
+    }
+    return(n_lines);
+}
+
+bool map_text_file(string filename, const char **data, size_t *size) {
+    int file = open(filename.c_str(), O_RDONLY);
+    struct stat file_status;
+    if (file < 0) {
+        return(false);
+    }
+    if (fstat(file, &file_status) != 0) {
+        close(file);
+        return(false);
+    }
+    *size = file_status.st_size;
+    *data = NULL;
+    if (*size > 0) {
+        void *mapping = mmap(NULL, *size, PROT_READ, MAP_PRIVATE, file, 0);
+        if (mapping == MAP_FAILED) {
+            cout << "Error:map_text_file: can not map file " << filename
+                 << endl;
+            exit(1);
+        }
+        madvise(mapping, *size, MADV_SEQUENTIAL);
+        *data = static_cast<const char*>(mapping);
+    }
+    close(file);
+    return(true);
+}
+
+void unmap_text_file(const char *data, size_t size) {
+    if (size > 0) {
+        munmap(const_cast<char*>(data), size);
+    }
+}
+
+long count_text_lines(string filename) {
+    const char *data;
+    size_t file_size;
+    if (!map_text_file(filename, &data, &file_size)) {
+        return(0);
+    }
+    long n_lines = count_data_lines(data, data + file_size);
+    unmap_text_file(data, file_size);
+    return(n_lines);
+}
+
+// parses the data lines of [begin, end) into values, returns the first line
+// which can not be parsed or NULL
+static const char *parse_data_lines(const char *begin, const char *end,
+                                    const vector<int> &column_slot,
+                                    int n_columns, double *values) {
+    int n_needed_columns = column_slot.size();
+    const char *p = begin;
+    while (p < end) {
+        const char *line = p;
+        const char *next_line = skip_to_next_line(p, end);
+        p = next_line;
+        const char *q = skip_to_data(line, next_line);
+        if (q == next_line) {
+            continue;
+        }
+        int i_column = 0;
+        while (q < next_line && i_column < n_needed_columns) {
+            const char *token = q;
+            while (q < next_line && !is_text_space(*q)) {
+                q++;
+            }
+            int slot = column_slot[i_column];
+            if (slot >= 0 && !parse_text_number(token, q, &values[slot])) {
+                return(line);
+            }
+            i_column++;
+            while (q < next_line && is_text_space(*q)) {
+                q++;
+            }
+        }
+        if (i_column < n_needed_columns) {
+            return(line);
+        }
+        values += n_columns;
+    }
+    return(NULL);
+}
+
+long read_text_columns(string filename, const vector<int> &columns,
+                       vector<double> *values) {
+    const char *data;
+    size_t file_size;
+    if (!map_text_file(filename, &data, &file_size)) {
+        cout << "Error:read_text_columns: can not open file " << filename
+             << endl;
+        exit(1);
+    }
+    const char *end = data + file_size;
+
+    // position of the columns in a row of values, -1 for skipped columns
+    int n_columns = columns.size();
+    vector<int> column_slot(
+            *max_element(columns.begin(), columns.end()) + 1, -1);
+    for (int k = 0; k < n_columns; k++) {
+        column_slot[columns[k]] = k;
+    }
+
+    // one chunk per thread, files below 1 MB are read by one thread
+    int n_chunks = 1;
+    if (file_size > (1 << 20)) {
+        n_chunks = omp_get_max_threads();
+    }
+    vector<const char*> chunk_begin(n_chunks + 1, end);
+    chunk_begin[0] = data;
+    for (int k = 1; k < n_chunks; k++) {
+        const char *p = max(data + file_size/n_chunks*k, chunk_begin[k - 1]);
+        chunk_begin[k] = (p == data) ? p : skip_to_next_line(p - 1, end);
+    }
+    vector<long> chunk_rows(n_chunks + 1, 0);
+    #pragma omp parallel for schedule(static, 1)
+    for (int k = 0; k < n_chunks; k++) {
+        chunk_rows[k + 1] = count_data_lines(chunk_begin[k],
+                                             chunk_begin[k + 1]);
+    }
+    for (int k = 0; k < n_chunks; k++) {
+        chunk_rows[k + 1] += chunk_rows[k];
+    }
+    long n_rows = chunk_rows[n_chunks];
+    values->resize(n_rows*n_columns);
+
+    vector<const char*> failed_line(n_chunks, static_cast<const char*>(NULL));
+    #pragma omp parallel for schedule(static, 1)
+    for (int k = 0; k < n_chunks; k++) {
+        failed_line[k] = parse_data_lines(
+                chunk_begin[k], chunk_begin[k + 1], column_slot, n_columns,
+                values->empty() ? NULL : &(*values)[chunk_rows[k]*n_columns]);
+    }
+    for (int k = 0; k < n_chunks; k++) {
+        if (failed_line[k] != NULL) {
+            const char *line = failed_line[k];
+            long line_number = 1 + count(data, line, '\n');
+            const char *line_end = static_cast<const char*>(
+                        memchr(line, '\n', end - line));
+            if (line_end == NULL) {
+                line_end = end;
+            }
+            cout << "Error:read_text_columns: " << filename << " line "
+                 << line_number << " does not hold numbers in the columns "
+                 << "up to " << column_slot.size() << ": "
+                 << string(line, min<long>(line_end - line, 200)) << endl;
+            exit(1);
+        }
+    }
+    unmap_text_file(data, file_size);
+    return(n_rows);
+}
@@ -0,0 +1,38 @@
+// Copyright 2016 Chun Shen
+#ifndef SRC_TEXT_READER_H_
+#define SRC_TEXT_READER_H_
+
+#include <string>
+#include <vector>
+
+using namespace std;
+
+inline bool is_text_space(char c) {
+    return(c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\v'
+           || c == '\f');
+}
+
+// Parses the number in [begin, end) into value, locale independent and
+// correctly rounded like strtod(). Returns false if the token is not a
+// number.
+bool parse_text_number(const char *begin, const char *end, double *value);
+
+// maps the file read-only into memory, returns false if it can not be
+// opened. An empty file gives data = NULL and size = 0.
+bool map_text_file(string filename, const char **data, size_t *size);
+void unmap_text_file(const char *data, size_t size);
+
+// number of lines which are neither empty nor start with #, 0 if the file
+// can not be opened
+long count_text_lines(string filename);
+
+// Reads the given columns (counted from 0) of every line of a white space
+// separated text file into values, line by line, and returns the number of
+// lines read. Empty lines and lines starting with # are skipped. The file
+// is memory mapped and split at line boundaries into one chunk per thread,
+// the chunks are parsed in parallel. A line without all the columns or
+// with a column that is not a number is an error.
+long read_text_columns(string filename, const vector<int> &columns,
+                       vector<double> *values);
+
+#endif  // SRC_TEXT_READER_H_
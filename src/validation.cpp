@@ -0,0 +1,387 @@
+/////////////////////////////////////////////////////////////////////////
+//              Accuracy validation of the EM field kernels
+//
+//              author: Chun Shen <chunshen@physics.mcgill.ca>
+//              Copyright 2016 Chun Shen
+//
+//  Usage: EM_fields_validation.e [event_path] [key=value ...]
+//
+//  Computes the fields and the drift velocities of an event with the
+//  kernel settings of parameters.dat and the command line and compares
+//  them on validation_cells (100) cells, sampled with a stride through all
+//  cells and rapidity slices of the event, with the reference: the
+//  double precision direct sum over all sources with the portable scalar
+//  kernel, without symmetries, lattice or cache. For every field component
+//  and drift velocity the largest error, the largest error relative to the
+//  largest reference value in the rapidity slice of the cell (of E or B
+//  for components vanishing by symmetry) and the RMS error are reported.
+//  The validation fails (exit status 1) if a relative error exceeds
+//  validation_field_tolerance (1e-3) or validation_drift_tolerance (1e-3).
+//
+//  Without event_path a synthetic Au+Au event is generated in
+//  ./validation_event (modes 0, 2 and 3). In mode -1 the generated event
+//  holds two point charges and the reference fields are also compared with
+//  the analytic fields of the point charges, within
+//  validation_analytic_tolerance (1e-6).
+//
+/////////////////////////////////////////////////////////////////////////
+
+#include <stdlib.h>
+#include <sys/stat.h>
+
+#include <iostream>
+#include <iomanip>
+#include <cmath>
+#include <string>
+#include <vector>
+#include <map>
+#include <algorithm>
+
+#include "./EM_fields.h"
+#include "./ParameterReader.h"
+#include "./parameter.h"
+#include "./phase_timer.h"
+#include "./synthetic_event.h"
+
+using namespace std;
+
+const int n_field_components = 6;   // E_x, E_y, E_z, B_x, B_y, B_z
+const int n_drift_velocities = 4;   // q = 1, -1, 2, -2
+
+struct error_summary {
+    string name;
+    double tolerance;           // on the relative error
+    double max_error;
+    double max_reference;
+    double max_relative;        // largest error relative to the scale
+    double sum_sq_error;
+    long n_values;
+};
+
+static error_summary new_error_summary(string name, double tolerance) {
+    error_summary summary;
+    summary.name = name;
+    summary.tolerance = tolerance;
+    summary.max_error = 0.0;
+    summary.max_reference = 0.0;
+    summary.max_relative = 0.0;
+    summary.sum_sq_error = 0.0;
+    summary.n_values = 0;
+    return(summary);
+}
+
+// adds the errors of n_values values, relative to scale (> 0) or absolute
+static void add_values(error_summary *summary, const double *values,
+                       const double *reference, int n_values,
+                       double scale) {
+    for (int k = 0; k < n_values; k++) {
+        double error = fabs(values[k] - reference[k]);
+        double relative = (scale > 0.0) ? error/scale : error;
+        // a NaN fails the validation
+        if (!(error <= summary->max_error)) {
+            summary->max_error = error;
+        }
+        if (!(relative <= summary->max_relative)) {
+            summary->max_relative = relative;
+        }
+        summary->max_reference = max(summary->max_reference,
+                                     fabs(reference[k]));
+        summary->sum_sq_error += error*error;
+        summary->n_values++;
+    }
+}
+
+static void get_fields(const fluidCell &cell, double *fields) {
+    fields[0] = cell.E_lab.x;
+    fields[1] = cell.E_lab.y;
+    fields[2] = cell.E_lab.z;
+    fields[3] = cell.B_lab.x;
+    fields[4] = cell.B_lab.y;
+    fields[5] = cell.B_lab.z;
+}
+
+static void get_drift_velocity(const fluidCell &cell, int i_charge,
+                               double *u) {
+    const vector4 *drift_velocities[n_drift_velocities] = {
+        &cell.drift_u_plus, &cell.drift_u_minus, &cell.drift_u_plus_2,
+        &cell.drift_u_minus_2};
+    const vector4 &drift = *drift_velocities[i_charge];
+    u[0] = drift.tau;
+    u[1] = drift.x;
+    u[2] = drift.y;
+    u[3] = drift.eta;
+}
+
+// adds the lab frame fields [GeV^2] at (t, x, y, z) of n_protons protons at
+// (x_0, y_0) moving with the rapidity direction*rapidity through a medium
+// with the electric conductivity sigma. The field engine keeps E_z only in
+// vacuum.
+static void add_point_charge_fields(double n_protons, double x_0,
+                                    double y_0, int direction,
+                                    double rapidity, double sigma, double t,
+                                    double x, double y, double z,
+                                    double *fields) {
+    double gamma = cosh(rapidity);
+    double gamma_v = sinh(rapidity);
+    double v = tanh(rapidity);
+    double zeta = gamma*(v*t - direction*z);
+    double x_T = x - x_0;
+    double y_T = y - y_0;
+    double Delta = sqrt(x_T*x_T + y_T*y_T + zeta*zeta);
+    double factor = n_protons*alpha_EM*hbarCsq/(Delta*Delta*Delta);
+    if (sigma > 0.0) {
+        factor *= ((1. + sigma/2.*gamma_v*Delta)
+                   *exp(sigma/2.*gamma_v*(zeta - Delta)));
+    } else {
+        fields[2] += -direction*zeta*factor;
+    }
+    fields[0] += gamma*x_T*factor;
+    fields[1] += gamma*y_T*factor;
+    fields[3] += -direction*v*gamma*y_T*factor;
+    fields[4] += direction*v*gamma*x_T*factor;
+}
+
+// stride through the n_cells cells close to n_cells/golden ratio and
+// coprime to n_cells. The sampled cells i*stride % n_cells are distinct and
+// spread over the whole event: the cells of the surface modes are stored
+// as n_eta consecutive rapidities per transverse point, and a stride
+// coprime to n_eta visits every rapidity slice.
+static long sample_stride(long n_cells) {
+    long stride = max(static_cast<long>(0.6180339887*n_cells), 1L);
+    while (true) {
+        long a = stride, b = n_cells;
+        while (b != 0) {
+            long r = a % b;
+            a = b;
+            b = r;
+        }
+        if (a == 1) {
+            return(stride);
+        }
+        stride++;
+    }
+}
+
+// prints the errors, returns false if a tolerance is exceeded
+static bool report_errors(string title, int n_cells,
+                          const vector<error_summary> &summaries) {
+    cout << endl << title << " on " << n_cells << " cells:" << endl;
+    cout << "  " << left << setw(16) << "quantity" << right << setw(14)
+         << "max error" << setw(14) << "max reference" << setw(14)
+         << "relative" << setw(14) << "RMS error" << setw(12)
+         << "tolerance" << endl;
+    bool passed = true;
+    for (unsigned int i = 0; i < summaries.size(); i++) {
+        const error_summary &summary = summaries[i];
+        double relative = summary.max_relative;
+        bool summary_passed = (relative <= summary.tolerance);
+        passed = passed && summary_passed;
+        double rms_error = sqrt(summary.sum_sq_error
+                                /max(summary.n_values, 1L));
+        cout << "  " << left << setw(16) << summary.name << right
+             << scientific << setprecision(4) << setw(14)
+             << summary.max_error << setw(14) << summary.max_reference
+             << setw(14) << relative << setw(14) << rms_error << setw(12)
+             << summary.tolerance << (summary_passed ? "" : "  FAILED")
+             << endl;
+    }
+    cout.unsetf(ios::scientific);
+    return(passed);
+}
+
+int main(int argc, char *argv[]) {
+    string event_path = "";
+    int first_parameter_argument = 1;
+    if (argc > 1 && string(argv[1]).find("=") == string::npos) {
+        event_path = argv[1];
+        first_parameter_argument = 2;
+    }
+    ParameterReader paraRdr;
+    paraRdr.readFromFile("parameters.dat");
+    paraRdr.readFromArguments(argc, argv, "#", first_parameter_argument);
+    // no check files in ./results
+    paraRdr.setVal("debug_flag", 0);
+
+    int mode = paraRdr.getVal("mode");
+    int n_samples = paraRdr.getVal("validation_cells", 100);
+    double field_tolerance = paraRdr.getVal("validation_field_tolerance",
+                                            1e-3);
+    double drift_tolerance = paraRdr.getVal("validation_drift_tolerance",
+                                            1e-3);
+    double analytic_tolerance = paraRdr.getVal(
+                                    "validation_analytic_tolerance", 1e-6);
+    if (n_samples < 1) {
+        cout << "Error: validation_cells = " << n_samples << " < 1!"
+             << endl;
+        exit(1);
+    }
+
+    bool point_charges = false;
+    double x_A = 0.0, y_A = 0.0;
+    synthetic_event_setup event_setup = default_synthetic_event_setup();
+    if (event_path == "") {
+        if (mode != 0 && mode != 2 && mode != 3 && mode != -1) {
+            cout << "Error: mode = " << mode << " needs the path of an "
+                 << "event!" << endl;
+            exit(1);
+        }
+        event_path = "./validation_event";
+        mkdir(event_path.c_str(), 0755);
+        event_setup.grid_size = paraRdr.getVal("nucleon_density_grid_size");
+        event_setup.grid_dx = paraRdr.getVal("nucleon_density_grid_dx");
+        event_setup.n_surface_points = n_samples;
+        if (mode == -1) {
+            event_setup.atomic_number = paraRdr.getVal("atomic_number");
+            write_point_charge_event(event_path, event_setup, &x_A, &y_A);
+            point_charges = true;
+        } else {
+            write_synthetic_event(event_path, event_setup);
+        }
+    }
+
+    // the selected kernel on all cells of the event
+    Phase_timer timer;
+    EM_fields candidate_EM(&paraRdr, event_path, &timer);
+    candidate_EM.calculate_EM_fields();
+    candidate_EM.calculate_charge_drifting_velocity();
+    int n_cells = candidate_EM.get_number_of_cells();
+    n_samples = min(n_samples, n_cells);
+    vector<int> samples(n_samples);
+    long stride = sample_stride(n_cells);
+    for (int i = 0; i < n_samples; i++) {
+        samples[i] = static_cast<int>(i*stride % n_cells);
+    }
+    sort(samples.begin(), samples.end());
+
+    // the reference on the sampled cells
+    paraRdr.setVal("field_kernel_method", 0);
+    paraRdr.setVal("kernel_precision", 64);
+    paraRdr.setVal("participant_kernel_method", 0);
+    paraRdr.setVal("simd_kernel", 0);
+    paraRdr.setVal("mirror_symmetry", 0);
+    paraRdr.setVal("radial_symmetry", 0);
+    paraRdr.setVal("field_lattice", 0);
+    paraRdr.setVal("field_cache", 0);
+    EM_fields reference_EM(&paraRdr, event_path, &timer);
+    reference_EM.select_cells(samples);
+    reference_EM.calculate_EM_fields();
+    reference_EM.calculate_charge_drifting_velocity();
+
+    const char *field_names[n_field_components] = {
+        "E_x [GeV^2]", "E_y [GeV^2]", "E_z [GeV^2]", "B_x [GeV^2]",
+        "B_y [GeV^2]", "B_z [GeV^2]"};
+    const char *drift_names[n_drift_velocities] = {
+        "u (q = +1)", "u (q = -1)", "u (q = +2)", "u (q = -2)"};
+    vector<error_summary> kernel_errors;
+    for (int k = 0; k < n_field_components; k++) {
+        kernel_errors.push_back(new_error_summary(field_names[k],
+                                                  field_tolerance));
+    }
+    for (int k = 0; k < n_drift_velocities; k++) {
+        kernel_errors.push_back(new_error_summary(drift_names[k],
+                                                  drift_tolerance));
+    }
+    // the errors are relative to the largest reference value of the
+    // quantity in the rapidity slice of the cell, the fields next to the
+    // spectator sheets would hide the errors at mid-rapidity
+    map<double, vector<double> > slice_scales;
+    for (int i = 0; i < n_samples; i++) {
+        const fluidCell &reference_cell = reference_EM.get_cell(i);
+        vector<double> &scales = slice_scales[reference_cell.eta];
+        scales.resize(n_field_components + n_drift_velocities, 0.0);
+        double reference_fields[n_field_components];
+        get_fields(reference_cell, reference_fields);
+        for (int k = 0; k < n_field_components; k++) {
+            scales[k] = max(scales[k], fabs(reference_fields[k]));
+        }
+        for (int k = 0; k < n_drift_velocities; k++) {
+            double reference_u[4];
+            get_drift_velocity(reference_cell, k, reference_u);
+            for (int l = 0; l < 4; l++) {
+                scales[n_field_components + k] = max(
+                    scales[n_field_components + k], fabs(reference_u[l]));
+            }
+        }
+    }
+    // components vanishing by symmetry only hold rounding errors, they are
+    // compared with the largest component of E or B
+    const double symmetry_zero = 1e-10;
+    for (map<double, vector<double> >::iterator it = slice_scales.begin();
+         it != slice_scales.end(); ++it) {
+        vector<double> &scales = it->second;
+        for (int first = 0; first < n_field_components; first += 3) {
+            double field_scale = max(max(scales[first], scales[first + 1]),
+                                     scales[first + 2]);
+            for (int k = first; k < first + 3; k++) {
+                if (scales[k] < symmetry_zero*field_scale) {
+                    scales[k] = field_scale;
+                }
+            }
+        }
+    }
+    for (int i = 0; i < n_samples; i++) {
+        const fluidCell &cell = candidate_EM.get_cell(samples[i]);
+        const fluidCell &reference_cell = reference_EM.get_cell(i);
+        double fields[n_field_components];
+        double reference_fields[n_field_components];
+        get_fields(cell, fields);
+        get_fields(reference_cell, reference_fields);
+        const vector<double> &scales = slice_scales[reference_cell.eta];
+        for (int k = 0; k < n_field_components; k++) {
+            add_values(&kernel_errors[k], &fields[k], &reference_fields[k],
+                       1, scales[k]);
+        }
+        for (int k = 0; k < n_drift_velocities; k++) {
+            double u[4], reference_u[4];
+            get_drift_velocity(cell, k, u);
+            get_drift_velocity(reference_cell, k, reference_u);
+            add_values(&kernel_errors[n_field_components + k], u,
+                       reference_u, 4, scales[n_field_components + k]);
+        }
+    }
+    bool passed = report_errors(
+        "selected kernel against the double precision direct sum",
+        n_samples, kernel_errors);
+
+    if (point_charges) {
+        double n_protons = paraRdr.getVal("number_of_proton");
+        double sigma = paraRdr.getVal("electric_conductivity");
+        double gamma = paraRdr.getVal("ecm")/2./0.938;
+        double rapidity = acosh(gamma);
+        vector<error_summary> analytic_errors;
+        for (int k = 0; k < n_field_components; k++) {
+            analytic_errors.push_back(new_error_summary(field_names[k],
+                                                        analytic_tolerance));
+        }
+        for (int i = 0; i < n_samples; i++) {
+            const fluidCell &cell = reference_EM.get_cell(i);
+            double t = cell.tau*cosh(cell.eta);
+            double z = cell.tau*sinh(cell.eta);
+            double analytic_fields[n_field_components] = {
+                0.0, 0.0, 0.0, 0.0, 0.0, 0.0};
+            add_point_charge_fields(n_protons, x_A, y_A, 1, rapidity, sigma,
+                                    t, cell.x, cell.y, z, analytic_fields);
+            add_point_charge_fields(n_protons, -x_A, -y_A, -1, rapidity,
+                                    sigma, t, cell.x, cell.y, z,
+                                    analytic_fields);
+            double fields[n_field_components];
+            get_fields(cell, fields);
+            const vector<double> &scales = slice_scales[cell.eta];
+            for (int k = 0; k < n_field_components; k++) {
+                add_values(&analytic_errors[k], &fields[k],
+                           &analytic_fields[k], 1, scales[k]);
+            }
+        }
+        passed = (report_errors(
+                    "direct sum against the analytic point charge fields",
+                    n_samples, analytic_errors)
+                  && passed);
+    }
+
+    if (!passed) {
+        cout << endl << "validation FAILED!" << endl;
+        exit(1);
+    }
+    cout << endl << "validation passed." << endl;
+    return(0);
+}
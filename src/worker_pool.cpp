@@ -0,0 +1,233 @@
+// Copyright 2016 Chun Shen
+#include <stdlib.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/time.h>
+#include <sys/wait.h>
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <map>
+
+#include "./worker_pool.h"
+#include "./density_reader.h"
+#include "./text_reader.h"
+
+using namespace std;
+
+static double wall_time() {
+    struct timeval now;
+    gettimeofday(&now, NULL);
+    return(now.tv_sec + 1e-6*now.tv_usec);
+}
+
+static bool more_expensive(const campaign_event &a,
+                           const campaign_event &b) {
+    return(a.cost > b.cost);
+}
+
+Worker_pool::Worker_pool(string executable_in, int n_workers_in,
+                         const vector<string> &arguments_in,
+                         string journal_filename_in) {
+    executable = executable_in;
+    arguments = arguments_in;
+    journal_filename = journal_filename_in;
+    int n_cores = sysconf(_SC_NPROCESSORS_ONLN);
+    if (n_cores < 1) {
+        n_cores = 1;
+    }
+    n_workers = n_workers_in;
+    if (n_workers <= 0) {
+        n_workers = n_cores;
+    }
+    // the cores are shared between the OpenMP teams of the workers
+    n_threads = max(1, n_cores/n_workers);
+}
+
+Worker_pool::~Worker_pool() {}
+
+void Worker_pool::read_journal(set<string> *done_events) {
+    ifstream journal(journal_filename.c_str());
+    string line;
+    while (getline(journal, line)) {
+        istringstream line_stream(line);
+        string status, event_path;
+        if (line_stream >> status >> event_path && status == "done") {
+            done_events->insert(event_path);
+        }
+    }
+}
+
+void Worker_pool::append_to_journal(string status, string event_path,
+                                    double value) {
+    ofstream journal(journal_filename.c_str(), ios::app);
+    if (!journal.good()) {
+        cout << "Error:Worker_pool::append_to_journal: can not open file "
+             << journal_filename << endl;
+        exit(1);
+    }
+    journal << status << " " << event_path << " " << value << endl;
+    journal.close();
+}
+
+double Worker_pool::estimate_event_cost(string event_path) {
+    long n_cells = count_text_lines(event_path + "/surface.dat");
+    // the converted densities record the number of sources in the header
+    long n_sources = read_density_container_sources(
+                                        event_path + "/densities.bin");
+    if (n_sources == 0) {
+        n_sources = read_density_container_sources(
+                                        event_path + "/densities_disk.bin");
+    }
+    if (n_sources == 0) {
+        n_sources = count_density_sources(
+                event_path + "/spectator_density_A_fromSd_order_2.dat",
+                event_path + "/spectator_density_B_fromSd_order_2.dat");
+    }
+    if (n_sources == 0) {
+        n_sources = count_density_sources(
+                event_path + "/spectator_density_A_disk.dat",
+                event_path + "/spectator_density_B_disk.dat");
+    }
+    return(static_cast<double>(max(n_cells, 1L))*max(n_sources, 1L));
+}
+
+pid_t start_worker_process(string executable,
+                           const vector<string> &arguments, int n_threads,
+                           string log_filename) {
+    pid_t pid = fork();
+    if (pid < 0) {
+        cout << "Error:start_worker_process: can not start " << executable
+             << endl;
+        exit(1);
+    }
+    if (pid > 0) {
+        return(pid);
+    }
+    // worker process
+    ostringstream n_threads_string;
+    n_threads_string << n_threads;
+    setenv("OMP_NUM_THREADS", n_threads_string.str().c_str(), 1);
+    int log_file = open(log_filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC,
+                        0644);
+    if (log_file >= 0) {
+        dup2(log_file, STDOUT_FILENO);
+        dup2(log_file, STDERR_FILENO);
+        close(log_file);
+    }
+    vector<char*> worker_argv;
+    worker_argv.push_back(const_cast<char*>(executable.c_str()));
+    for (unsigned int i = 0; i < arguments.size(); i++) {
+        worker_argv.push_back(const_cast<char*>(arguments[i].c_str()));
+    }
+    worker_argv.push_back(NULL);
+    execv(executable.c_str(), &worker_argv[0]);
+    cout << "Error:start_worker_process: can not execute " << executable
+         << endl;
+    _exit(127);
+}
+
+int get_exit_code(int status) {
+    if (WIFEXITED(status)) {
+        return(WEXITSTATUS(status));
+    }
+    return(128 + WTERMSIG(status));
+}
+
+int wait_for_worker_process(pid_t pid) {
+    int status;
+    while (waitpid(pid, &status, 0) < 0) {
+        if (errno != EINTR) {
+            cout << "Error:wait_for_worker_process: waiting for process "
+                 << pid << " failed!" << endl;
+            exit(1);
+        }
+    }
+    return(get_exit_code(status));
+}
+
+pid_t Worker_pool::start_event(const campaign_event &event) {
+    vector<string> worker_arguments;
+    worker_arguments.push_back(event.path);
+    worker_arguments.insert(worker_arguments.end(), arguments.begin(),
+                            arguments.end());
+    return(start_worker_process(executable, worker_arguments, n_threads,
+                                event.path + "/EM_fields.log"));
+}
+
+int Worker_pool::run(const vector<string> &event_paths) {
+    set<string> done_events;
+    read_journal(&done_events);
+    vector<campaign_event> events;
+    for (unsigned int i = 0; i < event_paths.size(); i++) {
+        if (done_events.count(event_paths[i]) > 0) {
+            continue;
+        }
+        campaign_event event;
+        event.path = event_paths[i];
+        event.cost = 0.0;
+        events.push_back(event);
+    }
+    // the input files of the events are scanned concurrently before any
+    // worker starts
+    int n_events = events.size();
+    #pragma omp parallel for schedule(dynamic, 16)
+    for (int i = 0; i < n_events; i++) {
+        events[i].cost = estimate_event_cost(events[i].path);
+    }
+    stable_sort(events.begin(), events.end(), more_expensive);
+    cout << "running " << events.size() << " of " << event_paths.size()
+         << " events on " << n_workers << " workers with " << n_threads
+         << " threads each" << endl;
+
+    map<pid_t, int> running_events;
+    vector<double> start_time(events.size(), 0.0);
+    unsigned int next_event = 0;
+    int n_finished = 0;
+    int n_failed = 0;
+    while (next_event < events.size() || !running_events.empty()) {
+        while (next_event < events.size()
+               && static_cast<int>(running_events.size()) < n_workers) {
+            pid_t pid = start_event(events[next_event]);
+            running_events[pid] = next_event;
+            start_time[next_event] = wall_time();
+            next_event++;
+        }
+        int status;
+        pid_t pid = waitpid(-1, &status, 0);
+        if (pid < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            cout << "Error:Worker_pool::run: waiting for the workers "
+                 << "failed!" << endl;
+            exit(1);
+        }
+        map<pid_t, int>::iterator it = running_events.find(pid);
+        if (it == running_events.end()) {
+            continue;
+        }
+        int idx = it->second;
+        running_events.erase(it);
+        n_finished++;
+        int exit_code = get_exit_code(status);
+        if (exit_code == 0) {
+            double elapsed = wall_time() - start_time[idx];
+            append_to_journal("done", events[idx].path, elapsed);
+            cout << "[" << n_finished << "/" << events.size() << "] "
+                 << events[idx].path << " done in " << elapsed << " sec."
+                 << endl;
+        } else {
+            append_to_journal("failed", events[idx].path, exit_code);
+            cout << "[" << n_finished << "/" << events.size() << "] "
+                 << events[idx].path << " failed with status " << exit_code
+                 << ", see " << events[idx].path << "/EM_fields.log"
+                 << endl;
+            n_failed++;
+        }
+    }
+    return(n_failed);
+}
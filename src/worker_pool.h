@@ -0,0 +1,75 @@
+// Copyright 2016 Chun Shen
+#ifndef SRC_WORKER_POOL_H_
+#define SRC_WORKER_POOL_H_
+
+#include <sys/types.h>
+
+#include <string>
+#include <vector>
+#include <set>
+
+using namespace std;
+
+// starts executable with the arguments and OMP_NUM_THREADS = n_threads,
+// its standard output and error go to log_filename
+pid_t start_worker_process(string executable,
+                           const vector<string> &arguments, int n_threads,
+                           string log_filename);
+// exit code of a process from its waitpid() status, 128 + the signal
+// number if it was killed
+int get_exit_code(int status);
+// waits for the process and returns its exit code
+int wait_for_worker_process(pid_t pid);
+
+struct campaign_event {
+    string path;
+    double cost;                // number of cells times number of sources
+};
+
+// Runs the events of a campaign as separate EM_fields.e processes on the
+// local node. At most n_workers events run at the same time and every
+// process gets n_threads OpenMP threads, so that the workers together do not
+// use more threads than there are cores. A crashing event only loses
+// itself, its output goes to EM_fields.log in the event directory.
+//
+// The events are started in the order of decreasing cost, which keeps the
+// workers busy until the end of the campaign. Every finished event is
+// appended to the journal as
+//     done <event path> <wall time [s]>   or   failed <event path> <status>
+// and the events listed as done are skipped, an interrupted campaign resumes
+// with the remaining ones.
+class Worker_pool {
+ private:
+    string executable;
+    vector<string> arguments;   // passed to every event after its path
+    int n_workers;
+    int n_threads;
+    string journal_filename;
+
+    pid_t start_event(const campaign_event &event);
+    void append_to_journal(string status, string event_path, double value);
+
+ public:
+    Worker_pool(string executable_in, int n_workers_in,
+                const vector<string> &arguments_in,
+                string journal_filename_in);
+    ~Worker_pool();
+
+    int get_number_of_workers() {return(n_workers);}
+    int get_number_of_threads() {return(n_threads);}
+
+    // events the journal lists as done
+    void read_journal(set<string> *done_events);
+
+    // estimates the cost of the event from the number of lines of its
+    // surface file and the number of non-zero spectator density points,
+    // which is taken from the header of a density container if the event
+    // has one. The text files are memory mapped and scanned without the
+    // streams.
+    static double estimate_event_cost(string event_path);
+
+    // runs the events not yet done, returns the number of failed events
+    int run(const vector<string> &event_paths);
+};
+
+#endif  // SRC_WORKER_POOL_H_